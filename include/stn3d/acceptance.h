@@ -0,0 +1,23 @@
+#ifndef ACCEPTANCE_H_
+#define ACCEPTANCE_H_
+
+#include "stn3d/params.h"
+
+// The logistic table covers H in [-LIMIT, LIMIT] with SIZE linear segments.
+// Beyond the limits poff is clamped to the tables end values. The maximum
+// deviation of the tabulated poff from the exact logistic function is bounded
+// by kLogisticTableMaxError.
+constexpr double kLogisticTableLimit = 16.0;
+constexpr int kLogisticTableSize = 4096;
+constexpr double kLogisticTableMaxError = 1e-6;
+
+extern AcceptanceStrategy acceptance_strategy;
+
+void InitialiseLogisticTable();
+void SetAcceptanceStrategy(AcceptanceStrategy strategy);
+double GetExactOffspringProbability(double weight_function);
+double GetTabulatedOffspringProbability(double weight_function);
+double GetOffspringProbability(double weight_function);
+bool AcceptReproduction(double weight_function, double uniform_draw);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef AGGREGATES_H_
+#define AGGREGATES_H_
+
+#include <cinttypes>
+#include <type_traits>
+#include <vector>
+
+#include "stn3d/counts.h"
+#include "stn3d/genotype.h"
+#include "stn3d/params.h"
+
+// Aggregates of the whole lattice, maintained incrementally as individuals
+// are born, die and migrate, so global queries never walk the lattice. They
+// hold the total population, the global population of each genotype with the
+// set of genotypes existent anywhere, and the number of nodes each genotype
+// occupies. The number of occupied nodes is the size of occupied_nodes.
+// Per-genotype arrays are GENOTYPES_TOT long, or tables of the existent
+// genotypes with SPARSE_COUNTS.
+using GenotypeArray = std::conditional_t<SPARSE_COUNTS, GenotypeTable,
+                                         std::vector<uint32_t>>;
+
+struct Aggregates {
+  int64_t population;                        // Individuals on the lattice
+  GenotypeArray genotype_populations;        // Individuals per genotype
+  GenotypeArray genotype_nodes;              // Nodes holding each genotype
+  std::vector<Genotype> existent_genotypes;  // Genotypes with individuals
+  GenotypeArray existent_positions;          // Index in existent_genotypes
+};
+
+extern Aggregates aggregates;
+
+void ResetAggregates();
+
+// Zeroes a per-genotype array
+inline void ResetGenotypeArray(std::vector<uint32_t> &array) {
+  array.assign(GENOTYPES_TOT, 0);
+}
+
+inline void ResetGenotypeArray(GenotypeTable &table) { table.Clear(); }
+
+// Frees the entries of a genotype no longer existent anywhere. Only tables
+// hold entries to free
+inline void ReleaseGenotype(std::vector<uint32_t> &, Genotype) {}
+inline void ReleaseGenotype(GenotypeTable &table, const Genotype genotype) {
+  table.Erase(genotype);
+}
+
+// Records an individual of a genotype joining a node. founded is true if the
+// genotype had no individuals on the node before it
+inline void AddToAggregates(const Genotype genotype, const bool founded) {
+  aggregates.population++;
+  if (aggregates.genotype_populations[genotype]++ == 0) {
+    aggregates.existent_positions[genotype] =
+        static_cast<uint32_t>(aggregates.existent_genotypes.size());
+    aggregates.existent_genotypes.push_back(genotype);
+  }
+  if (founded) {
+    aggregates.genotype_nodes[genotype]++;
+  }
+}
+
+// Records individuals of a genotype leaving a node, one unless a treatment
+// removes many at once. extinct is true if the genotype has no individuals
+// left on the node
+inline void RemoveFromAggregates(const Genotype genotype, const bool extinct,
+                                 const uint32_t count = 1) {
+  aggregates.population -= count;
+  if (extinct) {
+    aggregates.genotype_nodes[genotype]--;
+  }
+  if ((aggregates.genotype_populations[genotype] -= count) == 0) {
+    // Swap the last existent genotype into the vacated position
+    const uint32_t position = aggregates.existent_positions[genotype];
+    const Genotype last = aggregates.existent_genotypes.back();
+    aggregates.existent_genotypes[position] = last;
+    aggregates.existent_positions[last] = position;
+    aggregates.existent_genotypes.pop_back();
+    ReleaseGenotype(aggregates.genotype_populations, genotype);
+    ReleaseGenotype(aggregates.genotype_nodes, genotype);
+    ReleaseGenotype(aggregates.existent_positions, genotype);
+  }
+}
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef ARCHIVE_H_
+#define ARCHIVE_H_
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+
+#include "stn3d/encoding.h"
+#include "stn3d/mapped.h"
+
+// A trajectory archive stores the genotype counts of every node at every
+// generation in a single binary file. It consists of a fixed size header, one
+// chunk per generation, and a trailing generation index of chunk offsets.
+//
+// Each chunk starts on an 8 byte boundary with a table of node_count + 1
+// uint32 byte offsets into the chunk payload, giving O(1) access to any node
+// by its flat index (see lattice.h).
+// A node record is columnar: varint existent count E, varint byte length of
+// the genotype column, E delta encoded varint genotypes in ascending order,
+// then E varint counts. Multi-byte fields use the host (little-endian) order.
+constexpr char kArchiveMagic[8] = {'S', 'T', 'N', '3', 'D', 'T', 'R', 'J'};
+constexpr uint32_t kArchiveVersion = 1;
+
+struct ArchiveHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t node_count;      // Nodes per generation
+  uint16_t lattice_length;  // X
+  uint16_t genome_length;   // L
+  uint16_t dimensions;      // Lattice dimensionality
+  uint16_t reserved;
+  uint64_t generation_count;  // Generations stored, starting at generation 0
+  uint64_t index_offset;      // File offset of the uint64 generation index
+};
+
+// A read-only, zero-copy view of one nodes record inside a mapped archive.
+// Records are bounded by the next record, so a corrupt record is reported as
+// invalid rather than read past
+class NodeRecord {
+ public:
+  NodeRecord() = default;
+  NodeRecord(const uint8_t *data, const uint8_t *end);
+
+  bool IsValid() const { return genotypes_ != nullptr; }
+  uint64_t ExistentCount() const { return existent_count_; }
+
+  // Calls visitor(genotype, count) for each existent genotype in ascending
+  // genotype order, decoding directly from the mapped bytes. Returns false if
+  // the record is invalid or its columns are truncated
+  template <typename Visitor>
+  bool ForEach(Visitor visitor) const {
+    const uint8_t *genotype_ptr = genotypes_;
+    const uint8_t *count_ptr = counts_;
+    uint64_t genotype = 0;
+    uint64_t delta;
+    uint64_t count;
+    for (uint64_t idx = 0; IsValid() && idx < existent_count_; idx++) {
+      genotype_ptr = ReadVarint(genotype_ptr, counts_, delta);
+      count_ptr = ReadVarint(count_ptr, end_, count);
+      if (genotype_ptr == nullptr || count_ptr == nullptr) {
+        return false;
+      }
+      genotype += delta;
+      visitor(genotype, count);
+    }
+
+    return IsValid();
+  }
+
+ private:
+  uint64_t existent_count_ = 0;
+  const uint8_t *genotypes_ = nullptr;  // Start of the genotype column
+  const uint8_t *counts_ = nullptr;     // Start of the count column
+  const uint8_t *end_ = nullptr;        // End of the record
+};
+
+// Memory maps a trajectory archive for random access by (generation, node)
+class TrajectoryArchive {
+ public:
+  TrajectoryArchive() = default;
+  ~TrajectoryArchive();
+  TrajectoryArchive(const TrajectoryArchive &) = delete;
+  TrajectoryArchive &operator=(const TrajectoryArchive &) = delete;
+
+  bool Open(const std::string &path);
+  void Close();
+  const ArchiveHeader &Header() const { return *header_; }
+  uint64_t GenerationCount() const { return header_->generation_count; }
+  NodeRecord GetNodeRecord(uint64_t generation, uint32_t node) const;
+
+ private:
+  uint64_t GetChunkEnd(uint64_t generation) const;
+
+  MappedFile file_;
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  const ArchiveHeader *header_ = nullptr;
+  const uint64_t *index_ = nullptr;
+};
+
+bool OpenTrajectoryArchive(const std::string &path);
+void AppendArchiveGeneration();
+void CloseTrajectoryArchive();
+
+#endif
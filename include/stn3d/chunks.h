@@ -0,0 +1,155 @@
+#ifndef CHUNKS_H_
+#define CHUNKS_H_
+
+#include <array>
+#include <cinttypes>
+#include <memory>
+#include <vector>
+
+#include "stn3d/lattice.h"
+#include "stn3d/params.h"
+#include "stn3d/util.h"
+
+// Nodes are stored in hypercubic chunks of kChunkLength^D nodes. A chunk holds
+// its nodes, and the neighbour table rows of those nodes, so the memory held
+// by the lattice is proportional to the number of allocated chunks. On a
+// dense lattice every chunk is allocated up front. On a sparse lattice
+// (SPARSE_LATTICE) chunks are allocated the first time a node inside them is
+// accessed for writing, and released once they stay empty for
+// kChunkReleaseGenerations consecutive generation boundaries. Chunks on the
+// far side of the lattice may be padded with nodes beyond X, which are never
+// referenced. Lattices of up to 8 nodes per side are split in two along each
+// axis, so small lattices are chunked like large ones.
+//
+// A sparse lattice bounds memory by the occupied volume, not the domain: the
+// lattice remains a cube of X nodes per side, with X at most 1024, under the
+// configured BOUNDARY.
+//
+// Chunks are reference counted so that forks of the simulation (fork.h) can
+// share them. A shared chunk is copied the first time a node inside it is
+// accessed for writing, so a fork only holds copies of the chunks it changes.
+// Read-only access should use FindNode, which never copies.
+constexpr uint16_t kChunkLength = X <= 8 ? (X + 1) / 2 : 8;
+constexpr uint32_t kChunksPerAxis = (X + kChunkLength - 1) / kChunkLength;
+constexpr uint32_t kChunkNodes =
+    D == 2 ? kChunkLength * kChunkLength
+           : kChunkLength * kChunkLength * kChunkLength;
+constexpr uint32_t kChunksTot =
+    D == 2 ? kChunksPerAxis * kChunksPerAxis
+           : kChunksPerAxis * kChunksPerAxis * kChunksPerAxis;
+constexpr int kChunkReleaseGenerations = 2;
+
+// The chunk holding a node and the node's position within it
+struct ChunkLocation {
+  uint32_t chunk;
+  uint32_t offset;
+};
+
+// Both parts of a location are sums of a term per axis, so a node is located
+// from the terms of its row of X nodes along the last axis plus those of its
+// coordinate along that axis. Rows are tabulated once per build by
+// InitialiseChunks, taking 8 bytes per X nodes, and the last axis at compile
+// time. This replaces a division and remainder per axis with one division
+// and two loads on every node access.
+constexpr std::array<ChunkLocation, X> GetColumnLocations() {
+  std::array<ChunkLocation, X> locations = {};
+  for (uint32_t coord = 0; coord < X; coord++) {
+    locations[coord] = {coord / kChunkLength, coord % kChunkLength};
+  }
+
+  return locations;
+}
+
+constexpr std::array<ChunkLocation, X> kColumnLocations = GetColumnLocations();
+extern std::vector<ChunkLocation> row_locations;  // kNodesTot / X rows
+
+struct Chunk {
+  std::array<Node, kChunkNodes> nodes;  // Nodes in chunk-local row-major order
+  std::vector<NodeIndex> neighbours;    // stencil_size destinations per node
+};
+
+extern std::vector<std::shared_ptr<Chunk>> chunks;
+extern std::vector<int> chunk_empty_generations;  // Boundaries spent empty
+
+void InitialiseChunks();
+Chunk &AllocateChunk(uint32_t chunk);
+Chunk &CloneChunk(uint32_t chunk);
+void ReleaseEmptyChunks();
+size_t CountAllocatedChunks();
+
+// Returns the index of the chunk holding the node at coords
+inline uint32_t GetChunkIndex(const Coords &coords) {
+  uint32_t chunk = 0;
+  for (int axis = 0; axis < D; axis++) {
+    chunk = (chunk * kChunksPerAxis) + (coords[axis] / kChunkLength);
+  }
+
+  return chunk;
+}
+
+// Returns the position of the node at coords within its chunk
+inline uint32_t GetChunkOffset(const Coords &coords) {
+  uint32_t offset = 0;
+  for (int axis = 0; axis < D; axis++) {
+    offset = (offset * kChunkLength) + (coords[axis] % kChunkLength);
+  }
+
+  return offset;
+}
+
+// Returns the chunk holding a node and its position within the chunk, equal
+// to GetChunkIndex and GetChunkOffset of its coordinates
+inline ChunkLocation LocateNode(const NodeIndex node) {
+  const NodeIndex row = node / X;
+  const ChunkLocation &row_location = row_locations[row];
+  const ChunkLocation &column_location = kColumnLocations[node - (row * X)];
+
+  return {row_location.chunk + column_location.chunk,
+          row_location.offset + column_location.offset};
+}
+
+// Returns a node for writing, allocating its chunk if it doesn't exist yet
+// and copying it if it's shared with a fork
+inline Node &GetNode(const NodeIndex node) {
+  const ChunkLocation location = LocateNode(node);
+  if (!chunks[location.chunk]) {
+    AllocateChunk(location.chunk);
+  } else if (chunks[location.chunk].use_count() > 1) {
+    CloneChunk(location.chunk);
+  }
+
+  return chunks[location.chunk]->nodes[location.offset];
+}
+
+// Returns a node if its chunk is allocated, else nullptr. Unallocated nodes
+// are empty
+inline const Node *FindNode(const NodeIndex node) {
+  const ChunkLocation location = LocateNode(node);
+  const std::shared_ptr<Chunk> &chunk = chunks[location.chunk];
+
+  return chunk ? &chunk->nodes[location.offset] : nullptr;
+}
+
+// Calls fn(node) for every node within the lattice of every allocated chunk,
+// copying any chunk shared with a fork
+template <typename Fn>
+void ForEachAllocatedNode(Fn fn) {
+  for (uint32_t idx = 0; idx < kChunksTot; idx++) {
+    if (!chunks[idx]) {
+      continue;
+    }
+    Chunk *chunk =
+        chunks[idx].use_count() > 1 ? &CloneChunk(idx) : chunks[idx].get();
+    for (Node &node : chunk->nodes) {
+      bool in_lattice = true;
+      for (LatticeCoord coord : node.coords) {
+        in_lattice = in_lattice && coord < X;
+      }
+      if (in_lattice) {
+        fn(node);
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef COARSE_H_
+#define COARSE_H_
+
+#include <array>
+#include <cinttypes>
+#include <utility>
+#include <vector>
+
+#include "stn3d/aggregates.h"
+#include "stn3d/lattice.h"
+#include "stn3d/params.h"
+#include "stn3d/util.h"
+
+// With ADAPTIVE_RESOLUTION the step engine coarse-grains the stable interior
+// of a tumour, so the steps of a generation scale with its front rather than
+// its volume. The lattice is divided into regions of kCoarseLength^D nodes.
+// At each generation boundary, a region whose nodes are all occupied, and
+// whose population and allele frequencies each changed by at most
+// kCoarseTolerance for kCoarseStableGenerations consecutive boundaries,
+// becomes coarse: its nodes keep their counts but are no longer selected, and
+// tau only counts the individuals of the remaining, active nodes.
+//
+// A coarse region splits back into active nodes as soon as a migrant reaches
+// it or its resources are edited, and every kCoarseRefreshGenerations it is
+// refined for one generation to update it, coarsening again if it held.
+// Exact genotype counts aren't compared, as mutation turns over most of them
+// every generation even at equilibrium. Coarse nodes are kept at the back of
+// occupied_nodes, so selection only scans the active nodes ahead of them. At
+// least one active node always remains, as every region is refined if the
+// active nodes die out. Only the step engine coarse-grains;
+// the next-reaction engine already spends no time on nodes without events.
+constexpr uint16_t kCoarseLength = X < 16 ? 3 : 8;
+constexpr uint32_t kCoarseRegionsPerAxis =
+    (X + kCoarseLength - 1) / kCoarseLength;
+constexpr uint32_t kCoarseRegionsTot =
+    D == 2 ? kCoarseRegionsPerAxis * kCoarseRegionsPerAxis
+           : kCoarseRegionsPerAxis * kCoarseRegionsPerAxis *
+                 kCoarseRegionsPerAxis;
+constexpr int kCoarseStableGenerations = 5;
+constexpr double kCoarseTolerance = 0.05;
+constexpr int kCoarseRefreshGenerations = 10;
+
+// A region of the lattice, and the aggregate of its nodes at the last
+// generation boundary it was active at
+struct CoarseRegion {
+  bool coarse;
+  uint32_t nodes;                 // Nodes of the region within the lattice
+  int stable_generations;         // Consecutive boundaries it held
+  int coarsened_generation;       // Generation it last became coarse at
+  int64_t population;             // Individuals on its nodes
+  double mu;                      // Mean mu of its nodes
+  std::array<double, L> alleles;  // Frequency of each set genotype bit
+};
+
+struct CoarseLattice {
+  std::vector<CoarseRegion> regions;
+  // Regions holding individuals at the last boundary, ascending. Every
+  // coarse region is among them
+  std::vector<uint32_t> populated_regions;
+  uint32_t coarse_nodes;      // Nodes at the back of occupied_nodes
+  int64_t coarse_population;  // Individuals on coarse nodes
+};
+
+extern CoarseLattice coarse_lattice;
+
+void ResetCoarseLattice();
+void UpdateCoarseRegions();
+void RefineRegion(uint32_t region);
+void RefineAllRegions();
+
+// Returns the index of the region holding the node at coords
+inline uint32_t GetRegionIndex(const Coords &coords) {
+  uint32_t region = 0;
+  for (int axis = 0; axis < D; axis++) {
+    region = (region * kCoarseRegionsPerAxis) + (coords[axis] / kCoarseLength);
+  }
+
+  return region;
+}
+
+// Refines the region of a node if it's coarse
+inline void RefineNodeRegion(const NodeIndex node) {
+  if (coarse_lattice.coarse_nodes == 0) {
+    return;
+  }
+  const uint32_t region = GetRegionIndex(Lattice::Coordinates(node));
+  if (coarse_lattice.regions[region].coarse) {
+    RefineRegion(region);
+  }
+}
+
+// Adds a newly occupied node to occupied_nodes, ahead of the coarse nodes
+inline void AddOccupiedNode(const NodeIndex node) {
+  occupied_nodes.push_back(node);
+  if (coarse_lattice.coarse_nodes != 0) {
+    std::swap(occupied_nodes.back(),
+              occupied_nodes[occupied_nodes.size() - 1 -
+                             coarse_lattice.coarse_nodes]);
+  }
+}
+
+// Returns the number of active nodes at the front of occupied_nodes
+inline size_t GetActiveNodeCount() {
+  return occupied_nodes.size() - coarse_lattice.coarse_nodes;
+}
+
+// Returns the number of individuals on active nodes
+inline int64_t GetActivePopulation() {
+  return aggregates.population - coarse_lattice.coarse_population;
+}
+
+// Refines every coarse region once the last active node or individual is
+// gone, so the step engine always has a node to select
+inline void RefineIfNoneActive() {
+  if (coarse_lattice.coarse_nodes != 0 &&
+      (GetActiveNodeCount() == 0 || GetActivePopulation() <= 0)) {
+    RefineAllRegions();
+  }
+}
+
+#endif
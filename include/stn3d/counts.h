@@ -0,0 +1,98 @@
+#ifndef COUNTS_H_
+#define COUNTS_H_
+
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+#include "stn3d/genotype.h"
+#include "stn3d/params.h"
+
+// An open-addressed table of nonzero counts keyed by genotype, for genomes too
+// long to hold one counter per genotype. Genotypes are placed by Fibonacci
+// hashing with linear probing, and erased by shifting later entries back, so
+// no tombstones accumulate. The table doubles once it's half full, and holds
+// no storage until the first insertion.
+class GenotypeTable {
+ public:
+  uint32_t operator[](Genotype genotype) const;
+  uint32_t &operator[](Genotype genotype);
+  void Erase(Genotype genotype);
+  void Clear();
+
+  size_t Size() const { return size_; }
+  size_t Bytes() const { return slots_.size() * sizeof(Slot); }
+
+ private:
+  // Every id is a valid genotype when L=64, so free slots are flagged rather
+  // than marked with a reserved id
+  struct Slot {
+    Genotype genotype;
+    uint32_t count;
+    bool used;  // False if the slot is free
+  };
+
+  size_t Home(Genotype genotype) const;
+  size_t Locate(Genotype genotype) const;
+  void Grow();
+
+  std::vector<Slot> slots_;
+  size_t size_ = 0;
+  int shift_ = 64;  // 64 - log2(slots_.size())
+};
+
+// Genotype population counts of a node. Counts are stored with the narrowest
+// counter width (uint8, uint16 or uint32) able to hold them: no storage is
+// held until the first count is added, then storage starts at one byte per
+// genotype and promotes itself to the next width the first time a count would
+// overflow. Widths never demote, so a promotion happens at most twice in the
+// lifetime of a node. With SPARSE_COUNTS, only the nonzero counts are held,
+// in a GenotypeTable, and the width is always zero.
+class GenotypeCounts {
+ public:
+  GenotypeCounts();
+
+  int operator[](Genotype genotype) const;
+  void Increment(Genotype genotype);
+  void Decrement(Genotype genotype);
+  void Set(Genotype genotype, int count);
+  void Clear();
+
+  int Width() const { return width_; }
+  size_t Bytes() const;
+
+  // Calls visitor(counts) with a pointer to the counts array at its current
+  // width, or the table of sparse counts, so hot loops can be instantiated
+  // once per width rather than branching on each access. Dense storage must
+  // have been allocated
+  template <typename Visitor>
+  decltype(auto) Visit(Visitor &&visitor) const {
+    if constexpr (SPARSE_COUNTS) {
+      return visitor(sparse_);
+    } else {
+      switch (width_) {
+        case sizeof(uint8_t):
+          return visitor(counts_8_.data());
+        case sizeof(uint16_t):
+          return visitor(counts_16_.data());
+        default:
+          return visitor(counts_32_.data());
+      }
+    }
+  }
+
+ private:
+  void Allocate();
+  template <typename Count>
+  std::vector<Count> &Counts();
+  template <typename From, typename To>
+  void Promote();
+
+  int width_;  // Bytes per counter, or zero before any storage is allocated
+  std::vector<uint8_t> counts_8_;
+  std::vector<uint16_t> counts_16_;
+  std::vector<uint32_t> counts_32_;
+  GenotypeTable sparse_;
+};
+
+#endif
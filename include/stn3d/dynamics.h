@@ -5,23 +5,37 @@
 #include <map>
 #include <vector>
 
+#include "stn3d/counts.h"
+#include "stn3d/genotype.h"
+#include "stn3d/lattice.h"
 #include "stn3d/params.h"
 
-using LatticeCoord = uint8_t;
-using LatticePoint = uint32_t;
+// Progress of the running simulation
+struct SimState {
+  int generation;  // Generations completed
+  int step;        // Steps taken in the current generation
+  double tau;      // Steps comprising the current generation
+  int population;  // Total population at the last generation boundary
+  double time;     // Generations simulated, at the last step, event or boundary
+  double clock;    // Physical time of the next-reaction engine (events.h)
+};
 
-double GetInteractionStrength(int genotype_a, int genotype_b);
-int Reproduce(std::array<int, GENOTYPES_TOT> &g_counts,
-              std::vector<int> &existent, int &N, double mu);
-bool Annihilate(std::array<int, GENOTYPES_TOT> &g_counts,
-                std::vector<int> &existent, int &N, int existent_idx,
-                LatticeCoord i_coord, LatticeCoord j_coord,
-                LatticeCoord k_coord);
-void Migrate(std::vector<LatticePoint> &neighbours,
-             std::array<int, GENOTYPES_TOT> &g_counts,
-             std::vector<int> &existent, int &N, int existent_idx,
-             LatticeCoord i_coord, LatticeCoord j_coord, LatticeCoord k_coord);
-void SimLoop(LatticeCoord i_selection, LatticeCoord j_selection,
-             LatticeCoord k_selection);
+extern Engine engine;
+extern SimState sim_state;
+
+double GetInteractionStrength(Genotype genotype_a, Genotype genotype_b);
+Genotype MutateGenotype(Genotype parent);
+int Reproduce(GenotypeCounts &g_counts, std::vector<Genotype> &existent,
+              int &N, double mu, NodeIndex node);
+bool Annihilate(GenotypeCounts &g_counts, std::vector<Genotype> &existent,
+                int &N, int existent_idx, NodeIndex node);
+void Migrate(GenotypeCounts &g_counts, std::vector<Genotype> &existent,
+             int &N, int existent_idx, NodeIndex node);
+void OpenRunOutputs();
+void BeginSimulation(NodeIndex start);
+void SetEngine(Engine simulation_engine);
+bool StepSimulation();
+void EndGeneration();
+void SimLoop(NodeIndex selection);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,14 @@
+#ifndef ENCODING_H_
+#define ENCODING_H_
+
+#include <cinttypes>
+#include <vector>
+
+void AppendVarint(std::vector<uint8_t> &buffer, uint64_t value);
+const uint8_t *ReadVarint(const uint8_t *data, const uint8_t *end,
+                          uint64_t &value);
+
+// The most bytes a varint of a uint64 takes
+constexpr int kMaxVarintBytes = 10;
+
+#endif
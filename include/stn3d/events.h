@@ -0,0 +1,60 @@
+#ifndef EVENTS_H_
+#define EVENTS_H_
+
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+#include "stn3d/lattice.h"
+#include "stn3d/params.h"
+#include "stn3d/util.h"
+
+// The next-reaction engine simulates the model as a continuous-time Markov
+// chain, following Gibson and Bruck. It isn't an exact simulation of an
+// independently specified model: its rates reproduce the step scheme, so the
+// engines agree in distribution (stn3d_validate). Each step selects a node in
+// proportion to its population n, then one of its E existent genotypes
+// uniformly. The selected genotype a reproduces with probability poff(H_a),
+// then dies with probability PKILL, or otherwise migrates with probability
+// PMOVE, or not at all while a treatment blocks migration (treatment.h).
+// Nodes are always weighted by population, as RAND_OCC_SELECTION only
+// applies to the step engine.
+//
+// Events are scheduled on a physical clock, measured in mean lifetimes: each
+// existent genotype is selected at rate n / (PKILL E) whatever its count, so
+// every rate depends only on the state of its node, and the clock is a
+// Poisson time axis. Only selections that change a node are events: its
+// genotypes together die at rate kDeathRate * n and migrate at rate
+// kMigrationRate * n, the genotype chosen uniformly and first reproducing
+// with probability poff(H_a), and genotype a alone reproduces and stays at
+// rate n poff(H_a) (1 - PKILL) (1 - PMOVE) / (PKILL E).
+//
+// Generations follow the step engine instead, which fixes the tau = N / PKILL
+// selections of a generation at its start. Each unit of the clock therefore
+// lasts N / (PKILL tau) generations, so generation time runs slower than the
+// clock while N grows within a generation, and faster while it falls.
+// SimState holds both: time in generations and clock in lifetimes.
+//
+// Each occupied node aggregates the rates of its genotypes into a
+// propensity, and holds the clock time of its next event in an indexed
+// binary min-heap. Firing an event updates the t1 sums of the affected nodes
+// incrementally in O(E), then reschedules only those nodes in O(log nodes).
+constexpr double kDeathRate = 1.0;
+constexpr double kMigrationRate = (1.0 - PKILL) * PMOVE / PKILL;
+
+struct EventQueueEntry {
+  double time;      // Clock time of the nodes next event
+  NodeIndex index;  // Flat index of the node
+};
+
+void BuildEventQueue();
+bool StepEvent();
+double GetReproductionPropensity(const Node &node);
+void RescheduleNode(NodeIndex index);
+void RefreshNode(NodeIndex index);
+const std::vector<EventQueueEntry> &GetEventQueue();
+void SetEventQueue(const std::vector<EventQueueEntry> &queue);
+const EventQueueEntry *PeekNextEvent();
+size_t CountScheduledNodes();
+
+#endif
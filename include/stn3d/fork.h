@@ -0,0 +1,45 @@
+#ifndef FORK_H_
+#define FORK_H_
+
+#include <cinttypes>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "stn3d/aggregates.h"
+#include "stn3d/chunks.h"
+#include "stn3d/coarse.h"
+#include "stn3d/dynamics.h"
+#include "stn3d/events.h"
+#include "stn3d/lineage.h"
+#include "stn3d/treatment.h"
+
+// A fork is a saved copy of the whole simulation state: the nodes, the
+// occupied set and its coarse regions, the progress counters and treatment
+// schedule, the aggregates, the event queue, the lineage tracker and the
+// random engine. Capturing one shares every chunk with the running simulation
+// rather than copying it, so it costs O(chunks), and a chunk is only copied
+// once either side writes to it (chunks.h). Restoring a fork rewinds the
+// simulation to exactly the captured state, so one warm-up can be branched
+// into many scenarios, each holding copies of only the chunks it changed.
+//
+// Output files, the live snapshot segment and the landscape aren't part of a
+// fork, and are shared by every branch.
+struct SimulationFork {
+  std::vector<std::shared_ptr<Chunk>> chunks;
+  std::vector<int> chunk_empty_generations;
+  std::vector<NodeIndex> occupied_nodes;
+  CoarseLattice coarse_lattice;
+  TreatmentState treatment;
+  SimState sim_state;
+  Engine engine;
+  Aggregates aggregates;
+  std::vector<EventQueueEntry> event_queue;
+  LineageState lineage;
+  std::mt19937 random_engine;
+};
+
+void CaptureFork(SimulationFork &fork);
+void RestoreFork(const SimulationFork &fork);
+
+#endif
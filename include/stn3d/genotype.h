@@ -0,0 +1,16 @@
+#ifndef GENOTYPE_H_
+#define GENOTYPE_H_
+
+#include <cinttypes>
+
+#include "stn3d/params.h"
+
+// A genotype is a bitset of L genes, identified by the integer whose bit idx
+// holds gene idx, so genomes of up to 64 genes fit in an id
+using Genotype = uint64_t;
+
+// The bits of a genotype id holding genes
+constexpr Genotype kGenotypeMask =
+    L >= 64 ? ~Genotype{0} : (Genotype{1} << (L % 64)) - 1;
+
+#endif
@@ -2,23 +2,28 @@
 #define INITIALISE_H_
 
 #include <cinttypes>
+#include <string>
 #include <vector>
 
-using LatticeCoord = uint8_t;
-using LatticePoint = uint32_t;
+#include "stn3d/lattice.h"
+#include "stn3d/util.h"
 
 void InitialiseGenotypes();
 void InitialiseMatricies();
-void InitialiseNeighbours(std::vector<LatticePoint> &neighbours,
-                          LatticeCoord i_coord, LatticeCoord j_coord,
-                          LatticeCoord k_coord);
+bool InitialiseLandscape(const std::string &path);
+void InitialiseNeighbours(std::vector<NodeIndex> &neighbours, NodeIndex node);
 void InitialiseLattice();
-void InitialiseResources();
-void InitialisePopulationOnNode(LatticeCoord i_coord, LatticeCoord j_coord,
-                                LatticeCoord k_coord);
-void LogInitialState(LatticeCoord i_coord, LatticeCoord j_coord,
-                     LatticeCoord k_coord);
+void OpenNodeLogs();
+bool InitialiseResources(
+    const std::string &volume_path = RESOURCE_VOLUME_FILE);
+void AssignResources(Node &node);
+NodeIndex ChooseStartNode();
+void InitialisePopulationOnNode(NodeIndex node);
+void LogInitialState(NodeIndex start);
+double GetCubicMu(const Coords &coords);
+double GetGradientMu(const Coords &coords);
 void DistributeCubicMu();
 void DistributeGradientMu();
+void DistributeVolumeMu();
 
-#endif
\ No newline at end of file
+#endif
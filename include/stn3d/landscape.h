@@ -0,0 +1,75 @@
+#ifndef LANDSCAPE_H_
+#define LANDSCAPE_H_
+
+#include <cinttypes>
+#include <string>
+
+#include "stn3d/genotype.h"
+#include "stn3d/params.h"
+
+// An interaction landscape file holds the A1, A2 and B arrays defining J(a,b)
+// for a genome length L, so concurrent runs can share one landscape. It
+// consists of a fixed size header followed by one section per array, each
+// starting on a kLandscapeAlignment byte boundary at the offset recorded in
+// the header. A1 and A2 are GENOTYPES_TOT doubles and B is GENOTYPES_TOT
+// int32 flags, all in host (little-endian) order.
+//
+// Files are mapped read-only (mapped.h), so every process mapping the same
+// landscape shares its page cache copy.
+constexpr char kLandscapeMagic[8] = {'S', 'T', 'N', '3', 'D', 'L', 'N', 'D'};
+constexpr uint32_t kLandscapeVersion = 1;
+constexpr uint64_t kLandscapeAlignment = 64;
+
+struct LandscapeHeader {
+  char magic[8];
+  uint32_t version;
+  uint16_t genome_length;  // L
+  uint16_t reserved;
+  uint64_t genotype_count;  // 2^L
+  double theta;             // Probability of nonzero interactions
+  uint64_t seed;            // Seed the arrays were generated from
+  uint64_t a1_offset;       // File offsets of the A1, A2 and B sections
+  uint64_t a2_offset;
+  uint64_t b_offset;
+  uint64_t file_size;
+};
+
+// The hashed landscape (INTERACTIONS = kHashed) holds no arrays, so L may
+// exceed 16. Each value of A1, A2 and B is derived from the genotype and
+// array, each weighted by an odd constant and added to a landscape seed, then
+// mixed by the SplitMix64 finaliser. The values follow the same distributions
+// as generated tables: A1 and A2 uniform on [-1, 1), and B one with
+// probability THETA. A hash costs a few multiplications, less than a cache
+// miss on a table, so values are recomputed rather than cached.
+extern uint64_t hashed_landscape_seed;
+
+// Returns a uniform value on [0, 1) for an array of the hashed landscape
+inline double GetHashedUnit(const uint64_t array, const Genotype genotype) {
+  uint64_t hash = hashed_landscape_seed + (array * 0xD1B54A32D192ED03ull) +
+                  (genotype * 0x9E3779B97F4A7C15ull);
+  hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+  hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+  hash ^= hash >> 31;
+
+  return static_cast<double>(hash >> 11) * 0x1.0p-53;
+}
+
+inline double GetHashedA1(const Genotype z) {
+  return (2.0 * GetHashedUnit(0, z)) - 1.0;
+}
+
+inline double GetHashedA2(const Genotype genotype) {
+  return (2.0 * GetHashedUnit(1, genotype)) - 1.0;
+}
+
+inline bool GetHashedB(const Genotype z) {
+  return GetHashedUnit(2, z) <= THETA;
+}
+
+bool WriteLandscapeFile(const std::string &path, uint64_t seed);
+bool MapLandscapeFile(const std::string &path);
+void UseGeneratedLandscape();
+void UseHashedLandscape(uint64_t seed);
+void ReleaseLandscape();
+
+#endif
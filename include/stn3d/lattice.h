@@ -0,0 +1,72 @@
+#ifndef LATTICE_H_
+#define LATTICE_H_
+
+#include <array>
+#include <cinttypes>
+
+#include "stn3d/params.h"
+
+using LatticeCoord = uint16_t;
+using NodeIndex = uint32_t;
+
+// Geometry of a hypercubic lattice of X^Dim nodes. Nodes are addressed by a
+// flat index in row-major order, e.g. (i * X + j) * X + k in three dimensions.
+// Only two and three dimensions are specialised, so index arithmetic is fully
+// unrolled at compile time.
+template <uint16_t Dim>
+struct LatticeGeometry;
+
+template <>
+struct LatticeGeometry<2> {
+  static constexpr uint16_t kDimensions = 2;
+  static constexpr uint32_t kNodes = X * X;
+  using Coords = std::array<LatticeCoord, 2>;
+
+  static constexpr NodeIndex Index(const Coords &coords) {
+    return (coords[0] * X) + coords[1];
+  }
+
+  static constexpr Coords Coordinates(const NodeIndex node) {
+    return {static_cast<LatticeCoord>(node / X),
+            static_cast<LatticeCoord>(node % X)};
+  }
+};
+
+template <>
+struct LatticeGeometry<3> {
+  static constexpr uint16_t kDimensions = 3;
+  static constexpr uint32_t kNodes = X * X * X;
+  using Coords = std::array<LatticeCoord, 3>;
+
+  static constexpr NodeIndex Index(const Coords &coords) {
+    return (((coords[0] * X) + coords[1]) * X) + coords[2];
+  }
+
+  static constexpr Coords Coordinates(const NodeIndex node) {
+    return {static_cast<LatticeCoord>(node / (X * X)),
+            static_cast<LatticeCoord>((node / X) % X),
+            static_cast<LatticeCoord>(node % X)};
+  }
+};
+
+// The lattice used by this build, selected by D in params.h
+using Lattice = LatticeGeometry<D>;
+using Coords = Lattice::Coords;
+
+constexpr uint32_t kNodesTot = Lattice::kNodes;
+
+// Returns the coordinates of the node at x, y and z, ignoring z on a
+// two-dimensional lattice
+constexpr Coords MakeCoords(const LatticeCoord x, const LatticeCoord y,
+                            const LatticeCoord z) {
+  Coords coords = {x, y};
+  if constexpr (D == 3) {
+    coords[D - 1] = z;
+  } else {
+    static_cast<void>(z);
+  }
+
+  return coords;
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef LINEAGE_H_
+#define LINEAGE_H_
+
+#include <cinttypes>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "stn3d/genotype.h"
+#include "stn3d/lattice.h"
+
+// The lineage tracker (TRACK_LINEAGE) records the ancestry of every clone: the
+// individuals of one genotype on one node. Each mutation that introduces a
+// genotype to a node appends a record to an arena, linked to the record of
+// its parents clone. Founders of the initial population are roots. Migrants
+// founding a clone on another node share the record of their origin clone.
+//
+// Records count the living clones referencing them. Extinct clones only
+// release their reference, so lineages are pruned by periodic compaction,
+// which keeps the records with a living clone or a living descendant and
+// renumbers them in order. Compaction runs once the arena has doubled since
+// the last, so its cost per record is amortised O(1).
+constexpr uint32_t kLineageRoot = UINT32_MAX;
+constexpr char kPhylogenyMagic[8] = {'S', 'T', 'N', '3', 'D', 'P', 'H', 'Y'};
+constexpr uint32_t kPhylogenyVersion = 1;
+
+struct LineageRecord {
+  uint32_t parent;           // Record of the parent clone, else kLineageRoot
+  Genotype parent_genotype;  // Genotype of the parent, 0 for founders
+  Genotype genotype;         // Genotype introduced by the mutation
+  NodeIndex node;            // Node of the mutation
+  int32_t generation;        // Generation of the mutation
+  uint32_t clones;           // Living clones referencing the record
+  bool founder;              // Founded by the initial population
+};
+
+// The clone of a genotype on a node
+struct CloneKey {
+  NodeIndex node;
+  Genotype genotype;
+
+  bool operator==(const CloneKey &other) const {
+    return node == other.node && genotype == other.genotype;
+  }
+};
+
+struct CloneKeyHash {
+  size_t operator()(const CloneKey &key) const {
+    return static_cast<size_t>((key.genotype * 0x9E3779B97F4A7C15ull) ^
+                               key.node);
+  }
+};
+
+using CloneLineages = std::unordered_map<CloneKey, uint32_t, CloneKeyHash>;
+
+// A copy of the whole tracker, saved by forks of the simulation (fork.h)
+struct LineageState {
+  std::vector<LineageRecord> records;
+  CloneLineages clone_lineages;
+  size_t compacted_size;  // Arena size after the last compaction
+};
+
+void ResetLineage();
+void RecordFounder(NodeIndex node, Genotype genotype);
+void RecordMutation(NodeIndex node, Genotype parent, Genotype child);
+uint32_t GetCloneLineage(NodeIndex node, Genotype genotype);
+void RecordClone(NodeIndex node, Genotype genotype, uint32_t lineage);
+void RecordExtinction(NodeIndex node, Genotype genotype);
+void CompactLineage();
+void MaybeCompactLineage();
+const std::vector<LineageRecord> &GetLineageRecords();
+void SaveLineage(LineageState &state);
+void RestoreLineage(const LineageState &state);
+bool WritePhylogenyFile(const std::string &path);
+bool ReadPhylogenyFile(const std::string &path,
+                       std::vector<LineageRecord> &records);
+
+#endif
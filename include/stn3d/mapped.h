@@ -0,0 +1,41 @@
+#ifndef MAPPED_H_
+#define MAPPED_H_
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// A read-only view of the whole of a file, shared by the readers of archives,
+// landscapes, traces and volumes. Files are memory mapped where mmap is
+// available, so processes reading the same file share its page cache copy,
+// and read into memory once elsewhere. Readers validate the bytes themselves,
+// bounding every offset they follow with Spans.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+
+  bool Open(const std::string &path);
+  void Close();
+  bool IsOpen() const { return data_ != nullptr; }
+  const uint8_t *Data() const { return data_; }
+  size_t Size() const { return size_; }
+  void Release(uint64_t begin, uint64_t end) const;
+
+  // Returns true if bytes from offset lie within the file, without overflow
+  bool Spans(const uint64_t offset, const uint64_t bytes) const {
+    return offset <= size_ && bytes <= size_ - offset;
+  }
+
+ private:
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  std::vector<uint8_t> buffer_;  // File contents where mmap is unavailable
+};
+
+#endif
@@ -3,14 +3,60 @@
 
 #include <cinttypes>
 
+// Strategies for accepting a reproduction attempt with probability
+// poff = 1 / (1 + exp(-H)). See acceptance.h for details.
+enum class AcceptanceStrategy {
+  kExact,      // Evaluate the logistic function in full double precision
+  kTabulated,  // Interpolate the logistic function from a precomputed table
+  kLogit       // Compare H against the logit of the uniform draw
+};
+
+// Neighbourhoods and boundary conditions for migration. See stencil.h.
+enum class Neighbourhood {
+  kVonNeumann,  // The 6 face-adjacent nodes
+  kMoore        // The 26 face, edge and corner-adjacent nodes
+};
+enum class Boundary {
+  kPeriodic,    // Wrap around to the opposite face of the lattice
+  kReflective,  // Mirror back into the lattice
+  kAbsorbing    // Migrants leave the lattice and are lost
+};
+
+// Sources of the interaction landscape A1, A2 and B. See landscape.h.
+enum class Interactions {
+  kTables,  // Arrays of GENOTYPES_TOT values, generated or mapped from a file
+  kHashed   // Derived on demand from a seeded hash of each genotype
+};
+
+// Resampling of a resource volume onto the lattice. See volume.h.
+enum class Resampling {
+  kNearest,   // Take mu from the voxel nearest each node centre
+  kTrilinear  // Interpolate mu between the 8 voxels around each node centre
+};
+
+// Engines advancing the simulation. See dynamics.h and events.h.
+enum class Engine {
+  kSteps,        // Discrete steps, tau = N / PKILL steps per generation
+  kNextReaction  // Continuous-time events at step rates (Gibson-Bruck)
+};
+
 // Ubiquitous constants relating to the spatial Tangled Nature model.
 // The ambiguous macro names have been specifically chosen to mirror variable
 // naming in the mathematical model, so brief descriptions are provided here.
 // For a detailed explanation and guidance on usage, see:
 // https://wwwf.imperial.ac.uk/~hjjens/Laird_Lawson_Jensen_4.pdf
+//
+// Defining STN3D_WIDE_GENOME selects a 64 gene genome with the hashed
+// landscape and sparse counts, as the wide genome tests are built.
+#ifdef STN3D_WIDE_GENOME
+constexpr uint16_t L = 64;             // The size of a genotypes bitset
+constexpr uint64_t GENOTYPES_TOT = 0;  // 2^L, which wraps to 0 when L=64
+#else
 constexpr uint16_t L = 12;                // The size of a genotypes bitset
-constexpr uint16_t GENOTYPES_TOT = 4096;  // 2^L: The number of unique genotypes
+constexpr uint64_t GENOTYPES_TOT = 4096;  // 2^L: The number of unique genotypes
+#endif
 constexpr uint16_t GENERATIONS_TOT = 500;  // Maximal generational steps
+constexpr uint16_t D = 3;                  // Lattice dimensions: 2 or 3
 constexpr uint16_t X = 6;                  // Lattice dimension length
 constexpr uint16_t N_0 = 100;              // Starting population size
 constexpr double THETA = 0.25;   // Probability of nonzero interactions
@@ -26,5 +72,32 @@ constexpr uint16_t FIXED_X_VAL = 3;    // x coordinate of starting position
 constexpr uint16_t FIXED_Y_VAL = 3;    // y coordinate of starting position
 constexpr uint16_t FIXED_Z_VAL = 3;    // z coordinate of starting position
 constexpr bool RAND_OCC_SELECTION = false;  // Enforce random node selection
+constexpr AcceptanceStrategy ACCEPTANCE_STRATEGY =
+    AcceptanceStrategy::kExact;  // Default reproduction acceptance strategy
+constexpr bool WRITE_ARCHIVE = true;  // Write a binary trajectory archive
+constexpr bool WRITE_NODE_LOGS = true;  // Write existent genotypes per node
+constexpr bool SPARSE_LATTICE = false;  // Allocate lattice chunks on demand
+constexpr Neighbourhood NEIGHBOURHOOD =
+    Neighbourhood::kMoore;  // Default migration neighbourhood
+constexpr Boundary BOUNDARY = Boundary::kPeriodic;  // Default boundary
+constexpr Engine ENGINE = Engine::kSteps;  // Default simulation engine
+constexpr bool TRACK_LINEAGE = false;  // Record the phylogeny of clones
+constexpr char LANDSCAPE_FILE[] = "";  // Landscape file to map, "" to generate
+#ifdef STN3D_WIDE_GENOME
+constexpr Interactions INTERACTIONS =
+    Interactions::kHashed;  // Default interaction landscape source
+constexpr bool SPARSE_COUNTS = true;  // Store only nonzero genotype counts
+#else
+constexpr Interactions INTERACTIONS =
+    Interactions::kTables;  // Default interaction landscape source
+constexpr bool SPARSE_COUNTS = false;  // Store only nonzero genotype counts
+#endif
+constexpr char SNAPSHOT_SEGMENT[] = "";  // Live snapshot segment, "" for none
+constexpr char EVENT_TRACE_FILE[] = "";  // Event trace to record, "" for none
+constexpr char RESOURCE_VOLUME_FILE[] = "";  // Volume of mu, "" to generate
+constexpr Resampling RESOURCE_RESAMPLING =
+    Resampling::kTrilinear;  // Default resampling of resource volumes
+constexpr bool ADAPTIVE_RESOLUTION = false;  // Coarse-grain stable regions
+constexpr char TREATMENT_SCHEDULE_FILE[] = "";  // Treatments, "" for none
 
 #endif
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef RUN_H_
+#define RUN_H_
+
+#include <cinttypes>
+#include <vector>
+
+#include "stn3d/aggregates.h"
+#include "stn3d/dynamics.h"
+#include "stn3d/fork.h"
+#include "stn3d/lattice.h"
+#include "stn3d/util.h"
+
+// An embedding API over the simulation, built into libstn3d. A run is created
+// from the parameters of the build, advanced by steps or generations, and
+// queried between advances through read-only views of the live lattice, so
+// in-process consumers can analyse it without serialisation. The simulation
+// state is global, so at most one run exists at a time. Views remain valid
+// until the run is next advanced or destroyed.
+//
+// A run can be forked after a warm-up and restored to branch into scenarios,
+// which differ by edits to node resources. Branches run one after another in
+// the process; to run them in parallel, fork() a process per branch after
+// restoring, as the operating system then shares the pages of every chunk
+// neither branch changes.
+struct RunOptions {
+  uint64_t seed;      // Seed of the random engine, so runs are reproducible
+  bool write_output;  // Write the logs and archive of the binary into out/
+  const char *landscape_path;  // Landscape file to map, else LANDSCAPE_FILE
+};
+
+bool CreateRun(const RunOptions &options);
+void DestroyRun();
+bool RunExists();
+bool AdvanceSteps(uint64_t steps);
+bool AdvanceGenerations(uint32_t generations);
+const SimState &GetRunState();
+const Node *GetNodeView(NodeIndex node);
+const std::vector<NodeIndex> &GetOccupiedNodes();
+const Aggregates &GetRunAggregates();
+bool ForkRun(SimulationFork &fork);
+bool RestoreRun(const SimulationFork &fork);
+bool SetNodeMu(NodeIndex node, double mu);
+
+#endif
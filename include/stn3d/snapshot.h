@@ -0,0 +1,87 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <atomic>
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+#include "stn3d/lattice.h"
+
+// Live snapshots let a monitor inspect a running simulation without pausing
+// it. At each generation boundary the simulation publishes the state of every
+// occupied node into a POSIX shared memory segment (SNAPSHOT_SEGMENT), which
+// any number of readers may map. The segment is a header followed by one
+// record per occupied node, and grows when the occupied nodes outgrow it.
+//
+// Publication is guarded by a seqlock: the writer makes the sequence odd
+// while it writes and even again once it's done, so the simulation never
+// waits on a reader. Readers copy the snapshot and retry if the sequence
+// changed in the meantime. The segment is left in place when the run ends,
+// marked as no longer running, so the final state can still be read.
+constexpr char kSnapshotMagic[8] = {'S', 'T', 'N', '3', 'D', 'S', 'N', 'P'};
+constexpr uint32_t kSnapshotVersion = 1;
+constexpr int kSnapshotTopGenotypes = 4;
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint16_t dimensions;      // D
+  uint16_t lattice_length;  // X
+  std::atomic<uint64_t> sequence;  // Odd while a snapshot is being written
+  uint64_t capacity;               // Node records the segment can hold
+  uint64_t node_count;             // Node records in the snapshot
+  int32_t generation;
+  int32_t population;
+  double time;
+  uint32_t running;  // Zero once the run has ended
+  uint32_t reserved;
+};
+
+// The state of an occupied node. Unused top genotype slots have a count of 0
+struct SnapshotNode {
+  NodeIndex node;
+  int32_t population;
+  int32_t existent_count;
+  int32_t reserved;
+  double mu;
+  uint64_t top_genotypes[kSnapshotTopGenotypes];  // Most populous first
+  int32_t top_counts[kSnapshotTopGenotypes];
+};
+
+// A consistent copy of the latest published snapshot
+struct Snapshot {
+  uint16_t dimensions;
+  uint16_t lattice_length;
+  int32_t generation;
+  int32_t population;
+  double time;
+  bool running;
+  std::vector<SnapshotNode> nodes;
+};
+
+bool OpenSnapshotSegment(const std::string &name);
+void PublishSnapshot();
+void CloseSnapshotSegment();
+
+// Maps a snapshot segment read-only, remapping it when it grows
+class SnapshotReader {
+ public:
+  SnapshotReader() = default;
+  ~SnapshotReader();
+  SnapshotReader(const SnapshotReader &) = delete;
+  SnapshotReader &operator=(const SnapshotReader &) = delete;
+
+  bool Open(const std::string &name);
+  void Close();
+  bool Read(Snapshot &snapshot);
+
+ private:
+  bool Map();
+
+  int fd_ = -1;
+  void *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef STATISTICS_H_
+#define STATISTICS_H_
+
+#include <vector>
+
+// Nonparametric tests of whether samples are drawn from the same continuous
+// distribution, used to validate engines whose outputs can't be compared bit
+// for bit. Both tests handle tied values, which are common in population
+// counts. Kolmogorov-Smirnov p-values use the asymptotic distribution with
+// Stephens' small sample correction. Anderson-Darling p-values interpolate the
+// Scholz and Stephens (1987) critical values between significance levels of
+// kAndersonDarlingMinP and kAndersonDarlingMaxP: larger p-values are reported
+// as kAndersonDarlingMaxP, and smaller ones are extrapolated.
+constexpr double kAndersonDarlingMinP = 0.001;
+constexpr double kAndersonDarlingMaxP = 0.25;
+
+struct TestResult {
+  double statistic;
+  double p_value;
+};
+
+double GetKolmogorovSurvival(double lambda);
+TestResult KolmogorovSmirnovTest(std::vector<double> sample_a,
+                                 std::vector<double> sample_b);
+TestResult AndersonDarlingTest(std::vector<std::vector<double>> samples);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef STENCIL_H_
+#define STENCIL_H_
+
+#include <array>
+#include <cinttypes>
+#include <vector>
+
+#include "stn3d/chunks.h"
+#include "stn3d/lattice.h"
+#include "stn3d/params.h"
+
+// Migration resolves destinations through neighbour table rows built once per
+// topology from a single global table of stencil offsets. Each chunk holds the
+// rows of its nodes: stencil_size destination node indices per node in the
+// order of the offsets. Destinations beyond an absorbing boundary are
+// kAbsorbed: individuals migrating there leave the lattice.
+constexpr NodeIndex kAbsorbed = UINT32_MAX;
+
+extern Neighbourhood neighbourhood;
+extern Boundary boundary;
+extern int stencil_size;
+extern std::vector<std::array<int, D>> stencil_offsets;
+
+void SetStencil(Neighbourhood stencil_neighbourhood, Boundary stencil_boundary);
+void BuildNeighbourTable();
+void BuildNeighbourRows(Chunk &chunk);
+
+// Returns the destination of the nth stencil offset from a node, which must
+// belong to an allocated chunk
+inline NodeIndex GetNeighbour(const NodeIndex node, const int n) {
+  const ChunkLocation location = LocateNode(node);
+  return chunks[location.chunk]
+      ->neighbours[(location.offset * stencil_size) + n];
+}
+
+#endif
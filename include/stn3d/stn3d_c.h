@@ -0,0 +1,68 @@
+#ifndef STN3D_C_H_
+#define STN3D_C_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A C ABI over the embedding API in run.h, for consumers such as Python
+// extensions. Lattice parameters are fixed when libstn3d is built, and at most
+// one run exists at a time. Pointers in views refer directly to the live
+// lattice: they are read-only and remain valid until the run is next advanced
+// or destroyed. Nodes of unallocated chunks of a sparse lattice are empty and
+// share one view, which is valid until another such node is viewed.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  uint64_t seed;     // Seed of the random engine
+  int write_output;  // Nonzero to write the logs and archive into out/
+  const char *landscape_path;  // Landscape file to map, or NULL for default
+} stn3d_options;
+
+typedef struct {
+  uint32_t dimensions;      // D
+  uint32_t lattice_length;  // X
+  uint32_t node_count;      // X^D
+  uint32_t genome_length;   // L
+  uint64_t genotype_count;  // 2^L, or 0 when L=64
+} stn3d_lattice;
+
+typedef struct {
+  int32_t generation;  // Generations completed
+  int32_t step;        // Steps taken in the current generation
+  double tau;          // Steps comprising the current generation
+  int32_t population;  // Total population at the last generation boundary
+  double time;  // Generations simulated, at the last step, event or boundary
+  double clock;  // Physical time of an event-driven run, in mean lifetimes
+} stn3d_state;
+
+typedef struct {
+  const uint16_t *coords;  // dimensions coordinates of the node
+  const int *population;   // Node population
+  const double *mu;        // Node resources
+  // genotype_count counters of count_width (1, 2 or 4) bytes each, or NULL
+  // with a count_width of 0 if the node has never been occupied or counts
+  // are sparse (SPARSE_COUNTS). stn3d_get_genotype_count reads either
+  const void *genotype_counts;
+  int count_width;
+  const uint64_t *existent_genotypes;  // Genotypes with a nonzero count
+  size_t existent_count;
+} stn3d_node_view;
+
+int stn3d_create(const stn3d_options *options);
+void stn3d_destroy(void);
+int stn3d_advance_steps(uint64_t steps);
+int stn3d_advance_generations(uint32_t generations);
+void stn3d_get_lattice(stn3d_lattice *lattice);
+void stn3d_get_state(stn3d_state *state);
+int stn3d_get_node(uint32_t node, stn3d_node_view *view);
+int32_t stn3d_get_genotype_count(uint32_t node, uint64_t genotype);
+size_t stn3d_get_occupied_nodes(const uint32_t **nodes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
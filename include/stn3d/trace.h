@@ -0,0 +1,113 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <cinttypes>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "stn3d/genotype.h"
+#include "stn3d/lattice.h"
+#include "stn3d/mapped.h"
+
+// An event trace records every change to the genotype counts of the lattice,
+// in the order the changes happened: each birth, death and migration, and the
+// generation boundaries between them. Replaying a trace rebuilds the counts
+// of every node at any step by applying its events, without evaluating H or
+// drawing random numbers, so it's far faster than simulating again.
+//
+// Each record is a varint tag, holding its type and the steps taken since the
+// previous record, followed by varint fields (encoding.h):
+//   birth:      node, parent genotype, offspring genotype
+//   death:      node, genotype
+//   deaths:     node, genotype, count; the deaths of a treatment (treatment.h)
+//   migration:  node, genotype, destination + 1, or 0 if absorbed
+//   generation: no fields; the generation advances and its step resets
+//   keyframe:   payload size, generation, occupied node count, then per node
+//               its index, existent count E and E pairs of delta encoded
+//               genotype and count, in ascending genotype order
+// Records are written into a buffer that's appended to the file whenever it
+// fills, so recording an event costs a few byte stores. A keyframe of the
+// whole lattice is recorded at the start and every keyframe_generations
+// generations, and the file ends with an index of keyframes, so a replay
+// starts from the last keyframe before its target. The header and index are
+// written when the trace is closed; an incomplete trace can't be replayed.
+// Restoring a fork (fork.h) while recording isn't supported, as the trace
+// would no longer describe one history.
+constexpr char kTraceMagic[8] = {'S', 'T', 'N', '3', 'D', 'E', 'V', 'T'};
+constexpr uint32_t kTraceVersion = 1;
+constexpr int kTraceKeyframeGenerations = 50;
+constexpr size_t kTraceBufferBytes = 1 << 20;
+
+enum class TraceRecord : uint8_t {
+  kBirth,
+  kDeath,
+  kMigration,
+  kGeneration,
+  kKeyframe,
+  kDeaths
+};
+constexpr int kTraceTypeBits = 3;
+
+struct TraceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t node_count;      // X^D
+  uint16_t lattice_length;  // X
+  uint16_t genome_length;   // L
+  uint16_t dimensions;      // D
+  uint16_t reserved;
+  uint64_t records_end;     // File offset after the last record
+  uint64_t keyframe_count;  // Entries of the keyframe index
+  uint64_t index_offset;    // File offset of the 8 byte aligned index
+};
+
+struct TraceKeyframe {
+  uint64_t generation;  // Generation the keyframe was recorded at, at step 0
+  uint64_t offset;      // File offset of the keyframe record
+};
+
+// The genotype counts of the occupied nodes at one step of a trace
+struct TraceState {
+  int generation;
+  int step;
+  int64_t population;
+  std::map<NodeIndex, std::map<Genotype, uint32_t>> nodes;
+};
+
+extern bool trace_recording;
+
+bool OpenEventTrace(const std::string &path,
+                    int keyframe_generations = kTraceKeyframeGenerations);
+void TraceBirth(NodeIndex node, Genotype parent, Genotype offspring);
+void TraceDeath(NodeIndex node, Genotype genotype);
+void TraceDeaths(NodeIndex node, Genotype genotype, uint32_t count);
+void TraceMigration(NodeIndex node, Genotype genotype, NodeIndex destination);
+void TraceGenerationEnd();
+void WriteTraceKeyframe();
+void CloseEventTrace();
+
+// Memory maps a completed event trace to replay it
+class EventTrace {
+ public:
+  EventTrace() = default;
+  ~EventTrace();
+  EventTrace(const EventTrace &) = delete;
+  EventTrace &operator=(const EventTrace &) = delete;
+
+  bool Open(const std::string &path);
+  void Close();
+  const TraceHeader &Header() const { return *header_; }
+  uint64_t KeyframeCount() const { return header_->keyframe_count; }
+  bool Seek(int generation, int step, TraceState &state) const;
+
+ private:
+  MappedFile file_;
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  const TraceHeader *header_ = nullptr;
+  const TraceKeyframe *index_ = nullptr;
+};
+
+#endif
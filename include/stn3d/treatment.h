@@ -0,0 +1,71 @@
+#ifndef TREATMENT_H_
+#define TREATMENT_H_
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+#include "stn3d/dynamics.h"
+#include "stn3d/genotype.h"
+#include "stn3d/lattice.h"
+#include "stn3d/params.h"
+
+// A treatment schedule perturbs the whole lattice at given generations, to
+// model a therapy protocol without a rebuild. It's read from
+// TREATMENT_SCHEDULE_FILE, a text file holding a perturbation per line, with
+// blank lines and lines starting # ignored:
+//
+//   <generation> kill <fraction> [<resistant fraction> <resistance mask>]
+//   <generation> mu <factor> [<low coords> <high coords>]
+//   <generation> block <generations>
+//
+// kill removes a fraction of the individuals of every genotype, or the
+// resistant fraction of genotypes carrying any bit of the resistance mask.
+// mu multiplies the resources of the nodes within an inclusive box of D low
+// and D high coordinates, or of the whole lattice. block stops migration for
+// a number of generations. Perturbations are applied at the start of their
+// generation, which must be at least 1, after the state reached at its
+// boundary is logged.
+//
+// Each perturbation is a single pass over the lattice. A kill draws the dead
+// of each genotype on a node from a binomial distribution, so its cost scales
+// with the existent genotypes rather than the individuals, then compacts the
+// existent genotypes of each node and the occupied nodes once. Coarse regions
+// are refined first, as their counts change. A mu scaling visits only the
+// chunks overlapping its box, and copies a chunk shared with a fork only if
+// it changes one of its nodes.
+enum class PerturbationKind { kKill, kScaleMu, kBlockMigration };
+
+struct Perturbation {
+  int generation;  // Generation it's applied at the start of
+  PerturbationKind kind;
+  double fraction;            // Killed fraction, or the factor scaling mu
+  double resistant_fraction;  // Killed fraction of resistant genotypes
+  Genotype resistance_mask;   // Genotype bits conferring resistance
+  Coords low;                 // Inclusive box of nodes whose mu is scaled
+  Coords high;
+  int generations;  // Generations migration is blocked for
+};
+
+// Progress through the schedule of a run
+struct TreatmentState {
+  std::vector<Perturbation> schedule;     // Ascending generation
+  size_t next;                            // Next perturbation to apply
+  int migration_blocked_until;            // Generation migration resumes at
+  std::vector<Perturbation> mu_scalings;  // Applied, for chunks allocated later
+};
+
+extern TreatmentState treatment;
+
+bool LoadTreatmentSchedule(const std::string &path);
+void ResetTreatment();
+void ApplyDueTreatments();
+void ApplyPerturbation(const Perturbation &perturbation);
+double GetTreatedMu(const Coords &coords, double mu);
+
+// Returns true if a treatment is blocking migration
+inline bool IsMigrationBlocked() {
+  return sim_state.generation < treatment.migration_blocked_until;
+}
+
+#endif
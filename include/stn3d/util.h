@@ -5,42 +5,43 @@
 #include <bitset>
 #include <cinttypes>
 #include <fstream>
-#include <map>
 #include <memory>
+#include <ostream>
+#include <random>
 #include <vector>
 
+#include "stn3d/counts.h"
+#include "stn3d/genotype.h"
+#include "stn3d/lattice.h"
 #include "stn3d/params.h"
 
-using LatticeCoord = uint8_t;
-using LatticePoint = uint32_t;
-
 struct Node {
-  LatticeCoord i_coord;  // The nodes x coordinate in the lattice
-  LatticeCoord j_coord;  // The nodes y coordinate in the lattice
-  LatticeCoord k_coord;  // The nodes z coordinate in the lattice
-  std::array<int, GENOTYPES_TOT> genotype_counts;  // Genotype population counts
-  std::vector<int> existent_genotypes;   // Stores existent genotypes on node
-  std::vector<LatticePoint> neighbours;  // Stores valid neighbouring nodes
-  double mu;                             // Resource allocation on node
+  Coords coords;                   // The nodes coordinates in the lattice
+  GenotypeCounts genotype_counts;  // Genotype population counts
+  std::vector<Genotype> existent_genotypes;  // Existent genotypes on node
+  double mu;                       // Resource allocation on node
   int population;  // Node population: the sum of genotype_counts elements
+  std::vector<double> interaction_sums;  // t1 per existent genotype (events.h)
+  double propensity = 0.0;  // Total event rate of the node (events.h)
 };
 
-extern std::array<std::array<std::array<std::unique_ptr<Node>, X>, X>, X> nodes;
-extern std::map<
-    LatticeCoord,
-    std::map<LatticeCoord,
-             std::map<LatticeCoord, std::unique_ptr<std::ofstream>>>>
-    outfiles;
-extern std::vector<LatticePoint> occupied_nodes;
-extern std::array<double, GENOTYPES_TOT> arr_a1, arr_a2;
-extern std::array<int, GENOTYPES_TOT> arr_b;
-extern std::bitset<L> genotype_bitsets[GENOTYPES_TOT];
+extern std::vector<std::unique_ptr<std::ofstream>> outfiles;
+extern std::vector<NodeIndex> occupied_nodes;
+extern std::ofstream population_log;
+extern double *arr_a1, *arr_a2;
+extern int32_t *arr_b;
+extern std::vector<std::bitset<L>> genotype_bitsets;
+extern std::mt19937 twister_engine;
 
+uint16_t GetParameterErrors(std::ostream &oss);
 void ValidateParameters();
+void SeedRandomEngine(uint64_t seed);
 double UniformRealInRange(int min, int max);
 int UniformIntInRange(int min, int max);
-LatticePoint GetOccupiedNode();
-LatticeCoord GetCoordinate(LatticePoint latticePoint, uint32_t idx);
+Genotype UniformGenotype();
+NodeIndex GetOccupiedNode();
+LatticeCoord GetCoordinate(NodeIndex node, uint32_t idx);
+void MakeOutputDirectory();
 void CloseAllOutputFiles();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef VOLUME_H_
+#define VOLUME_H_
+
+#include <array>
+#include <cinttypes>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "stn3d/lattice.h"
+#include "stn3d/mapped.h"
+#include "stn3d/params.h"
+
+// A resource volume file holds a voxel map of mu, such as one derived from
+// imaging of vascularisation, to initialise the resources of a lattice from
+// via RESOURCE_VOLUME_FILE. Its voxels are stored in slabs of constant x, each
+// extent[1] rows of extent[2] voxels, and a two-dimensional map has a z extent
+// of 1. A voxel v holds mu = offset + (scale * v), in one of the encodings:
+//   kFloat32: mu itself, with a scale of 1 and offset of 0
+//   kUint8:   quantised into 256 levels
+//   kUint16:  quantised into 65536 levels
+//   kDelta16: quantised as kUint16, each voxel stored as a zigzag varint of
+//             its difference from the previous voxel of the slab
+// Uncompressed slabs follow the header at data_offset. Compressed slabs vary
+// in size, so they're followed by an index of extent[0] + 1 slab offsets at
+// slab_offsets, the last being the end of the slab data.
+//
+// The volume needn't match the lattice: each node samples the volume at the
+// position of its centre, with nearest or trilinear resampling. The file is
+// memory mapped, and the lattice is initialised in x order, so only the slabs
+// resampling touches are read and slabs behind the current plane are released
+// as it advances. Volumes far larger than memory only occupy a few slabs.
+constexpr char kVolumeMagic[8] = {'S', 'T', 'N', '3', 'D', 'V', 'O', 'L'};
+constexpr uint32_t kVolumeVersion = 1;
+constexpr uint64_t kVolumeAlignment = 64;
+constexpr int kVolumeCachedSlabs = 2;  // Decoded compressed slabs kept
+
+enum class VolumeEncoding : uint16_t { kFloat32, kUint8, kUint16, kDelta16 };
+
+struct VolumeHeader {
+  char magic[8];
+  uint32_t version;
+  uint16_t encoding;  // VolumeEncoding
+  uint16_t reserved;
+  uint32_t extent[3];     // Voxels along x, y and z
+  uint32_t reserved_extent;
+  double scale;           // A voxel v holds mu = offset + (scale * v)
+  double offset;
+  uint64_t slab_offsets;  // File offset of the slab index, 0 if uncompressed
+  uint64_t data_offset;   // File offset of the first slab
+  uint64_t file_size;
+};
+
+// Writes a resource volume one slab at a time, so volumes needn't fit in
+// memory to be written
+class ResourceVolumeWriter {
+ public:
+  bool Open(const std::string &path, const std::array<uint32_t, 3> &extent,
+            VolumeEncoding encoding, double scale = 1.0, double offset = 0.0);
+  void WriteSlab(const float *mu);
+  bool Close();
+
+ private:
+  std::ofstream file_;
+  VolumeHeader header_ = {};
+  std::vector<uint64_t> slab_offsets_;
+  std::vector<uint8_t> buffer_;
+  uint32_t slabs_written_ = 0;
+};
+
+// Memory maps a resource volume to sample mu from
+class ResourceVolume {
+ public:
+  ResourceVolume() = default;
+  ~ResourceVolume();
+  ResourceVolume(const ResourceVolume &) = delete;
+  ResourceVolume &operator=(const ResourceVolume &) = delete;
+
+  bool Open(const std::string &path);
+  void Close();
+  bool IsOpen() const { return data_ != nullptr; }
+  const VolumeHeader &Header() const { return *header_; }
+  double Sample(const Coords &coords, Resampling resampling);
+  uint32_t GetFirstSlab(LatticeCoord x) const;
+  void ReleaseSlabsBefore(uint32_t slab);
+
+ private:
+  double GetVoxel(uint32_t x, uint32_t y, uint32_t z);
+  const std::vector<float> &DecodeSlab(uint32_t slab);
+  uint64_t GetSlabOffset(uint32_t slab) const;
+
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  const VolumeHeader *header_ = nullptr;
+  const uint64_t *slab_offsets_ = nullptr;
+  MappedFile file_;
+  uint64_t released_ = 0;  // File offset below which pages were released
+  std::array<uint32_t, kVolumeCachedSlabs> cached_ids_ = {};
+  std::array<std::vector<float>, kVolumeCachedSlabs> cached_slabs_;
+  int next_cached_ = 0;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "stn3d/acceptance.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+AcceptanceStrategy acceptance_strategy = ACCEPTANCE_STRATEGY;
+
+// Logistic function sampled at kLogisticTableSize + 1 evenly spaced points
+// over [-kLogisticTableLimit, kLogisticTableLimit]
+static std::array<double, kLogisticTableSize + 1> logistic_table;
+static constexpr double kLogisticTableStep =
+    (2 * kLogisticTableLimit) / kLogisticTableSize;
+
+// Fills the logistic lookup table used by the tabulated acceptance strategy
+void InitialiseLogisticTable() {
+  for (int idx = 0; idx <= kLogisticTableSize; idx++) {
+    logistic_table[idx] = GetExactOffspringProbability(
+        -kLogisticTableLimit + (idx * kLogisticTableStep));
+  }
+}
+
+// Selects the strategy used by AcceptReproduction, building the logistic table
+// if it is required
+void SetAcceptanceStrategy(const AcceptanceStrategy strategy) {
+  if (strategy == AcceptanceStrategy::kTabulated) {
+    InitialiseLogisticTable();
+  }
+
+  acceptance_strategy = strategy;
+}
+
+// Returns poff: the probability of reproduction given the weight function (H)
+double GetExactOffspringProbability(const double weight_function) {
+  return 1 / (1 + exp(-weight_function));
+}
+
+// Returns poff by linear interpolation of the logistic table. The
+// interpolation error is at most step^2 / 8 * max|poff''|, roughly 7.4e-7 for
+// the default table, and the clamped tails differ by at most poff(-limit)
+double GetTabulatedOffspringProbability(const double weight_function) {
+  if (weight_function <= -kLogisticTableLimit) {
+    return logistic_table.front();
+  }
+  if (weight_function >= kLogisticTableLimit) {
+    return logistic_table.back();
+  }
+
+  const double position =
+      (weight_function + kLogisticTableLimit) / kLogisticTableStep;
+  const int idx = std::min(static_cast<int>(position), kLogisticTableSize - 1);
+  const double fraction = position - idx;
+
+  return logistic_table[idx] +
+         (fraction * (logistic_table[idx + 1] - logistic_table[idx]));
+}
+
+// Returns poff using the current strategy. The logit strategy only changes how
+// an attempt is tested, so it shares the exact probability
+double GetOffspringProbability(const double weight_function) {
+  if (acceptance_strategy == AcceptanceStrategy::kTabulated) {
+    return GetTabulatedOffspringProbability(weight_function);
+  }
+
+  return GetExactOffspringProbability(weight_function);
+}
+
+// Decides whether a reproduction attempt with weight function H succeeds given
+// a uniform draw over [0, 1). All strategies consume the same single draw, so
+// switching strategy doesn't alter the random number sequence
+bool AcceptReproduction(const double weight_function,
+                        const double uniform_draw) {
+  switch (acceptance_strategy) {
+    case AcceptanceStrategy::kTabulated:
+      return uniform_draw <= GetTabulatedOffspringProbability(weight_function);
+    case AcceptanceStrategy::kLogit:
+      // u <= 1 / (1 + exp(-H)) is equivalent to log(u / (1 - u)) <= H, which
+      // avoids exp entirely. A draw of zero is always accepted
+      if (uniform_draw <= 0.0) {
+        return true;
+      }
+      return log(uniform_draw / (1 - uniform_draw)) <= weight_function;
+    case AcceptanceStrategy::kExact:
+    default:
+      return uniform_draw <= GetExactOffspringProbability(weight_function);
+  }
+}
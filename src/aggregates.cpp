@@ -0,0 +1,12 @@
+#include "stn3d/aggregates.h"
+
+Aggregates aggregates;
+
+// Empties the aggregates, allocating dense per-genotype arrays on first use
+void ResetAggregates() {
+  aggregates.population = 0;
+  ResetGenotypeArray(aggregates.genotype_populations);
+  ResetGenotypeArray(aggregates.genotype_nodes);
+  aggregates.existent_genotypes.clear();
+  ResetGenotypeArray(aggregates.existent_positions);
+}
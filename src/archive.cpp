@@ -0,0 +1,217 @@
+#include "stn3d/archive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "stn3d/chunks.h"
+#include "stn3d/util.h"
+
+// Writer state for the archive of the running simulation
+static std::ofstream archive_file;
+static std::vector<uint64_t> archive_index;
+static std::vector<uint8_t> archive_payload;
+static std::vector<uint32_t> archive_node_offsets;
+static std::vector<Genotype> archive_sorted_genotypes;
+
+// Pads the archive file with zeros up to the next 8 byte boundary
+static void AlignArchiveFile() {
+  const char padding[8] = {0};
+  const auto position = static_cast<uint64_t>(archive_file.tellp());
+  archive_file.write(padding,
+                     static_cast<std::streamsize>((8 - (position % 8)) % 8));
+}
+
+// Creates a trajectory archive and writes a provisional header, which is
+// completed by CloseTrajectoryArchive
+bool OpenTrajectoryArchive(const std::string &path) {
+  archive_file.open(path, std::ios::binary | std::ios::trunc);
+  if (!archive_file.is_open()) {
+    return false;
+  }
+
+  archive_index.clear();
+  ArchiveHeader header = {};
+  archive_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  return true;
+}
+
+// Appends the genotype counts of every node as a new generation chunk. Nodes
+// of unallocated chunks are written as empty records
+void AppendArchiveGeneration() {
+  if (!archive_file.is_open()) {
+    return;
+  }
+
+  archive_payload.clear();
+  archive_node_offsets.clear();
+  for (NodeIndex idx = 0; idx < kNodesTot; idx++) {
+    archive_node_offsets.push_back(
+        static_cast<uint32_t>(archive_payload.size()));
+
+    const Node *node = FindNode(idx);
+    if (node == nullptr) {
+      AppendVarint(archive_payload, 0);
+      AppendVarint(archive_payload, 0);
+      continue;
+    }
+
+    // Genotypes are sorted so the genotype column can be delta encoded
+    archive_sorted_genotypes.assign(node->existent_genotypes.begin(),
+                                    node->existent_genotypes.end());
+    std::sort(archive_sorted_genotypes.begin(), archive_sorted_genotypes.end());
+
+    std::vector<uint8_t> genotype_column;
+    Genotype previous = 0;
+    for (Genotype genotype : archive_sorted_genotypes) {
+      AppendVarint(genotype_column, genotype - previous);
+      previous = genotype;
+    }
+
+    AppendVarint(archive_payload, archive_sorted_genotypes.size());
+    AppendVarint(archive_payload, genotype_column.size());
+    archive_payload.insert(archive_payload.end(), genotype_column.begin(),
+                           genotype_column.end());
+    for (Genotype genotype : archive_sorted_genotypes) {
+      AppendVarint(archive_payload, node->genotype_counts[genotype]);
+    }
+  }
+  archive_node_offsets.push_back(
+      static_cast<uint32_t>(archive_payload.size()));
+
+  AlignArchiveFile();
+  archive_index.push_back(static_cast<uint64_t>(archive_file.tellp()));
+  archive_file.write(
+      reinterpret_cast<const char *>(archive_node_offsets.data()),
+      static_cast<std::streamsize>(archive_node_offsets.size() *
+                                   sizeof(uint32_t)));
+  archive_file.write(reinterpret_cast<const char *>(archive_payload.data()),
+                     static_cast<std::streamsize>(archive_payload.size()));
+}
+
+// Writes the generation index and completes the header of the open archive
+void CloseTrajectoryArchive() {
+  if (!archive_file.is_open()) {
+    return;
+  }
+
+  AlignArchiveFile();
+  ArchiveHeader header = {};
+  std::memcpy(header.magic, kArchiveMagic, sizeof(kArchiveMagic));
+  header.version = kArchiveVersion;
+  header.node_count = kNodesTot;
+  header.lattice_length = X;
+  header.genome_length = L;
+  header.dimensions = D;
+  header.generation_count = archive_index.size();
+  header.index_offset = static_cast<uint64_t>(archive_file.tellp());
+
+  archive_file.write(reinterpret_cast<const char *>(archive_index.data()),
+                     static_cast<std::streamsize>(archive_index.size() *
+                                                  sizeof(uint64_t)));
+  archive_file.seekp(0);
+  archive_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  archive_file.close();
+}
+
+// Locates the genotype and count columns of a node record ending before end,
+// leaving the record invalid if they don't fit
+NodeRecord::NodeRecord(const uint8_t *data, const uint8_t *end) {
+  uint64_t existent_count;
+  uint64_t genotype_column_size;
+  data = ReadVarint(data, end, existent_count);
+  data = ReadVarint(data, end, genotype_column_size);
+  if (data == nullptr ||
+      genotype_column_size > static_cast<uint64_t>(end - data)) {
+    return;
+  }
+
+  existent_count_ = existent_count;
+  genotypes_ = data;
+  counts_ = data + genotype_column_size;
+  end_ = end;
+}
+
+TrajectoryArchive::~TrajectoryArchive() { Close(); }
+
+// Maps an archive read-only and validates its header, returning false if the
+// file is missing, truncated or not a complete archive
+bool TrajectoryArchive::Open(const std::string &path) {
+  Close();
+  if (!file_.Open(path)) {
+    return false;
+  }
+  data_ = file_.Data();
+  size_ = file_.Size();
+
+  header_ = reinterpret_cast<const ArchiveHeader *>(data_);
+  if (size_ < sizeof(ArchiveHeader) ||
+      std::memcmp(header_->magic, kArchiveMagic, sizeof(kArchiveMagic)) != 0 ||
+      header_->version != kArchiveVersion ||
+      header_->index_offset % sizeof(uint64_t) != 0 ||
+      header_->generation_count > size_ / sizeof(uint64_t) ||
+      !file_.Spans(header_->index_offset,
+                   header_->generation_count * sizeof(uint64_t))) {
+    Close();
+    return false;
+  }
+  index_ = reinterpret_cast<const uint64_t *>(data_ + header_->index_offset);
+
+  // Check each chunk's node offset table lies between its start and the next
+  // chunk, so records can be bounded without reading past the index
+  const uint64_t table_size =
+      (static_cast<uint64_t>(header_->node_count) + 1) * sizeof(uint32_t);
+  for (uint64_t generation = 0; generation < header_->generation_count;
+       generation++) {
+    const uint64_t chunk = index_[generation];
+    if (chunk < sizeof(ArchiveHeader) || chunk % sizeof(uint32_t) != 0 ||
+        chunk > GetChunkEnd(generation) ||
+        table_size > GetChunkEnd(generation) - chunk) {
+      Close();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Unmaps the archive
+void TrajectoryArchive::Close() {
+  file_.Close();
+  data_ = nullptr;
+  size_ = 0;
+  header_ = nullptr;
+  index_ = nullptr;
+}
+
+// Returns the file offset a generation's chunk ends before, which is the
+// next chunk or the generation index
+uint64_t TrajectoryArchive::GetChunkEnd(const uint64_t generation) const {
+  return generation + 1 < header_->generation_count ? index_[generation + 1]
+                                                    : header_->index_offset;
+}
+
+// Returns a view of the record of a node at a generation in O(1). The record
+// is invalid if either is out of range, or its offsets are corrupt
+NodeRecord TrajectoryArchive::GetNodeRecord(const uint64_t generation,
+                                            const uint32_t node) const {
+  if (generation >= header_->generation_count || node >= header_->node_count) {
+    return NodeRecord();
+  }
+
+  const uint8_t *chunk = data_ + index_[generation];
+  const auto *node_offsets = reinterpret_cast<const uint32_t *>(chunk);
+  const uint8_t *payload =
+      chunk + ((header_->node_count + 1) * sizeof(uint32_t));
+  const uint64_t payload_size =
+      static_cast<uint64_t>(data_ + GetChunkEnd(generation) - payload);
+  if (node_offsets[node] > node_offsets[node + 1] ||
+      node_offsets[node + 1] > payload_size) {
+    return NodeRecord();
+  }
+
+  return NodeRecord(payload + node_offsets[node],
+                    payload + node_offsets[node + 1]);
+}
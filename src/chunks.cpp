@@ -0,0 +1,111 @@
+#include "stn3d/chunks.h"
+
+#include "stn3d/dynamics.h"
+#include "stn3d/initialise.h"
+#include "stn3d/stencil.h"
+
+std::vector<std::shared_ptr<Chunk>> chunks;
+std::vector<int> chunk_empty_generations;
+std::vector<ChunkLocation> row_locations;
+
+// Tabulates the location terms of each row of nodes along the last axis, from
+// the coordinates of its first node
+static void BuildRowLocations() {
+  row_locations.resize(kNodesTot / X);
+  for (NodeIndex row = 0; row < kNodesTot / X; row++) {
+    const Coords coords = Lattice::Coordinates(row * X);
+    row_locations[row] = {GetChunkIndex(coords), GetChunkOffset(coords)};
+  }
+}
+
+// Discards all chunks, then allocates every chunk unless the lattice is sparse
+void InitialiseChunks() {
+  if (row_locations.empty()) {
+    BuildRowLocations();
+  }
+  chunks.clear();
+  chunks.resize(kChunksTot);
+  chunk_empty_generations.assign(kChunksTot, 0);
+
+  if (!SPARSE_LATTICE) {
+    for (uint32_t chunk = 0; chunk < kChunksTot; chunk++) {
+      AllocateChunk(chunk);
+    }
+  }
+}
+
+// Allocates a chunk of empty nodes, assigning their coordinates, resources and
+// neighbour table rows
+Chunk &AllocateChunk(const uint32_t chunk) {
+  chunks[chunk] = std::make_shared<Chunk>();
+  Chunk &allocated = *chunks[chunk];
+
+  // Decode the coordinates of the chunks first node
+  Coords origin;
+  uint32_t remainder = chunk;
+  for (int axis = D - 1; axis >= 0; axis--) {
+    origin[axis] = (remainder % kChunksPerAxis) * kChunkLength;
+    remainder /= kChunksPerAxis;
+  }
+
+  for (uint32_t offset = 0; offset < kChunkNodes; offset++) {
+    Node &node = allocated.nodes[offset];
+    remainder = offset;
+    bool in_lattice = true;
+    for (int axis = D - 1; axis >= 0; axis--) {
+      node.coords[axis] = origin[axis] + (remainder % kChunkLength);
+      remainder /= kChunkLength;
+      in_lattice = in_lattice && node.coords[axis] < X;
+    }
+
+    node.population = 0;
+    if (in_lattice) {
+      AssignResources(node);
+    }
+  }
+
+  BuildNeighbourRows(allocated);
+  chunk_empty_generations[chunk] = 0;
+
+  return allocated;
+}
+
+// Replaces a chunk shared with a fork by an exclusive copy
+Chunk &CloneChunk(const uint32_t chunk) {
+  chunks[chunk] = std::make_shared<Chunk>(*chunks[chunk]);
+
+  return *chunks[chunk];
+}
+
+// Releases chunks that have been empty for kChunkReleaseGenerations
+// consecutive calls. Call once per generation boundary
+void ReleaseEmptyChunks() {
+  for (uint32_t idx = 0; idx < kChunksTot; idx++) {
+    if (!chunks[idx]) {
+      continue;
+    }
+
+    bool empty = true;
+    for (const Node &node : chunks[idx]->nodes) {
+      empty = empty && node.population == 0;
+    }
+
+    int &empty_generations = chunk_empty_generations[idx];
+    empty_generations = empty ? empty_generations + 1 : 0;
+    if (empty_generations >= kChunkReleaseGenerations) {
+      chunks[idx].reset();
+    }
+  }
+}
+
+// Returns the number of allocated chunks
+size_t CountAllocatedChunks() {
+  size_t allocated = 0;
+  for (const std::shared_ptr<Chunk> &chunk : chunks) {
+    if (chunk) {
+      allocated++;
+    }
+  }
+
+  return allocated;
+}
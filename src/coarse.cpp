@@ -0,0 +1,193 @@
+#include "stn3d/coarse.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "stn3d/chunks.h"
+#include "stn3d/dynamics.h"
+
+CoarseLattice coarse_lattice;
+
+static constexpr uint32_t kUntallied = UINT32_MAX;
+
+// Totals of the active nodes of a region at a generation boundary
+struct RegionTally {
+  uint32_t region;
+  uint32_t occupied;  // Active nodes holding individuals
+  int64_t population;
+  double mu;
+  std::array<double, L> alleles;
+};
+
+// Tallies of the regions visited at a boundary, kept between boundaries so
+// their memory is reused, and the slot of each region among them
+static std::vector<RegionTally> tallies;
+static std::vector<uint32_t> tally_slots;
+
+// Makes every region active, and counts the nodes of each within the lattice
+void ResetCoarseLattice() {
+  coarse_lattice.regions.assign(kCoarseRegionsTot, CoarseRegion{});
+  coarse_lattice.populated_regions.clear();
+  coarse_lattice.coarse_nodes = 0;
+  coarse_lattice.coarse_population = 0;
+  tally_slots.assign(kCoarseRegionsTot, kUntallied);
+  for (uint32_t idx = 0; idx < kCoarseRegionsTot; idx++) {
+    uint32_t nodes = 1;
+    uint32_t remaining = idx;
+    for (int axis = 0; axis < D; axis++) {
+      const uint32_t start =
+          (remaining % kCoarseRegionsPerAxis) * kCoarseLength;
+      nodes *= std::min<uint32_t>(kCoarseLength, X - start);
+      remaining /= kCoarseRegionsPerAxis;
+    }
+    coarse_lattice.regions[idx].nodes = nodes;
+  }
+}
+
+// Returns whether a region's population and allele frequencies are each
+// within tolerance of those at the last boundary
+static bool IsRegionHeld(const CoarseRegion &region, const int64_t population,
+                         const std::array<double, L> &alleles) {
+  if (std::abs(population - region.population) >
+      kCoarseTolerance * static_cast<double>(region.population)) {
+    return false;
+  }
+  for (int bit = 0; bit < L; bit++) {
+    if (std::abs(alleles[bit] - region.alleles[bit]) > kCoarseTolerance) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Moves the nodes of an active region behind the remaining active nodes,
+// making it coarse
+static void CoarsenRegion(const uint32_t region) {
+  const auto active_end = occupied_nodes.end() - coarse_lattice.coarse_nodes;
+  const auto first = std::stable_partition(
+      occupied_nodes.begin(), active_end, [region](const NodeIndex node) {
+        return GetRegionIndex(Lattice::Coordinates(node)) != region;
+      });
+  CoarseRegion &coarsened = coarse_lattice.regions[region];
+  coarse_lattice.coarse_nodes += static_cast<uint32_t>(active_end - first);
+  coarse_lattice.coarse_population += coarsened.population;
+  coarsened.coarse = true;
+  coarsened.coarsened_generation = sim_state.generation;
+}
+
+// Splits a coarse region back into active nodes, moving its nodes ahead of
+// the remaining coarse nodes
+void RefineRegion(const uint32_t region) {
+  const auto active_end = occupied_nodes.end() - coarse_lattice.coarse_nodes;
+  const auto last = std::stable_partition(
+      active_end, occupied_nodes.end(), [region](const NodeIndex node) {
+        return GetRegionIndex(Lattice::Coordinates(node)) == region;
+      });
+  CoarseRegion &refined = coarse_lattice.regions[region];
+  coarse_lattice.coarse_nodes -= static_cast<uint32_t>(last - active_end);
+  coarse_lattice.coarse_population -= refined.population;
+  refined.coarse = false;
+  refined.stable_generations = 0;
+}
+
+// Splits every coarse region back into active nodes, leaving the order of
+// occupied_nodes unchanged
+void RefineAllRegions() {
+  for (uint32_t idx : coarse_lattice.populated_regions) {
+    CoarseRegion &region = coarse_lattice.regions[idx];
+    if (region.coarse) {
+      region.coarse = false;
+      region.stable_generations = 0;
+    }
+  }
+  coarse_lattice.coarse_nodes = 0;
+  coarse_lattice.coarse_population = 0;
+}
+
+// Returns the tally of a region, starting an empty one if it has none
+static RegionTally &GetTally(const uint32_t region) {
+  uint32_t &slot = tally_slots[region];
+  if (slot == kUntallied) {
+    slot = static_cast<uint32_t>(tallies.size());
+    tallies.push_back({region, 0, 0, 0.0, {}});
+  }
+
+  return tallies[slot];
+}
+
+// Aggregates the active nodes of each region, coarsening regions that have
+// stayed saturated and stable, then refines coarse regions due a refresh.
+// Only the regions of active nodes and the regions populated at the last
+// boundary, which include every coarse region, are visited. Called at
+// generation boundaries
+void UpdateCoarseRegions() {
+  tallies.clear();
+  const size_t active_nodes = GetActiveNodeCount();
+  for (size_t idx = 0; idx < active_nodes; idx++) {
+    const Node &node = *FindNode(occupied_nodes[idx]);
+    RegionTally &tally = GetTally(GetRegionIndex(node.coords));
+    tally.occupied++;
+    tally.population += node.population;
+    tally.mu += node.mu;
+    for (Genotype genotype : node.existent_genotypes) {
+      for (int bit = 0; bit < L; bit++) {
+        if ((genotype >> bit) & 1) {
+          tally.alleles[bit] += node.genotype_counts[genotype];
+        }
+      }
+    }
+  }
+  for (uint32_t region : coarse_lattice.populated_regions) {
+    GetTally(region);
+  }
+
+  // Regions are updated in ascending order, so which regions coarsen
+  // doesn't depend on the order their nodes were tallied in
+  std::sort(tallies.begin(), tallies.end(),
+            [](const RegionTally &a, const RegionTally &b) {
+              return a.region < b.region;
+            });
+  int64_t active_population = GetActivePopulation();
+  coarse_lattice.populated_regions.clear();
+  for (RegionTally &tally : tallies) {
+    tally_slots[tally.region] = kUntallied;
+    CoarseRegion &region = coarse_lattice.regions[tally.region];
+    if (region.coarse) {
+      coarse_lattice.populated_regions.push_back(tally.region);
+      continue;
+    }
+
+    for (double &allele : tally.alleles) {
+      allele /= std::max<int64_t>(tally.population, 1);
+    }
+    const bool stable = tally.occupied == region.nodes &&
+                        IsRegionHeld(region, tally.population, tally.alleles);
+    region.stable_generations = stable ? region.stable_generations + 1 : 0;
+    region.population = tally.population;
+    region.mu = tally.occupied != 0 ? tally.mu / tally.occupied : 0.0;
+    region.alleles = tally.alleles;
+    if (region.population != 0) {
+      coarse_lattice.populated_regions.push_back(tally.region);
+    }
+
+    // Coarsen the region, unless no active individuals would remain
+    if (region.stable_generations >= kCoarseStableGenerations &&
+        active_population > region.population) {
+      active_population -= region.population;
+      CoarsenRegion(tally.region);
+    }
+  }
+
+  // Refine coarse regions due a refresh for a generation. One more stable
+  // boundary coarsens them again
+  for (uint32_t idx : coarse_lattice.populated_regions) {
+    CoarseRegion &region = coarse_lattice.regions[idx];
+    if (region.coarse && sim_state.generation - region.coarsened_generation >=
+                             kCoarseRefreshGenerations) {
+      RefineRegion(idx);
+      region.stable_generations = kCoarseStableGenerations - 1;
+    }
+  }
+}
@@ -0,0 +1,264 @@
+#include "stn3d/counts.h"
+
+#include <algorithm>
+#include <limits>
+
+// Returns the slot a genotype hashes to
+size_t GenotypeTable::Home(const Genotype genotype) const {
+  return static_cast<size_t>((genotype * 0x9E3779B97F4A7C15ull) >> shift_);
+}
+
+// Returns the slot holding a genotype, or the free slot ending its probe
+size_t GenotypeTable::Locate(const Genotype genotype) const {
+  const size_t mask = slots_.size() - 1;
+  size_t slot = Home(genotype);
+  while (slots_[slot].used && slots_[slot].genotype != genotype) {
+    slot = (slot + 1) & mask;
+  }
+
+  return slot;
+}
+
+// Returns the count of a genotype, zero if it isn't held
+uint32_t GenotypeTable::operator[](const Genotype genotype) const {
+  if (size_ == 0) {
+    return 0;
+  }
+
+  const Slot &slot = slots_[Locate(genotype)];
+
+  return slot.used ? slot.count : 0;
+}
+
+// Returns the count of a genotype for writing, inserting a zero count if it
+// isn't held. The reference is invalidated by the next insertion
+uint32_t &GenotypeTable::operator[](const Genotype genotype) {
+  if (2 * (size_ + 1) > slots_.size()) {
+    Grow();
+  }
+  Slot &slot = slots_[Locate(genotype)];
+  if (!slot.used) {
+    slot = {genotype, 0, true};
+    size_++;
+  }
+
+  return slot.count;
+}
+
+// Removes a genotype, shifting back any later entries of its probe sequence
+void GenotypeTable::Erase(const Genotype genotype) {
+  if (size_ == 0) {
+    return;
+  }
+  const size_t mask = slots_.size() - 1;
+  size_t hole = Locate(genotype);
+  if (!slots_[hole].used) {
+    return;
+  }
+  slots_[hole].used = false;
+  size_--;
+
+  // Move each later entry into the hole unless it would then precede its home
+  for (size_t slot = (hole + 1) & mask; slots_[slot].used;
+       slot = (slot + 1) & mask) {
+    const size_t home = Home(slots_[slot].genotype);
+    if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+      slots_[hole] = slots_[slot];
+      slots_[slot].used = false;
+      hole = slot;
+    }
+  }
+}
+
+// Removes every genotype, keeping the storage
+void GenotypeTable::Clear() {
+  for (Slot &slot : slots_) {
+    slot.used = false;
+  }
+  size_ = 0;
+}
+
+// Doubles the slots, reinserting every entry
+void GenotypeTable::Grow() {
+  std::vector<Slot> previous(std::max<size_t>(8, 2 * slots_.size()),
+                             {0, 0, false});
+  previous.swap(slots_);
+  shift_ = 64;
+  for (size_t slots = slots_.size(); slots > 1; slots /= 2) {
+    shift_--;
+  }
+  for (const Slot &slot : previous) {
+    if (slot.used) {
+      slots_[Locate(slot.genotype)] = slot;
+    }
+  }
+}
+
+// Returns the counts array of the given counter width
+template <>
+std::vector<uint8_t> &GenotypeCounts::Counts<uint8_t>() {
+  return counts_8_;
+}
+
+template <>
+std::vector<uint16_t> &GenotypeCounts::Counts<uint16_t>() {
+  return counts_16_;
+}
+
+template <>
+std::vector<uint32_t> &GenotypeCounts::Counts<uint32_t>() {
+  return counts_32_;
+}
+
+// Copies the counts into the next wider array and frees the narrower one
+template <typename From, typename To>
+void GenotypeCounts::Promote() {
+  std::vector<From> &from = Counts<From>();
+  Counts<To>().assign(from.begin(), from.end());
+  std::vector<From>().swap(from);
+  width_ = sizeof(To);
+}
+
+// Starts with all counts zero and no storage
+GenotypeCounts::GenotypeCounts() : width_(0) {}
+
+// Returns the count of a genotype
+int GenotypeCounts::operator[](const Genotype genotype) const {
+  if (SPARSE_COUNTS) {
+    return static_cast<int>(sparse_[genotype]);
+  }
+  if (width_ == 0) {
+    return 0;
+  }
+
+  return Visit([genotype](const auto &counts) {
+    return static_cast<int>(counts[genotype]);
+  });
+}
+
+// Increments the count of a genotype, promoting the counter width if the
+// count would otherwise overflow
+void GenotypeCounts::Increment(const Genotype genotype) {
+  if (SPARSE_COUNTS) {
+    sparse_[genotype]++;
+    return;
+  }
+  switch (width_) {
+    case 0:
+      Allocate();
+      counts_8_[genotype]++;
+      return;
+    case sizeof(uint8_t):
+      if (counts_8_[genotype] < std::numeric_limits<uint8_t>::max()) {
+        counts_8_[genotype]++;
+        return;
+      }
+      Promote<uint8_t, uint16_t>();
+      counts_16_[genotype]++;
+      return;
+    case sizeof(uint16_t):
+      if (counts_16_[genotype] < std::numeric_limits<uint16_t>::max()) {
+        counts_16_[genotype]++;
+        return;
+      }
+      Promote<uint16_t, uint32_t>();
+      counts_32_[genotype]++;
+      return;
+    default:
+      counts_32_[genotype]++;
+      return;
+  }
+}
+
+// Decrements the count of a genotype, which must be positive
+void GenotypeCounts::Decrement(const Genotype genotype) {
+  if (SPARSE_COUNTS) {
+    if (--sparse_[genotype] == 0) {
+      sparse_.Erase(genotype);
+    }
+    return;
+  }
+  switch (width_) {
+    case sizeof(uint8_t):
+      counts_8_[genotype]--;
+      return;
+    case sizeof(uint16_t):
+      counts_16_[genotype]--;
+      return;
+    default:
+      counts_32_[genotype]--;
+      return;
+  }
+}
+
+// Sets the count of a genotype, promoting as many widths as needed
+void GenotypeCounts::Set(const Genotype genotype, const int count) {
+  const auto value = static_cast<uint32_t>(count);
+  if (SPARSE_COUNTS) {
+    if (value == 0) {
+      sparse_.Erase(genotype);
+    } else {
+      sparse_[genotype] = value;
+    }
+    return;
+  }
+  if (width_ == 0) {
+    Allocate();
+  }
+  if (width_ == sizeof(uint8_t) &&
+      value > std::numeric_limits<uint8_t>::max()) {
+    Promote<uint8_t, uint16_t>();
+  }
+  if (width_ == sizeof(uint16_t) &&
+      value > std::numeric_limits<uint16_t>::max()) {
+    Promote<uint16_t, uint32_t>();
+  }
+
+  switch (width_) {
+    case sizeof(uint8_t):
+      counts_8_[genotype] = static_cast<uint8_t>(value);
+      return;
+    case sizeof(uint16_t):
+      counts_16_[genotype] = static_cast<uint16_t>(value);
+      return;
+    default:
+      counts_32_[genotype] = value;
+      return;
+  }
+}
+
+// Zeroes all counts, keeping the current width
+void GenotypeCounts::Clear() {
+  if (SPARSE_COUNTS) {
+    sparse_.Clear();
+    return;
+  }
+  switch (width_) {
+    case 0:
+      return;
+    case sizeof(uint8_t):
+      counts_8_.assign(GENOTYPES_TOT, 0);
+      return;
+    case sizeof(uint16_t):
+      counts_16_.assign(GENOTYPES_TOT, 0);
+      return;
+    default:
+      counts_32_.assign(GENOTYPES_TOT, 0);
+      return;
+  }
+}
+
+// Allocates zeroed single byte counters
+void GenotypeCounts::Allocate() {
+  counts_8_.assign(GENOTYPES_TOT, 0);
+  width_ = sizeof(uint8_t);
+}
+
+// Returns the heap memory held by the counters
+size_t GenotypeCounts::Bytes() const {
+  if (SPARSE_COUNTS) {
+    return sparse_.Bytes();
+  }
+
+  return static_cast<size_t>(GENOTYPES_TOT) * width_;
+}
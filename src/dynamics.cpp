@@ -1,13 +1,30 @@
 #include "stn3d/dynamics.h"
 
 #include <algorithm>
+#include <iomanip>
 #include <iostream>
 #include <random>
 
+#include "stn3d/acceptance.h"
+#include "stn3d/aggregates.h"
+#include "stn3d/archive.h"
+#include "stn3d/chunks.h"
+#include "stn3d/coarse.h"
+#include "stn3d/events.h"
+#include "stn3d/landscape.h"
+#include "stn3d/lineage.h"
+#include "stn3d/snapshot.h"
+#include "stn3d/stencil.h"
+#include "stn3d/trace.h"
+#include "stn3d/treatment.h"
 #include "stn3d/util.h"
 
+Engine engine = ENGINE;
+SimState sim_state;
+
 // Calculates J(a,b): the strength of the interaction between genotypes a and b
-double GetInteractionStrength(const int genotype_a, const int genotype_b) {
+double GetInteractionStrength(const Genotype genotype_a,
+                              const Genotype genotype_b) {
   double jab = 0.0;
 
   // Jab = 0 for a = b
@@ -16,7 +33,10 @@ double GetInteractionStrength(const int genotype_a, const int genotype_b) {
   }
 
   // Interaction strengths are equal A1[z]A2[b] with probability theta
-  const int z = genotype_a ^ genotype_b;
+  const Genotype z = genotype_a ^ genotype_b;
+  if (INTERACTIONS == Interactions::kHashed) {
+    return GetHashedB(z) ? GetHashedA1(z) * GetHashedA2(genotype_b) : jab;
+  }
   if (arr_b[z]) {
     jab = arr_a1[z] * arr_a2[genotype_b];
   }
@@ -24,79 +44,98 @@ double GetInteractionStrength(const int genotype_a, const int genotype_b) {
   return jab;
 }
 
+// Returns the genotype of an offspring of a parent genotype, whose 'genes' are
+// each mutated (bitflipped) with probability PMUT. Gene idx of the parent is
+// bit idx, and becomes bit L - 1 - idx of the offspring
+Genotype MutateGenotype(const Genotype parent) {
+  Genotype offspring = 0;
+  for (int idx = 0; idx < L; idx++) {
+    Genotype gene = (parent >> idx) & 1;
+
+    if (UniformRealInRange(0, 1) <= PMUT) {
+      gene ^= 1;
+    }
+
+    offspring |= gene << (L - 1 - idx);
+  }
+
+  return offspring;
+}
+
 // Attempts reproduction of a randomly chosen individual, and returns that
 // individual regardless of the result
-int Reproduce(std::array<int, GENOTYPES_TOT> &g_counts,
-              std::vector<int> &existent, int &N, const double mu) {
+int Reproduce(GenotypeCounts &g_counts, std::vector<Genotype> &existent,
+              int &N, const double mu, const NodeIndex node) {
   // Randomly choose an individual (an existent genotype occupying the node)
   const int existent_size = static_cast<int>(existent.size());
   const int existent_idx = UniformIntInRange(0, existent_size - 1);
-  const int individual = existent[existent_idx];
+  const Genotype individual = existent[existent_idx];
 
   // Calculate the sum component of H for the chosen individual
-  double t1 = 0.0;
-  double jab;
-  for (int idx = 0; idx < existent_size; idx++) {
-    jab = GetInteractionStrength(individual, existent[idx]);
-    t1 += jab * g_counts[existent[idx]];
-  }
+  const double t1 = g_counts.Visit([&](const auto &counts) {
+    double sum = 0.0;
+    double jab;
+    for (int idx = 0; idx < existent_size; idx++) {
+      jab = GetInteractionStrength(individual, existent[idx]);
+      sum += jab * counts[existent[idx]];
+    }
+    return sum;
+  });
 
-  // Calculate the weight function (H) and poff
+  // Calculate the weight function (H)
   const double weight_function = ((C_R * t1) / N) - (mu * N);
-  const double poff = 1 / (1 + exp(-weight_function));
 
-  // Try to reproduce the chosen individual
-  int offspring = 0;
-  std::bitset<L> genotype_bitstring = {0};
-  if (UniformRealInRange(0, 1) <= poff) {
+  // Try to reproduce the chosen individual with probability poff
+  if (AcceptReproduction(weight_function, UniformRealInRange(0, 1))) {
     N++;
 
-    for (int idx = 0; idx < L; idx++) {
-      genotype_bitstring[idx] = genotype_bitsets[individual][idx];
-
-      // The offsprings 'genes' are mutated (bitflipped) with probability PMUT
-      if (UniformRealInRange(0, 1) <= PMUT) {
-        genotype_bitstring[idx] = ~genotype_bitstring[idx];
-      }
-
-      if (genotype_bitstring[idx]) {
-        offspring += (1 << (L - 1 - idx));
-      }
+    const Genotype offspring = MutateGenotype(individual);
+    if (trace_recording) {
+      TraceBirth(node, individual, offspring);
     }
 
     // Check for novel offspring
-    if (g_counts[offspring] == 0) {
+    const bool novel = g_counts[offspring] == 0;
+    if (novel) {
       existent.push_back(offspring);
+      if (TRACK_LINEAGE) {
+        RecordMutation(node, individual, offspring);
+      }
     }
 
-    g_counts[offspring]++;
+    g_counts.Increment(offspring);
+    AddToAggregates(offspring, novel);
   }
 
   return existent_idx;
 }
 
 // Attempts annihilation of a specified individual
-bool Annihilate(std::array<int, GENOTYPES_TOT> &g_counts,
-                std::vector<int> &existent, int &N, const int existent_idx,
-                const LatticeCoord i, const LatticeCoord j,
-                const LatticeCoord k) {
+bool Annihilate(GenotypeCounts &g_counts, std::vector<Genotype> &existent,
+                int &N, const int existent_idx, const NodeIndex node) {
   if (UniformRealInRange(0, 1) <= PKILL) {
     N--;
 
-    int individual = existent[existent_idx];
-    g_counts[individual]--;
+    const Genotype individual = existent[existent_idx];
+    if (trace_recording) {
+      TraceDeath(node, individual);
+    }
+    g_counts.Decrement(individual);
+    RemoveFromAggregates(individual, g_counts[individual] == 0);
 
     if (g_counts[individual] == 0) {
       // Chosen genotype is extinct, so remove from the nodes existent vector
       existent.erase(existent.begin() + existent_idx);
+      if (TRACK_LINEAGE) {
+        RecordExtinction(node, individual);
+      }
 
       // If the node has become empty, remove it from the occupied_nodes vector
       if (N == 0) {
-        const LatticePoint lattice_point =
-            i + ((static_cast<char>(j)) << 8) + ((static_cast<char>(k)) << 16);
-        auto vec_iter = std::find(occupied_nodes.begin(), occupied_nodes.end(),
-                                  lattice_point);
+        auto vec_iter =
+            std::find(occupied_nodes.begin(), occupied_nodes.end(), node);
         occupied_nodes.erase(vec_iter);
+        RefineIfNoneActive();
       }
     }
 
@@ -107,146 +146,245 @@ bool Annihilate(std::array<int, GENOTYPES_TOT> &g_counts,
 }
 
 // Attempts migration of a specified individual
-void Migrate(std::vector<LatticePoint> &neighbours,
-             std::array<int, GENOTYPES_TOT> &g_counts,
-             std::vector<int> &existent, int &N, int existent_idx,
-             const LatticeCoord i, const LatticeCoord j, const LatticeCoord k) {
-  if (UniformRealInRange(0, 1) <= PMOVE) {
+void Migrate(GenotypeCounts &g_counts, std::vector<Genotype> &existent,
+             int &N, int existent_idx, const NodeIndex node) {
+  if (!IsMigrationBlocked() && UniformRealInRange(0, 1) <= PMOVE) {
     N--;
 
-    const int individual = existent[existent_idx];
-    g_counts[individual]--;
+    const Genotype individual = existent[existent_idx];
+    g_counts.Decrement(individual);
+    RemoveFromAggregates(individual, g_counts[individual] == 0);
+    const uint32_t lineage =
+        TRACK_LINEAGE ? GetCloneLineage(node, individual) : kLineageRoot;
 
     // Check if the migrated genotype is now extinct at the origin lattice point
-    LatticePoint lattice_point;
     if (g_counts[individual] == 0) {
       existent.erase(existent.begin() + existent_idx);
+      if (TRACK_LINEAGE) {
+        RecordExtinction(node, individual);
+      }
 
       // Remove the genotype from occupied_nodes if the node population is zero
       if (N == 0) {
-        lattice_point =
-            i + ((static_cast<char>(j)) << 8) + ((static_cast<char>(k)) << 16);
         auto vec_iter =
-            find(occupied_nodes.begin(), occupied_nodes.end(), lattice_point);
+            find(occupied_nodes.begin(), occupied_nodes.end(), node);
         occupied_nodes.erase(vec_iter);
+        RefineIfNoneActive();
       }
     }
 
-    // Randomly choose a neighbouring lattice point of (i, j, k)
-    const uint32_t neighbours_index =
-        UniformIntInRange(0, static_cast<int>(neighbours.size()) - 1);
-    lattice_point = neighbours[neighbours_index];
-    LatticeCoord i_coord = GetCoordinate(lattice_point, 1);
-    LatticeCoord j_coord = GetCoordinate(lattice_point, 2);
-    LatticeCoord k_coord = GetCoordinate(lattice_point, 3);
-
-    // If the destination lattice point is empty, add it to occupied_nodes
-    if ((*nodes[i_coord][j_coord][k_coord]).population == 0) {
-      occupied_nodes.push_back(lattice_point);
+    // Randomly choose a destination from the stencil of the node
+    const NodeIndex destination =
+        GetNeighbour(node, UniformIntInRange(0, stencil_size - 1));
+    if (trace_recording) {
+      TraceMigration(node, individual, destination);
+    }
+
+    // Individuals crossing an absorbing boundary leave the lattice
+    if (destination == kAbsorbed) {
+      return;
+    }
+    RefineNodeRegion(destination);
+    Node &destination_node = GetNode(destination);
+
+    // If the destination node is empty, add it to occupied_nodes
+    if (destination_node.population == 0) {
+      AddOccupiedNode(destination);
     }
 
-    (*nodes[i_coord][j_coord][k_coord]).population++;
+    destination_node.population++;
 
     // Add the migrating species to the existent_genotypes vector if the
     // desination node doesn't already contain it
-    if ((*nodes[i_coord][j_coord][k_coord]).genotype_counts[individual] == 0) {
-      (*nodes[i_coord][j_coord][k_coord])
-          .existent_genotypes.push_back(individual);
+    const bool founded = destination_node.genotype_counts[individual] == 0;
+    if (founded) {
+      destination_node.existent_genotypes.push_back(individual);
+      if (TRACK_LINEAGE) {
+        RecordClone(destination, individual, lineage);
+      }
     }
 
     // Increase the desination node species count of the migrated individual
-    (*nodes[i_coord][j_coord][k_coord]).genotype_counts[individual]++;
+    destination_node.genotype_counts.Increment(individual);
+    AddToAggregates(individual, founded);
   }
 }
 
-// Starts a new simulation loop using specified parameters
-void SimLoop(LatticeCoord i_selection, LatticeCoord j_selection,
-             LatticeCoord k_selection) {
-  std::cout << "Lattice size: " << X << "x" << X << "\n"
-            << "Generations: " << GENERATIONS_TOT << "\n"
-            << "Starting population: " << N_0 << "\n"
-            << "Starting coordinates: (" << static_cast<int>(i_selection)
-            << ", " << static_cast<int>(j_selection) << ", "
-            << static_cast<int>(k_selection) << ")\n"
-            << "Generations completed:" << std::endl;
-
+// Opens the population log and, if enabled, the trajectory archive, which
+// starts with the initial state of the lattice, the snapshot segment and the
+// event trace
+void OpenRunOutputs() {
   // Write total population size by generation to a logfile
-  std::ofstream population_log;
   population_log.open("out/population_log.txt");
 
-  int gen_count = 0;
-  int step = 0;
-  int individual;
-  int n_tot;
-  LatticePoint lattice_point;
-  bool annihilated;
-
-  // Inital calculation of tau: the number of steps comprising one generation
-  double tau =
-      round(double((*nodes[i_selection][j_selection][k_selection]).population) /
-            PKILL);
-
-  while (gen_count < GENERATIONS_TOT) {
-    step++;
-
-    lattice_point = GetOccupiedNode();
-    i_selection = GetCoordinate(lattice_point, 1);
-    j_selection = GetCoordinate(lattice_point, 2);
-    k_selection = GetCoordinate(lattice_point, 3);
-
-    individual = Reproduce(
-        (*nodes[i_selection][j_selection][k_selection]).genotype_counts,
-        (*nodes[i_selection][j_selection][k_selection]).existent_genotypes,
-        (*nodes[i_selection][j_selection][k_selection]).population,
-        (*nodes[i_selection][j_selection][k_selection]).mu);
-
-    annihilated = Annihilate(
-        (*nodes[i_selection][j_selection][k_selection]).genotype_counts,
-        (*nodes[i_selection][j_selection][k_selection]).existent_genotypes,
-        (*nodes[i_selection][j_selection][k_selection]).population, individual,
-        i_selection, j_selection, k_selection);
-
-    if (!annihilated) {
-      Migrate(
-          (*nodes[i_selection][j_selection][k_selection]).neighbours,
-          (*nodes[i_selection][j_selection][k_selection]).genotype_counts,
-          (*nodes[i_selection][j_selection][k_selection]).existent_genotypes,
-          (*nodes[i_selection][j_selection][k_selection]).population,
-          individual, i_selection, j_selection, k_selection);
-    }
+  // Archive the genotype counts of every node
+  if (WRITE_ARCHIVE) {
+    OpenTrajectoryArchive("out/trajectory.stn");
+    AppendArchiveGeneration();
+  }
+
+  // Publish live snapshots for monitors
+  if (SNAPSHOT_SEGMENT[0] != '\0' && !OpenSnapshotSegment(SNAPSHOT_SEGMENT)) {
+    std::cout << "Unable to open snapshot segment " << SNAPSHOT_SEGMENT
+              << std::endl;
+  }
+
+  // Record every event for replay
+  if (EVENT_TRACE_FILE[0] != '\0' && !OpenEventTrace(EVENT_TRACE_FILE)) {
+    std::cout << "Unable to open event trace " << EVENT_TRACE_FILE
+              << std::endl;
+  }
+}
 
-    // Housekeeping at the end of each generation
-    if (step == tau) {
-      gen_count++;
-      step = 0;
-
-      // Log the existent species of each node
-      n_tot = 0;
-      for (int i = 0; i < X; i++) {
-        for (int j = 0; j < X; j++) {
-          for (int k = 0; k < X; k++) {
-            for (int genotype : (*nodes[i][j][k]).existent_genotypes) {
-              (*outfiles[i][j][k]) << genotype << "\t";
-            }
-            (*outfiles[i][j][k]) << std::endl;
-
-            n_tot = n_tot + (*nodes[i][j][k]).population;
-          }
+// Starts a simulation from the population initialised on a node, calculating
+// tau: the number of steps comprising the first generation
+void BeginSimulation(const NodeIndex start) {
+  sim_state.generation = 0;
+  sim_state.step = 0;
+  sim_state.population = GetNode(start).population;
+  sim_state.tau = round(double(sim_state.population) / PKILL);
+  sim_state.time = 0.0;
+  sim_state.clock = 0.0;
+
+  if (engine == Engine::kNextReaction) {
+    BuildEventQueue();
+  }
+  if (trace_recording) {
+    WriteTraceKeyframe();
+  }
+  PublishSnapshot();
+}
+
+// Selects the engine used by StepSimulation. Takes effect from the next call
+// to BeginSimulation
+void SetEngine(const Engine simulation_engine) { engine = simulation_engine; }
+
+// Performs one step: reproduction, annihilation and migration of an
+// individual on an occupied node, followed by housekeeping if the step
+// completes a generation. The next-reaction engine instead fires the next
+// event. Returns false without stepping if the population is extinct
+bool StepSimulation() {
+  if (engine == Engine::kNextReaction) {
+    return StepEvent();
+  }
+  if (occupied_nodes.empty()) {
+    return false;
+  }
+  sim_state.step++;
+  sim_state.time = sim_state.generation + (sim_state.step / sim_state.tau);
+
+  const NodeIndex selection = GetOccupiedNode();
+  Node &node = GetNode(selection);
+
+  const int individual =
+      Reproduce(node.genotype_counts, node.existent_genotypes,
+                node.population, node.mu, selection);
+
+  const bool annihilated =
+      Annihilate(node.genotype_counts, node.existent_genotypes,
+                 node.population, individual, selection);
+
+  if (!annihilated) {
+    Migrate(node.genotype_counts, node.existent_genotypes, node.population,
+            individual, selection);
+  }
+
+  if (sim_state.step == sim_state.tau) {
+    EndGeneration();
+  }
+
+  return true;
+}
+
+// Housekeeping at the end of each generation: logs the state of the lattice
+// to any open outputs, applies treatments due at the start of the next,
+// updates coarse regions and recalculates tau
+void EndGeneration() {
+  sim_state.generation++;
+  sim_state.step = 0;
+  if (trace_recording) {
+    TraceGenerationEnd();
+  }
+
+  // Log the existent species of each node
+  if (!outfiles.empty()) {
+    for (NodeIndex idx = 0; idx < kNodesTot; idx++) {
+      if (const Node *logged = FindNode(idx)) {
+        for (Genotype genotype : logged->existent_genotypes) {
+          (*outfiles[idx]) << genotype << "\t";
         }
       }
+      (*outfiles[idx]) << std::endl;
+    }
+  }
+
+  sim_state.population = static_cast<int>(aggregates.population);
+
+  // Log population size against generation count. Event driven runs also
+  // log the time stamp of the last event, at which the state was reached
+  if (population_log.is_open()) {
+    population_log << sim_state.generation << "\t" << sim_state.population;
+    if (engine == Engine::kNextReaction) {
+      population_log << "\t" << std::setprecision(12) << sim_state.time
+                     << "\t" << sim_state.clock;
+    }
+    population_log << std::endl;
+  }
+  AppendArchiveGeneration();
+  PublishSnapshot();
+  ApplyDueTreatments();
+
+  // Free the memory of chunks the population has left, and of lineages
+  // without living descendants
+  if (SPARSE_LATTICE) {
+    ReleaseEmptyChunks();
+  }
+  if (TRACK_LINEAGE) {
+    MaybeCompactLineage();
+  }
+
+  // Coarse-grain stable regions, then recalculate tau over the active nodes,
+  // taking at least one step
+  if (ADAPTIVE_RESOLUTION && engine == Engine::kSteps) {
+    UpdateCoarseRegions();
+  }
+  sim_state.tau = std::max(1.0, round(double(GetActivePopulation()) / PKILL));
+}
 
-      // Log population size against generation count
-      population_log << gen_count << "\t" << n_tot << std::endl;
+// Starts a new simulation loop using specified parameters
+void SimLoop(const NodeIndex selection) {
+  std::cout << "Lattice size: " << X;
+  for (int axis = 1; axis < D; axis++) {
+    std::cout << "x" << X;
+  }
+  std::cout << "\n"
+            << "Generations: " << GENERATIONS_TOT << "\n"
+            << "Starting population: " << N_0 << "\n"
+            << "Starting coordinates: (";
+  for (int axis = 0; axis < D; axis++) {
+    std::cout << (axis ? ", " : "")
+              << static_cast<int>(Lattice::Coordinates(selection)[axis]);
+  }
+  std::cout << ")\n"
+            << "Generations completed:" << std::endl;
 
-      // Recalculate tau
-      tau = round(double(n_tot) / PKILL);
+  OpenRunOutputs();
+  BeginSimulation(selection);
+  int reported_generation = 0;
+  while (sim_state.generation < GENERATIONS_TOT) {
+    if (!StepSimulation()) {
+      std::cout << "Total extinction." << std::endl;
+      return;
+    }
 
-      if (gen_count % (std::max(GENERATIONS_TOT / 100, 1)) == 0) {
-        std::cout << gen_count << std::endl;
+    // Report progress, once per completed generation at most
+    if (sim_state.generation != reported_generation) {
+      reported_generation = sim_state.generation;
+      if (reported_generation % (std::max(GENERATIONS_TOT / 100, 1)) == 0) {
+        std::cout << reported_generation << std::endl;
       }
     }
   }
 
   std::cout << "All generations passed without extinction." << std::endl;
-  population_log.close();
-}
\ No newline at end of file
+}
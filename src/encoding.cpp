@@ -0,0 +1,34 @@
+#include "stn3d/encoding.h"
+
+// Appends an unsigned integer to a buffer as a little-endian base 128 varint,
+// seven bits per byte with the high bit flagging continuation
+void AppendVarint(std::vector<uint8_t> &buffer, uint64_t value) {
+  while (value >= 0x80) {
+    buffer.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  buffer.push_back(static_cast<uint8_t>(value));
+}
+
+// Decodes a varint starting at data and ending before end, and returns a
+// pointer to the next byte. Returns nullptr, with value 0, if the varint runs
+// past end or over kMaxVarintBytes, or if data is nullptr, so a chain of reads
+// only needs checking once at its end
+const uint8_t *ReadVarint(const uint8_t *data, const uint8_t *end,
+                          uint64_t &value) {
+  value = 0;
+  if (data == nullptr) {
+    return nullptr;
+  }
+
+  for (int shift = 0; shift < 7 * kMaxVarintBytes && data < end; shift += 7) {
+    const uint8_t byte = *data++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return data;
+    }
+  }
+  value = 0;
+
+  return nullptr;
+}
@@ -0,0 +1,462 @@
+#include "stn3d/events.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "stn3d/acceptance.h"
+#include "stn3d/aggregates.h"
+#include "stn3d/chunks.h"
+#include "stn3d/dynamics.h"
+#include "stn3d/lineage.h"
+#include "stn3d/stencil.h"
+#include "stn3d/trace.h"
+#include "stn3d/treatment.h"
+
+static constexpr uint32_t kUnscheduled = UINT32_MAX;
+
+// Largest rounding error of a t1 sum left in place at a generation boundary
+static constexpr double kInteractionSumDrift = 1e-9;
+
+// Indexed binary min-heap of the next event time of each occupied node
+static std::vector<EventQueueEntry> event_queue;
+
+// The heap slot of each node, else kUnscheduled, in a page per chunk of the
+// lattice allocated once a node of the chunk is scheduled. Slots are kept
+// apart from the nodes, so moving entries never writes to a chunk shared with
+// a fork (fork.h)
+using EventSlotPage = std::array<uint32_t, kChunkNodes>;
+static std::vector<std::unique_ptr<EventSlotPage>> event_slot_pages;
+
+// Returns the heap slot of a node, allocating its page if needed
+static uint32_t &GetEventSlot(const NodeIndex index) {
+  const ChunkLocation location = LocateNode(index);
+  std::unique_ptr<EventSlotPage> &page = event_slot_pages[location.chunk];
+  if (!page) {
+    page = std::make_unique<EventSlotPage>();
+    page->fill(kUnscheduled);
+  }
+
+  return (*page)[location.offset];
+}
+
+// Stores an entry in a slot of the heap, recording the slot of its node
+static void PlaceEntry(const uint32_t slot, const EventQueueEntry &entry) {
+  event_queue[slot] = entry;
+  GetEventSlot(entry.index) = slot;
+}
+
+// Moves the entry in a slot towards the root until the heap is ordered
+static void SiftUp(uint32_t slot) {
+  const EventQueueEntry entry = event_queue[slot];
+  while (slot > 0) {
+    const uint32_t parent = (slot - 1) / 2;
+    if (event_queue[parent].time <= entry.time) {
+      break;
+    }
+    PlaceEntry(slot, event_queue[parent]);
+    slot = parent;
+  }
+  PlaceEntry(slot, entry);
+}
+
+// Moves the entry in a slot towards the leaves until the heap is ordered
+static void SiftDown(uint32_t slot) {
+  const EventQueueEntry entry = event_queue[slot];
+  const auto size = static_cast<uint32_t>(event_queue.size());
+  while (true) {
+    uint32_t child = (2 * slot) + 1;
+    if (child >= size) {
+      break;
+    }
+    if (child + 1 < size &&
+        event_queue[child + 1].time < event_queue[child].time) {
+      child++;
+    }
+    if (entry.time <= event_queue[child].time) {
+      break;
+    }
+    PlaceEntry(slot, event_queue[child]);
+    slot = child;
+  }
+  PlaceEntry(slot, entry);
+}
+
+// Schedules the next event of a node at an absolute time, replacing any event
+// already scheduled
+static void Schedule(const NodeIndex index, const double time) {
+  const uint32_t slot = GetEventSlot(index);
+  if (slot == kUnscheduled) {
+    event_queue.push_back({time, index});
+    SiftUp(static_cast<uint32_t>(event_queue.size() - 1));
+    return;
+  }
+
+  event_queue[slot].time = time;
+  SiftUp(slot);
+  SiftDown(GetEventSlot(index));
+}
+
+// Removes the scheduled event of a node from the queue
+static void Unschedule(const NodeIndex index) {
+  uint32_t &node_slot = GetEventSlot(index);
+  const uint32_t slot = node_slot;
+  node_slot = kUnscheduled;
+  const EventQueueEntry last = event_queue.back();
+  event_queue.pop_back();
+  if (slot < event_queue.size()) {
+    PlaceEntry(slot, last);
+    SiftUp(slot);
+    SiftDown(GetEventSlot(last.index));
+  }
+}
+
+// Returns t1 for a genotype on a node: the sum of its interactions with every
+// individual on the node
+static double SumInteractions(const Node &node, const Genotype genotype) {
+  return node.genotype_counts.Visit([&](const auto &counts) {
+    double sum = 0.0;
+    for (Genotype other : node.existent_genotypes) {
+      sum += GetInteractionStrength(genotype, other) * counts[other];
+    }
+    return sum;
+  });
+}
+
+// Recalculates the t1 sums of every existent genotype on a node, discarding
+// any rounding accumulated by incremental updates
+static void RefreshInteractionSums(Node &node) {
+  node.interaction_sums.resize(node.existent_genotypes.size());
+  for (size_t idx = 0; idx < node.existent_genotypes.size(); idx++) {
+    node.interaction_sums[idx] =
+        SumInteractions(node, node.existent_genotypes[idx]);
+  }
+}
+
+// Returns the weight function (H) of the nth existent genotype on a node
+static double GetWeightFunction(const Node &node, const size_t existent_idx) {
+  const int N = node.population;
+  return ((C_R * node.interaction_sums[existent_idx]) / N) - (node.mu * N);
+}
+
+// Returns the rate each existent genotype of a node is selected at by the
+// step scheme
+static double GetSelectionRate(const Node &node) {
+  return node.population /
+         (PKILL * static_cast<double>(node.existent_genotypes.size()));
+}
+
+// Returns the rate each individual migrates at
+static double GetMigrationRate() {
+  return IsMigrationBlocked() ? 0.0 : kMigrationRate;
+}
+
+// Returns the probability a selected genotype neither dies nor migrates
+static double GetStayProbability() {
+  return (1.0 - PKILL) * (1.0 - (IsMigrationBlocked() ? 0.0 : PMOVE));
+}
+
+// Returns the total rate of reproduction by selected genotypes that then
+// stay on a node. Those that die or migrate reproduce as their event fires
+double GetReproductionPropensity(const Node &node) {
+  double propensity = 0.0;
+  for (size_t idx = 0; idx < node.existent_genotypes.size(); idx++) {
+    propensity += GetOffspringProbability(GetWeightFunction(node, idx));
+  }
+
+  return GetSelectionRate(node) * GetStayProbability() * propensity;
+}
+
+// Recalculates the propensity of a node and reschedules its next event. A
+// node whose event just fired draws a new waiting time. Otherwise the
+// remaining wait is rescaled by the change in propensity, which keeps the
+// schedule exact without a new draw (Gibson and Bruck)
+static void Reschedule(Node &node, const NodeIndex index, const bool fired) {
+  const double now = sim_state.clock;
+  const double previous = node.propensity;
+  node.propensity =
+      node.population == 0
+          ? 0.0
+          : GetReproductionPropensity(node) +
+                ((kDeathRate + GetMigrationRate()) * node.population);
+
+  const uint32_t slot = GetEventSlot(index);
+  if (node.propensity <= 0.0) {
+    if (slot != kUnscheduled) {
+      Unschedule(index);
+    }
+    return;
+  }
+
+  double time;
+  if (fired || slot == kUnscheduled || previous <= 0.0) {
+    time = now - (log1p(-UniformRealInRange(0, 1)) / node.propensity);
+  } else {
+    time = now + ((previous / node.propensity) *
+                  (event_queue[slot].time - now));
+  }
+  Schedule(index, time);
+}
+
+// Reschedules a node after its rates were changed from outside the engine,
+// such as by an edit to its resources
+void RescheduleNode(const NodeIndex index) {
+  Reschedule(GetNode(index), index, false);
+}
+
+// Recalculates the t1 sums of a node after its counts were changed from
+// outside the engine, such as by a treatment, and reschedules it
+void RefreshNode(const NodeIndex index) {
+  Node &node = GetNode(index);
+  RefreshInteractionSums(node);
+  Reschedule(node, index, false);
+}
+
+// Recalculates the t1 sums of a node at a generation boundary, and
+// reschedules it, if rounding from incremental updates moved any sum by more
+// than kInteractionSumDrift. Other nodes are only read, so the chunks they
+// share with a fork aren't copied
+static void RefreshDriftedNode(const NodeIndex index) {
+  const Node &node = *FindNode(index);
+  for (size_t idx = 0; idx < node.existent_genotypes.size(); idx++) {
+    if (std::abs(SumInteractions(node, node.existent_genotypes[idx]) -
+                 node.interaction_sums[idx]) > kInteractionSumDrift) {
+      RefreshNode(index);
+      return;
+    }
+  }
+}
+
+// Adds an individual of a genotype to a node, updating the t1 sums of the
+// genotypes already present with its interactions
+static void AddIndividual(Node &node, const NodeIndex index,
+                          const Genotype genotype) {
+  if (node.population == 0) {
+    occupied_nodes.push_back(index);
+  }
+  node.population++;
+
+  for (size_t idx = 0; idx < node.existent_genotypes.size(); idx++) {
+    node.interaction_sums[idx] +=
+        GetInteractionStrength(node.existent_genotypes[idx], genotype);
+  }
+
+  const bool founded = node.genotype_counts[genotype] == 0;
+  if (founded) {
+    node.existent_genotypes.push_back(genotype);
+    node.genotype_counts.Increment(genotype);
+    node.interaction_sums.push_back(SumInteractions(node, genotype));
+  } else {
+    node.genotype_counts.Increment(genotype);
+  }
+  AddToAggregates(genotype, founded);
+}
+
+// Removes an individual of the nth existent genotype from a node, returning
+// its genotype
+static Genotype RemoveIndividual(Node &node, const NodeIndex index,
+                                 const size_t existent_idx) {
+  const Genotype genotype = node.existent_genotypes[existent_idx];
+  node.population--;
+  node.genotype_counts.Decrement(genotype);
+  RemoveFromAggregates(genotype, node.genotype_counts[genotype] == 0);
+
+  for (size_t idx = 0; idx < node.existent_genotypes.size(); idx++) {
+    node.interaction_sums[idx] -=
+        GetInteractionStrength(node.existent_genotypes[idx], genotype);
+  }
+
+  if (node.genotype_counts[genotype] == 0) {
+    node.existent_genotypes.erase(node.existent_genotypes.begin() +
+                                  existent_idx);
+    node.interaction_sums.erase(node.interaction_sums.begin() + existent_idx);
+  }
+
+  if (node.population == 0) {
+    occupied_nodes.erase(
+        std::find(occupied_nodes.begin(), occupied_nodes.end(), index));
+  }
+
+  return genotype;
+}
+
+// Returns the existent index of the genotype at a position in [0, N), when
+// the range is split evenly between the existent genotypes
+static size_t FindGenotype(const Node &node, const double position) {
+  const size_t existent_size = node.existent_genotypes.size();
+  const auto idx = static_cast<size_t>(position * existent_size /
+                                       node.population);
+
+  return std::min(idx, existent_size - 1);
+}
+
+// Returns the existent index of the genotype to reproduce, given a position in
+// [0, reproduction propensity)
+static size_t FindParent(const Node &node, const double position) {
+  const double rate = GetSelectionRate(node) * GetStayProbability();
+  double cumulative = 0.0;
+  const size_t existent_size = node.existent_genotypes.size();
+  for (size_t idx = 0; idx + 1 < existent_size; idx++) {
+    cumulative +=
+        rate * GetOffspringProbability(GetWeightFunction(node, idx));
+    if (position < cumulative) {
+      return idx;
+    }
+  }
+
+  return existent_size - 1;
+}
+
+// Adds an offspring of the nth existent genotype of a node
+static void AddOffspring(Node &node, const NodeIndex index,
+                         const size_t parent_idx) {
+  const Genotype parent = node.existent_genotypes[parent_idx];
+  const Genotype offspring = MutateGenotype(parent);
+  if (trace_recording) {
+    TraceBirth(index, parent, offspring);
+  }
+  const bool novel = node.genotype_counts[offspring] == 0;
+  AddIndividual(node, index, offspring);
+  if (TRACK_LINEAGE && novel) {
+    RecordMutation(index, parent, offspring);
+  }
+}
+
+// Lets a genotype selected to die or migrate reproduce first with
+// probability poff(H), as the step engine does
+static void TryReproduce(Node &node, const NodeIndex index,
+                         const size_t existent_idx) {
+  if (AcceptReproduction(GetWeightFunction(node, existent_idx),
+                         UniformRealInRange(0, 1))) {
+    AddOffspring(node, index, existent_idx);
+  }
+}
+
+// Schedules the next event of every occupied node, from the current time
+void BuildEventQueue() {
+  event_queue.clear();
+  event_slot_pages.clear();
+  event_slot_pages.resize(kChunksTot);
+  for (NodeIndex index : occupied_nodes) {
+    Node &node = GetNode(index);
+    node.propensity = 0.0;
+    RefreshInteractionSums(node);
+    Reschedule(node, index, true);
+  }
+}
+
+// Fires the earliest scheduled event: a death, migration or reproduction on
+// its node. If the event falls after the end of the current generation, that
+// generation is completed instead, recording the state reached at the last
+// event. Returns false if the population is extinct
+bool StepEvent() {
+  if (event_queue.empty()) {
+    return false;
+  }
+  const EventQueueEntry next = event_queue.front();
+
+  // The heap runs on the clock, at N / PKILL selections per unit. A
+  // generation is tau selections, as in the step engine, so converting the
+  // wait to generations slows time as N falls below the N that set tau
+  const double selections_per_unit = aggregates.population / PKILL;
+  const double time =
+      sim_state.time + ((next.time - sim_state.clock) * selections_per_unit /
+                        sim_state.tau);
+  if (time >= sim_state.generation + 1) {
+    const double boundary_clock =
+        sim_state.clock + ((sim_state.generation + 1 - sim_state.time) *
+                           sim_state.tau / selections_per_unit);
+    EndGeneration();
+    sim_state.time = sim_state.generation;
+    sim_state.clock = boundary_clock;
+    for (NodeIndex index : occupied_nodes) {
+      RefreshDriftedNode(index);
+    }
+    return true;
+  }
+  sim_state.time = time;
+  sim_state.clock = next.time;
+  sim_state.step++;
+
+  // Nodes are resolved by index for writing, as their chunk may be shared
+  const NodeIndex index = next.index;
+  Node &node = GetNode(index);
+  const int N = node.population;
+  const double position = UniformRealInRange(0, 1) * node.propensity;
+  const double migration_rate = GetMigrationRate();
+
+  if (position < kDeathRate * N) {
+    const size_t dead_idx = FindGenotype(node, position / kDeathRate);
+    TryReproduce(node, index, dead_idx);
+    const Genotype dead = RemoveIndividual(node, index, dead_idx);
+    if (trace_recording) {
+      TraceDeath(index, dead);
+    }
+    if (TRACK_LINEAGE && node.genotype_counts[dead] == 0) {
+      RecordExtinction(index, dead);
+    }
+  } else if (position < (kDeathRate + migration_rate) * N) {
+    const double migrant_position =
+        (position - (kDeathRate * N)) / migration_rate;
+    const size_t migrant_idx = FindGenotype(node, migrant_position);
+    TryReproduce(node, index, migrant_idx);
+    const uint32_t lineage =
+        TRACK_LINEAGE
+            ? GetCloneLineage(index, node.existent_genotypes[migrant_idx])
+            : kLineageRoot;
+    const Genotype migrant = RemoveIndividual(node, index, migrant_idx);
+    if (TRACK_LINEAGE && node.genotype_counts[migrant] == 0) {
+      RecordExtinction(index, migrant);
+    }
+
+    // Individuals crossing an absorbing boundary leave the lattice
+    const NodeIndex destination =
+        GetNeighbour(index, UniformIntInRange(0, stencil_size - 1));
+    if (trace_recording) {
+      TraceMigration(index, migrant, destination);
+    }
+    if (destination != kAbsorbed) {
+      Node &destination_node = GetNode(destination);
+      const bool founded = destination_node.genotype_counts[migrant] == 0;
+      AddIndividual(destination_node, destination, migrant);
+      if (TRACK_LINEAGE && founded) {
+        RecordClone(destination, migrant, lineage);
+      }
+      Reschedule(destination_node, destination, false);
+    }
+  } else {
+    AddOffspring(node, index,
+                 FindParent(node,
+                            position - ((kDeathRate + migration_rate) * N)));
+  }
+  Reschedule(node, index, true);
+
+  return true;
+}
+
+// Returns the whole heap, so it can be saved by a fork
+const std::vector<EventQueueEntry> &GetEventQueue() { return event_queue; }
+
+// Replaces the whole heap with one saved alongside the nodes it schedules,
+// unscheduling the nodes of the current heap and recording the slots of the
+// saved heap's nodes
+void SetEventQueue(const std::vector<EventQueueEntry> &queue) {
+  event_slot_pages.resize(kChunksTot);
+  for (const EventQueueEntry &entry : event_queue) {
+    GetEventSlot(entry.index) = kUnscheduled;
+  }
+  event_queue = queue;
+  for (uint32_t slot = 0; slot < event_queue.size(); slot++) {
+    GetEventSlot(event_queue[slot].index) = slot;
+  }
+}
+
+// Returns the earliest scheduled event, or nullptr if none is scheduled
+const EventQueueEntry *PeekNextEvent() {
+  return event_queue.empty() ? nullptr : &event_queue.front();
+}
+
+// Returns the number of nodes with a scheduled event
+size_t CountScheduledNodes() { return event_queue.size(); }
@@ -0,0 +1,34 @@
+#include "stn3d/fork.h"
+
+#include "stn3d/util.h"
+
+// Saves the state of the simulation into a fork, sharing its chunks
+void CaptureFork(SimulationFork &fork) {
+  fork.chunks = chunks;
+  fork.chunk_empty_generations = chunk_empty_generations;
+  fork.occupied_nodes = occupied_nodes;
+  fork.coarse_lattice = coarse_lattice;
+  fork.treatment = treatment;
+  fork.sim_state = sim_state;
+  fork.engine = engine;
+  fork.aggregates = aggregates;
+  fork.event_queue = GetEventQueue();
+  SaveLineage(fork.lineage);
+  fork.random_engine = twister_engine;
+}
+
+// Rewinds the simulation to the state saved in a fork. The fork is left
+// intact, so it can be restored again for the next branch
+void RestoreFork(const SimulationFork &fork) {
+  chunks = fork.chunks;
+  chunk_empty_generations = fork.chunk_empty_generations;
+  occupied_nodes = fork.occupied_nodes;
+  coarse_lattice = fork.coarse_lattice;
+  treatment = fork.treatment;
+  sim_state = fork.sim_state;
+  engine = fork.engine;
+  aggregates = fork.aggregates;
+  SetEventQueue(fork.event_queue);
+  RestoreLineage(fork.lineage);
+  twister_engine = fork.random_engine;
+}
@@ -1,251 +1,308 @@
 #include "stn3d/initialise.h"
 
+#include <algorithm>
+#include <cmath>
 #include <random>
 #include <sstream>
 
+#include "stn3d/aggregates.h"
+#include "stn3d/chunks.h"
+#include "stn3d/coarse.h"
+#include "stn3d/landscape.h"
+#include "stn3d/lineage.h"
+#include "stn3d/stencil.h"
+#include "stn3d/treatment.h"
 #include "stn3d/util.h"
+#include "stn3d/volume.h"
 
-// Initialises the binary_values bitset array with genotype values
+static uint64_t resource_seed = 0;
+
+// The resource volume mu is sampled from, if any. It stays open for the run,
+// so chunks allocated later on a sparse lattice can be assigned their mu
+static ResourceVolume resource_volume;
+
+// Initialises the binary_values bitset array with genotype values. The hashed
+// landscape supports genomes too long to tabulate, so leaves it empty
 void InitialiseGenotypes() {
-  for (int idx = 0; idx < GENOTYPES_TOT; idx++) {
+  if (INTERACTIONS == Interactions::kHashed) {
+    genotype_bitsets.clear();
+    return;
+  }
+  genotype_bitsets.resize(GENOTYPES_TOT);
+  for (uint32_t idx = 0; idx < GENOTYPES_TOT; idx++) {
     genotype_bitsets[idx] = std::bitset<L>(static_cast<uint64_t>(idx));
   }
 }
 
-// Initialises arrays A1, A2 and B for use in interaction calculations
+// Generates arrays A1, A2 and B for use in interaction calculations, or seeds
+// the hashed landscape from the random engine
 void InitialiseMatricies() {
-  for (int idx = 0; idx < GENOTYPES_TOT; idx++) {
+  if (INTERACTIONS == Interactions::kHashed) {
+    const uint64_t high = twister_engine();
+    UseHashedLandscape((high << 32) | twister_engine());
+    return;
+  }
+  UseGeneratedLandscape();
+  for (uint32_t idx = 0; idx < GENOTYPES_TOT; idx++) {
     arr_a1[idx] = UniformRealInRange(-1, 1);
     arr_a2[idx] = UniformRealInRange(-1, 1);
     arr_b[idx] = UniformRealInRange(0, 1) <= THETA ? 1 : 0;
   }
 }
 
-// Fills a neighbours vector with its neighbouring lattice points
-void InitialiseNeighbours(std::vector<LatticePoint> &neighbours,
-                          const LatticeCoord i_coord,
-                          const LatticeCoord j_coord,
-                          const LatticeCoord k_coord) {
-  int i_selection;
-  int j_selection;
-  int k_selection;
-  LatticePoint lattice_point;
-
-  // Cover all unit distances from point (i, j, k)
-  for (int i_delta = -1; i_delta < 2; i_delta++) {
-    for (int j_delta = -1; j_delta < 2; j_delta++) {
-      for (int k_delta = -1; k_delta < 2; k_delta++) {
-        // Compute potential neighbour coordinates
-        i_selection = i_coord + i_delta;
-        j_selection = j_coord + j_delta;
-        k_selection = k_coord + k_delta;
-
-        if (abs(i_delta) + abs(j_delta) + abs(k_delta) != 0) {
-          if (i_selection <= X - 1 && j_selection <= X - 1 &&
-              k_selection <= X - 1 && i_selection >= 0 && j_selection >= 0 &&
-              k_selection >= 0) {
-            // Store coordinates contained within the lattice boundaries
-            lattice_point = i_selection +
-                            ((static_cast<char>(j_selection)) << 8) +
-                            ((static_cast<char>(k_selection)) << 16);
-            neighbours.push_back(lattice_point);
-          } else {
-            // Else use periodic boundary conditions
-            if (i_selection == X) {
-              i_selection = 0;
-            }
-            if (j_selection == X) {
-              j_selection = 0;
-            }
-            if (k_selection == X) {
-              k_selection = 0;
-            }
-            if (i_selection == -1) {
-              i_selection = X - 1;
-            }
-            if (j_selection == -1) {
-              j_selection = X - 1;
-            }
-            if (k_selection == -1) {
-              k_selection = X - 1;
-            }
-
-            lattice_point = i_selection +
-                            ((static_cast<char>(j_selection)) << 8) +
-                            ((static_cast<char>(k_selection)) << 16);
-            neighbours.push_back(lattice_point);
-          }
-        }
-      }
+// Initialises the interaction landscape by mapping a landscape file, or by
+// generating it if no path is given. Returns false if the file can't be
+// mapped, or the landscape is hashed and so can't be read from a file
+bool InitialiseLandscape(const std::string &path) {
+  if (path.empty()) {
+    InitialiseMatricies();
+    return true;
+  }
+  if (INTERACTIONS == Interactions::kHashed) {
+    return false;
+  }
+
+  return MapLandscapeFile(path);
+}
+
+// Fills a neighbours vector with the nodes reachable by migration from a
+// node, according to the current neighbour table
+void InitialiseNeighbours(std::vector<NodeIndex> &neighbours,
+                          const NodeIndex node) {
+  for (int n = 0; n < stencil_size; n++) {
+    const NodeIndex destination = GetNeighbour(node, n);
+    if (destination != kAbsorbed) {
+      neighbours.push_back(destination);
     }
   }
 }
 
-// Populates the lattice of nodes and creates output files ready for logging
+// Populates an empty lattice of nodes. Chunks of a sparse lattice are
+// populated as they are first used
 void InitialiseLattice() {
-  for (int i = 0; i < X; i++) {
-    for (int j = 0; j < X; j++) {
-      for (int k = 0; k < X; k++) {
-        nodes[i][j][k] = std::make_unique<Node>();
-        (*nodes[i][j][k]).i_coord = i;
-        (*nodes[i][j][k]).j_coord = j;
-        (*nodes[i][j][k]).k_coord = k;
-        (*nodes[i][j][k]).population = 0;
-
-        InitialiseNeighbours((*nodes[i][j][k]).neighbours, i, j, k);
-
-        // Create and open an output file to track existent genotypes of node_ij
-        std::ostringstream oss;
-        oss << "out/existent_genotypes_" << i << j << k << ".txt";
-        outfiles[i][j][k] = std::make_unique<std::ofstream>(oss.str());
-      }
+  BuildNeighbourTable();
+  InitialiseChunks();
+  occupied_nodes.clear();
+  ResetCoarseLattice();
+  ResetTreatment();
+  ResetAggregates();
+  ResetLineage();
+}
+
+// Creates and opens an output file per node to track its existent genotypes,
+// named by its concatenated coordinates
+void OpenNodeLogs() {
+  outfiles.clear();
+  for (NodeIndex node = 0; node < kNodesTot; node++) {
+    std::ostringstream oss;
+    oss << "out/existent_genotypes_";
+    for (LatticeCoord coord : Lattice::Coordinates(node)) {
+      oss << static_cast<int>(coord);
     }
+    oss << ".txt";
+    outfiles.push_back(std::make_unique<std::ofstream>(oss.str()));
   }
 }
 
-// Initialises lattice resources through distribution of mu
-void InitialiseResources() {
-  if (FIX_MU) {
-    for (int k = 0; k < X; k++) {
-      for (int j = 0; j < X; j++) {
-        for (int i = 0; i < X; i++) {
-          (*nodes[i][j][k]).mu = FIXED_MU_VAL;
-        }
-      }
+// Initialises lattice resources by sampling a resource volume, if one is
+// configured, else through distribution of mu. Random perturbations of mu are
+// derived from a per-run seed and the node, so nodes of chunks that are
+// released and reallocated regain the same resources. Returns false if the
+// volume can't be mapped
+bool InitialiseResources(const std::string &volume_path) {
+  resource_volume.Close();
+  if (!volume_path.empty()) {
+    if (!resource_volume.Open(volume_path)) {
+      return false;
     }
+    DistributeVolumeMu();
+  } else if (FIX_MU) {
+    ForEachAllocatedNode([](Node &node) { node.mu = FIXED_MU_VAL; });
   } else {
+    resource_seed = static_cast<uint64_t>(UniformRealInRange(0, 1) * 0x1p53);
     if (CUBIC_MU) {
       DistributeCubicMu();
     } else {
       DistributeGradientMu();
     }
   }
+
+  return true;
+}
+
+// Assigns resources to a single node according to the configured distribution
+void AssignResources(Node &node) {
+  if (resource_volume.IsOpen()) {
+    node.mu = resource_volume.Sample(node.coords, RESOURCE_RESAMPLING);
+  } else if (FIX_MU) {
+    node.mu = FIXED_MU_VAL;
+  } else if (CUBIC_MU) {
+    node.mu = GetCubicMu(node.coords);
+  } else {
+    node.mu = GetGradientMu(node.coords);
+  }
+  node.mu = GetTreatedMu(node.coords, node.mu);
+}
+
+// Returns the node to start the population on: the fixed starting position if
+// FIX_START, else a uniformly random node
+NodeIndex ChooseStartNode() {
+  const LatticeCoord fixed_start[3] = {FIXED_X_VAL, FIXED_Y_VAL, FIXED_Z_VAL};
+  Coords start_coords;
+  for (int axis = 0; axis < D; axis++) {
+    start_coords[axis] =
+        FIX_START ? fixed_start[axis] : UniformIntInRange(0, X - 1);
+  }
+
+  return Lattice::Index(start_coords);
 }
 
 // Initialises the starting population N_0 on the specified node
-void InitialisePopulationOnNode(const LatticeCoord i_coord,
-                                const LatticeCoord j_coord,
-                                const LatticeCoord k_coord) {
-  LatticePoint lattice_point = i_coord + ((static_cast<char>(j_coord)) << 8) +
-                               ((static_cast<char>(k_coord)) << 16);
-  occupied_nodes.push_back(lattice_point);
+void InitialisePopulationOnNode(const NodeIndex node) {
+  occupied_nodes.push_back(node);
 
-  (*nodes[i_coord][j_coord][k_coord]).population = N_0;
+  Node &start = GetNode(node);
+  start.population = N_0;
 
   // Populate lattice point with N_0 randomly or explicitly chosen individuals
-  int individual;
+  Genotype individual;
   for (int idx = 0; idx < N_0; idx++) {
-    individual = UniformIntInRange(0, GENOTYPES_TOT - 1);
+    individual = UniformGenotype();
 
     // If the chosen individual is not yet occupying the node, add its label
     // to the existent_genotypes vector
-    if ((*nodes[i_coord][j_coord][k_coord]).genotype_counts[individual] == 0) {
-      (*nodes[i_coord][j_coord][k_coord])
-          .existent_genotypes.push_back(individual);
+    const bool founded = start.genotype_counts[individual] == 0;
+    if (founded) {
+      start.existent_genotypes.push_back(individual);
+      if (TRACK_LINEAGE) {
+        RecordFounder(node, individual);
+      }
     }
 
     // Increment the nodes occupancy of the chosen individual
-    (*nodes[i_coord][j_coord][k_coord]).genotype_counts[individual] += 1;
+    start.genotype_counts.Increment(individual);
+    AddToAggregates(individual, founded);
   }
 }
 
 // Writes parameters and starting conditions to a logfile
-void LogInitialState(const LatticeCoord i_coord, const LatticeCoord j_coord,
-                     const LatticeCoord k_coord) {
+void LogInitialState(const NodeIndex start) {
   std::ofstream initial_state_log;
   initial_state_log.open("out/initial_state_log.txt");
 
   // Parameters
   initial_state_log << 'g' << GENERATIONS_TOT << '\t' << 'L' << L << '\t' << 'X'
                     << X << '\t' << 'p' << N_0 << '\t' << 't' << THETA << '\t'
-                    << '\n';
+                    << 'd' << D << '\t' << '\n';
   initial_state_log << 'm' << PMUT << '\t' << 'k' << PKILL << '\t' << 'v'
                     << PMOVE << '\t' << 'c' << C_R << "\n\n";
 
-  // Mu
-  initial_state_log << 'x' << '\t' << 'y' << '\t' << 'z' << '\t' << '\n';
-  for (int k = 0; k < X; k++) {
-    for (int j = 0; j < X; j++) {
-      for (int i = 0; i < X; i++) {
-        initial_state_log << i << '\t' << j << '\t' << k << '\t'
-                          << (*nodes[i][j][k]).mu << '\n';
+  // Mu, listed with the first axis varying fastest and a blank line after
+  // each completed row and plane. Sparse lattices assign mu as chunks are
+  // allocated, so it isn't listed up front
+  const char axis_labels[3] = {'x', 'y', 'z'};
+  for (int axis = 0; axis < D; axis++) {
+    initial_state_log << axis_labels[axis] << '\t';
+  }
+  initial_state_log << '\n';
+  Coords coords = {0};
+  for (uint32_t idx = 0; !SPARSE_LATTICE && idx < kNodesTot; idx++) {
+    for (int axis = 0; axis < D; axis++) {
+      initial_state_log << static_cast<int>(coords[axis]) << '\t';
+    }
+    initial_state_log << GetNode(Lattice::Index(coords)).mu << '\n';
+
+    // Advance the coordinates, first axis fastest
+    for (int axis = 0; axis < D; axis++) {
+      if (++coords[axis] < X) {
+        break;
       }
+      coords[axis] = 0;
       initial_state_log << '\n';
     }
-    initial_state_log << '\n';
   }
 
   // Starting coordinates
-  initial_state_log << "Staring coordinates: (" << (int)i_coord << ", "
-                    << (int)j_coord << ", " << (int)k_coord << ")" << std::endl;
+  initial_state_log << "Staring coordinates: (";
+  for (int axis = 0; axis < D; axis++) {
+    initial_state_log << (axis ? ", " : "")
+                      << static_cast<int>(Lattice::Coordinates(start)[axis]);
+  }
+  initial_state_log << ")" << std::endl;
 
   initial_state_log.close();
 }
 
+// Returns a uniform perturbation over [-1, 1) for the nth draw of a node,
+// using the splitmix64 finaliser to hash the seed, node and draw number
+static double GetResourceNoise(const Coords &coords, const uint32_t draw) {
+  uint64_t z = resource_seed +
+               ((static_cast<uint64_t>(Lattice::Index(coords)) << 16) + draw) *
+                   0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z ^= z >> 31;
+
+  return (static_cast<double>(z >> 11) * 0x1p-52) - 1.0;
+}
+
+// Returns mu for a node in a square frame pattern according to depth: each
+// node lies on the frame whose side length is X less twice the nodes distance
+// to the nearest lattice face
+double GetCubicMu(const Coords &coords) {
+  int depth = X;
+  for (LatticeCoord coord : coords) {
+    depth = std::min({depth, static_cast<int>(coord), X - 1 - coord});
+  }
+  const int frame_length = X - (2 * depth);
+
+  // Initialise mu according to the frame length
+  double mu = (frame_length / (double(10) * X)) +
+              (GetResourceNoise(coords, 0) / double(200));
+  mu -= fmod(mu, 0.001);
+
+  return mu;
+}
+
+// Returns mu for a node in a gradient pattern, proportional to the x-axis
+double GetGradientMu(const Coords &coords) {
+  double mu;
+  uint32_t draw = 0;
+  do {
+    mu = 0.1 - (coords[0] / (double(10) * X)) +
+         (GetResourceNoise(coords, draw++) / double(100));
+    mu -= fmod(mu, 0.001);
+  } while (mu <= 0.0);
+
+  return mu;
+}
+
 // Distributes resources (mu) in a square frame pattern according to depth
 void DistributeCubicMu() {
-  int i;
-  int j;
-  int k;
-  int frame_length;
-
-  // Sum over the possible cube frame lengths
-  for (frame_length = X; frame_length > 0; frame_length -= 2) {
-    // Calculate the start and limit coordinates for the given frame length
-    int frame_min = (X - frame_length) / 2;
-    int frame_lim = (X + frame_length) / 2;
-
-    for (i = frame_min; i < frame_lim; i++) {
-      // If at a corner in the i-axis, also loop over j and k to include the
-      // whole face
-      if (i == frame_min || i == frame_lim - 1) {
-        for (j = frame_min; j < frame_lim; j++) {
-          for (k = frame_min; k < frame_lim; k++) {
-            // Initialise mu according to the frame length
-            (*nodes[i][j][k]).mu = (frame_length / (double(10) * X)) +
-                                   (UniformRealInRange(-1, 1) / double(200));
-            (*nodes[i][j][k]).mu -= fmod((*nodes[i][j][k]).mu, 0.001);
-          }
-        }
-      }
-      // Else if in the middle of a frames side on the i-axis, only loop over
-      // the adjacent components of the frame
-      else {
-        for (j = frame_min; j < frame_lim; j++) {
-          // If at a corner in the j-axis, also loop vertically
-          if (j == frame_min || j == frame_lim - 1) {
-            for (k = frame_min; k < frame_lim; k++) {
-              (*nodes[i][j][k]).mu = (frame_length / (double(10) * X)) +
-                                     (UniformRealInRange(-1, 1) / double(200));
-              (*nodes[i][j][k]).mu -= fmod((*nodes[i][j][k]).mu, 0.001);
-            }
-          }
-          // Else if in the middle of a frames side on the j-axis, only loop
-          // over the base and vertical limit components
-          else {
-            for (k = frame_min; k < frame_lim; k += (frame_length - 1)) {
-              (*nodes[i][j][k]).mu = (frame_length / (double(10) * X)) +
-                                     (UniformRealInRange(-1, 1) / double(200));
-              (*nodes[i][j][k]).mu -= fmod((*nodes[i][j][k]).mu, 0.001);
-            }
-          }
-        }
-      }
-    }
-  }
+  ForEachAllocatedNode([](Node &node) { node.mu = GetCubicMu(node.coords); });
 }
 
 // Distributes resources (mu) in a gradient pattern, proportional to the x-axis
 void DistributeGradientMu() {
-  for (int i = 0; i < X; i++) {
-    for (int j = 0; j < X; j++) {
-      for (int k = 0; k < X; k++) {
-        do {
-          (*nodes[i][j][k]).mu = 0.1 - (i / (double(10) * X)) +
-                                 (UniformRealInRange(-1, 1) / double(100));
-          (*nodes[i][j][k]).mu -= fmod((*nodes[i][j][k]).mu, 0.001);
-        } while ((*nodes[i][j][k]).mu <= 0.0);
+  ForEachAllocatedNode(
+      [](Node &node) { node.mu = GetGradientMu(node.coords); });
+}
+
+// Distributes resources (mu) by sampling the open resource volume. Nodes are
+// visited in index order, plane by plane along x, releasing the slabs of the
+// volume behind each plane once it's done
+void DistributeVolumeMu() {
+  constexpr NodeIndex kPlaneNodes = kNodesTot / X;
+  for (LatticeCoord x = 0; x < X; x++) {
+    for (NodeIndex index = x * kPlaneNodes; index < (x + 1) * kPlaneNodes;
+         index++) {
+      if (FindNode(index) != nullptr) {
+        Node &node = GetNode(index);
+        node.mu = resource_volume.Sample(node.coords, RESOURCE_RESAMPLING);
       }
     }
+    resource_volume.ReleaseSlabsBefore(
+        x + 1 < X ? resource_volume.GetFirstSlab(x + 1)
+                  : resource_volume.Header().extent[0]);
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,145 @@
+#include "stn3d/landscape.h"
+
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+#include "stn3d/mapped.h"
+#include "stn3d/util.h"
+
+// Storage of a landscape generated in-process, and the mapping of a landscape
+// file, only one of which backs arr_a1, arr_a2 and arr_b at a time
+static std::vector<double> generated_a1;
+static std::vector<double> generated_a2;
+static std::vector<int32_t> generated_b;
+static MappedFile landscape_file;
+
+uint64_t hashed_landscape_seed = 0;
+
+// Returns offset rounded up to the next section boundary
+static uint64_t AlignSection(const uint64_t offset) {
+  return (offset + kLandscapeAlignment - 1) & ~(kLandscapeAlignment - 1);
+}
+
+// Writes the current A1, A2 and B arrays to a landscape file, recording the
+// seed they were generated from
+bool WriteLandscapeFile(const std::string &path, const uint64_t seed) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  LandscapeHeader header = {};
+  std::memcpy(header.magic, kLandscapeMagic, sizeof(kLandscapeMagic));
+  header.version = kLandscapeVersion;
+  header.genome_length = L;
+  header.genotype_count = GENOTYPES_TOT;
+  header.theta = THETA;
+  header.seed = seed;
+  header.a1_offset = AlignSection(sizeof(LandscapeHeader));
+  header.a2_offset =
+      AlignSection(header.a1_offset + (GENOTYPES_TOT * sizeof(double)));
+  header.b_offset =
+      AlignSection(header.a2_offset + (GENOTYPES_TOT * sizeof(double)));
+  header.file_size = header.b_offset + (GENOTYPES_TOT * sizeof(int32_t));
+
+  // Write each section at its offset, padding the gaps with zeros
+  const struct {
+    uint64_t offset;
+    const void *data;
+    size_t size;
+  } sections[] = {
+      {0, &header, sizeof(header)},
+      {header.a1_offset, arr_a1, GENOTYPES_TOT * sizeof(double)},
+      {header.a2_offset, arr_a2, GENOTYPES_TOT * sizeof(double)},
+      {header.b_offset, arr_b, GENOTYPES_TOT * sizeof(int32_t)}};
+  const char padding[kLandscapeAlignment] = {0};
+  for (const auto &section : sections) {
+    const auto position = static_cast<uint64_t>(file.tellp());
+    file.write(padding,
+               static_cast<std::streamsize>(section.offset - position));
+    file.write(static_cast<const char *>(section.data),
+               static_cast<std::streamsize>(section.size));
+  }
+
+  return file.good();
+}
+
+// Maps a landscape file and points arr_a1, arr_a2 and arr_b into it. Returns
+// false, leaving the current landscape in place, if the file is missing,
+// truncated, has a section outside it or was written for a different genome
+// length or THETA
+bool MapLandscapeFile(const std::string &path) {
+  MappedFile file;
+  if (!file.Open(path)) {
+    return false;
+  }
+
+  const auto *header = reinterpret_cast<const LandscapeHeader *>(file.Data());
+  if (file.Size() < sizeof(LandscapeHeader) ||
+      std::memcmp(header->magic, kLandscapeMagic, sizeof(kLandscapeMagic)) !=
+          0 ||
+      header->version != kLandscapeVersion || header->genome_length != L ||
+      header->genotype_count != GENOTYPES_TOT || header->theta != THETA ||
+      header->file_size != file.Size()) {
+    return false;
+  }
+
+  // Each section must be aligned for its values and lie within the file
+  const struct {
+    uint64_t offset;
+    uint64_t size;
+    size_t alignment;
+  } sections[] = {
+      {header->a1_offset, GENOTYPES_TOT * sizeof(double), alignof(double)},
+      {header->a2_offset, GENOTYPES_TOT * sizeof(double), alignof(double)},
+      {header->b_offset, GENOTYPES_TOT * sizeof(int32_t), alignof(int32_t)}};
+  for (const auto &section : sections) {
+    if (section.offset < sizeof(LandscapeHeader) ||
+        section.offset % section.alignment != 0 ||
+        !file.Spans(section.offset, section.size)) {
+      return false;
+    }
+  }
+
+  // The simulation never writes to the arrays, so they can point into the
+  // read-only mapping
+  auto *data = const_cast<uint8_t *>(file.Data());
+  arr_a1 = reinterpret_cast<double *>(data + header->a1_offset);
+  arr_a2 = reinterpret_cast<double *>(data + header->a2_offset);
+  arr_b = reinterpret_cast<int32_t *>(data + header->b_offset);
+  landscape_file = std::move(file);
+
+  return true;
+}
+
+// Releases any mapped landscape file and points arr_a1, arr_a2 and arr_b at
+// in-process storage, ready to be generated
+void UseGeneratedLandscape() {
+  landscape_file.Close();
+
+  generated_a1.resize(GENOTYPES_TOT);
+  generated_a2.resize(GENOTYPES_TOT);
+  generated_b.resize(GENOTYPES_TOT);
+  arr_a1 = generated_a1.data();
+  arr_a2 = generated_a2.data();
+  arr_b = generated_b.data();
+}
+
+// Releases any mapped landscape file or generated arrays
+void ReleaseLandscape() {
+  landscape_file.Close();
+  std::vector<double>().swap(generated_a1);
+  std::vector<double>().swap(generated_a2);
+  std::vector<int32_t>().swap(generated_b);
+  arr_a1 = nullptr;
+  arr_a2 = nullptr;
+  arr_b = nullptr;
+}
+
+// Releases any landscape arrays and derives the landscape from a seed instead
+void UseHashedLandscape(const uint64_t seed) {
+  ReleaseLandscape();
+  hashed_landscape_seed = seed;
+}
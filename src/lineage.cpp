@@ -0,0 +1,232 @@
+#include "stn3d/lineage.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+#include "stn3d/dynamics.h"
+#include "stn3d/encoding.h"
+
+// The arena of lineage records, and the record of each living clone
+static std::vector<LineageRecord> lineage_records;
+static CloneLineages clone_lineages;
+static size_t compacted_size = 0;
+
+// Records fewer than this are never worth compacting
+static constexpr size_t kMinCompactionSize = 1024;
+
+// Appends a record referenced by the new clone of a genotype on a node
+static void AppendRecord(const NodeIndex node, const Genotype genotype,
+                         const uint32_t parent, const Genotype parent_genotype,
+                         const bool founder) {
+  clone_lineages[{node, genotype}] =
+      static_cast<uint32_t>(lineage_records.size());
+  lineage_records.push_back({parent, parent_genotype, genotype, node,
+                             sim_state.generation, 1, founder});
+}
+
+// Discards all records
+void ResetLineage() {
+  lineage_records.clear();
+  clone_lineages.clear();
+  compacted_size = 0;
+}
+
+// Copies the whole tracker into a state
+void SaveLineage(LineageState &state) {
+  state.records = lineage_records;
+  state.clone_lineages = clone_lineages;
+  state.compacted_size = compacted_size;
+}
+
+// Replaces the whole tracker with a saved state
+void RestoreLineage(const LineageState &state) {
+  lineage_records = state.records;
+  clone_lineages = state.clone_lineages;
+  compacted_size = state.compacted_size;
+}
+
+// Records a genotype of the initial population as the root of a lineage
+void RecordFounder(const NodeIndex node, const Genotype genotype) {
+  AppendRecord(node, genotype, kLineageRoot, 0, true);
+}
+
+// Records a mutation introducing the child genotype to a node, descended from
+// the clone of the parent genotype on the same node
+void RecordMutation(const NodeIndex node, const Genotype parent,
+                    const Genotype child) {
+  AppendRecord(node, child, GetCloneLineage(node, parent), parent, false);
+}
+
+// Returns the record of the clone of a genotype on a node, or kLineageRoot if
+// the clone isn't tracked
+uint32_t GetCloneLineage(const NodeIndex node, const Genotype genotype) {
+  const auto clone = clone_lineages.find({node, genotype});
+  return clone == clone_lineages.end() ? kLineageRoot : clone->second;
+}
+
+// Records a clone founded on a node by a migrant of an existing lineage
+void RecordClone(const NodeIndex node, const Genotype genotype,
+                 const uint32_t lineage) {
+  if (lineage == kLineageRoot) {
+    return;
+  }
+
+  clone_lineages[{node, genotype}] = lineage;
+  lineage_records[lineage].clones++;
+}
+
+// Releases the reference of a clone that has gone extinct on a node
+void RecordExtinction(const NodeIndex node, const Genotype genotype) {
+  const auto clone = clone_lineages.find({node, genotype});
+  if (clone == clone_lineages.end()) {
+    return;
+  }
+
+  lineage_records[clone->second].clones--;
+  clone_lineages.erase(clone);
+}
+
+// Discards records with neither a living clone nor a living descendant, and
+// renumbers the remainder in order. Parents always precede their children,
+// so liveness propagates to ancestors in a single backwards sweep
+void CompactLineage() {
+  const size_t size = lineage_records.size();
+  std::vector<uint32_t> remapped(size, 0);
+  for (size_t idx = size; idx-- > 0;) {
+    const LineageRecord &record = lineage_records[idx];
+    if (record.clones > 0) {
+      remapped[idx] = 1;
+    }
+    if (remapped[idx] && record.parent != kLineageRoot) {
+      remapped[record.parent] = 1;
+    }
+  }
+
+  uint32_t kept = 0;
+  for (size_t idx = 0; idx < size; idx++) {
+    if (!remapped[idx]) {
+      remapped[idx] = kLineageRoot;
+      continue;
+    }
+
+    LineageRecord record = lineage_records[idx];
+    if (record.parent != kLineageRoot) {
+      record.parent = remapped[record.parent];
+    }
+    remapped[idx] = kept;
+    lineage_records[kept++] = record;
+  }
+  lineage_records.resize(kept);
+
+  for (auto &clone : clone_lineages) {
+    clone.second = remapped[clone.second];
+  }
+  compacted_size = kept;
+}
+
+// Compacts the arena if it has doubled in size since the last compaction.
+// Call once per generation boundary
+void MaybeCompactLineage() {
+  if (lineage_records.size() >= kMinCompactionSize &&
+      lineage_records.size() >= 2 * compacted_size) {
+    CompactLineage();
+  }
+}
+
+// Returns the records of the arena, in order of creation
+const std::vector<LineageRecord> &GetLineageRecords() {
+  return lineage_records;
+}
+
+// Compacts the arena and writes the phylogeny of the living clones. The file
+// holds the magic, version and record count, then per record the varint
+// distance back to its parent (zero for roots), founder flag, parent
+// genotype, genotype, node, generation and living clone count
+bool WritePhylogenyFile(const std::string &path) {
+  CompactLineage();
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  std::vector<uint8_t> buffer(kPhylogenyMagic,
+                              kPhylogenyMagic + sizeof(kPhylogenyMagic));
+  AppendVarint(buffer, kPhylogenyVersion);
+  AppendVarint(buffer, lineage_records.size());
+  for (size_t idx = 0; idx < lineage_records.size(); idx++) {
+    const LineageRecord &record = lineage_records[idx];
+    AppendVarint(buffer,
+                 record.parent == kLineageRoot ? 0 : idx - record.parent);
+    AppendVarint(buffer, record.founder);
+    AppendVarint(buffer, record.parent_genotype);
+    AppendVarint(buffer, record.genotype);
+    AppendVarint(buffer, record.node);
+    AppendVarint(buffer, static_cast<uint64_t>(record.generation));
+    AppendVarint(buffer, record.clones);
+  }
+  file.write(reinterpret_cast<const char *>(buffer.data()),
+             static_cast<std::streamsize>(buffer.size()));
+
+  return file.good();
+}
+
+// Reads a phylogeny file into records. Returns false if the file is missing,
+// truncated, not a phylogeny file, or any field is out of range for this
+// build, such as a parent after its record or a node beyond the lattice
+bool ReadPhylogenyFile(const std::string &path,
+                       std::vector<LineageRecord> &records) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  const std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(file)),
+                                    std::istreambuf_iterator<char>());
+  if (buffer.size() < sizeof(kPhylogenyMagic) ||
+      std::memcmp(buffer.data(), kPhylogenyMagic, sizeof(kPhylogenyMagic)) !=
+          0) {
+    return false;
+  }
+
+  const uint8_t *data = buffer.data() + sizeof(kPhylogenyMagic);
+  const uint8_t *end = buffer.data() + buffer.size();
+  uint64_t version;
+  uint64_t count;
+  data = ReadVarint(data, end, version);
+  data = ReadVarint(data, end, count);
+  if (version != kPhylogenyVersion) {
+    return false;
+  }
+
+  records.clear();
+  for (uint64_t idx = 0; idx < count; idx++) {
+    if (data == nullptr || data >= end) {
+      return false;
+    }
+
+    uint64_t distance, founder, parent_genotype, genotype, node, generation,
+        clones;
+    data = ReadVarint(data, end, distance);
+    data = ReadVarint(data, end, founder);
+    data = ReadVarint(data, end, parent_genotype);
+    data = ReadVarint(data, end, genotype);
+    data = ReadVarint(data, end, node);
+    data = ReadVarint(data, end, generation);
+    data = ReadVarint(data, end, clones);
+    if (data == nullptr || distance > idx || founder > 1 ||
+        parent_genotype > kGenotypeMask || genotype > kGenotypeMask ||
+        node >= kNodesTot || generation > INT32_MAX || clones > UINT32_MAX) {
+      return false;
+    }
+    records.push_back({distance == 0 ? kLineageRoot
+                                     : static_cast<uint32_t>(idx - distance),
+                       parent_genotype, genotype,
+                       static_cast<NodeIndex>(node),
+                       static_cast<int32_t>(generation),
+                       static_cast<uint32_t>(clones), founder == 1});
+  }
+
+  return true;
+}
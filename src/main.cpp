@@ -5,52 +5,63 @@
 -------------------------------- March 2018 -----------------------------------
 
 This program runs a three-dimensional spatial Tangled Nature Model on a cubic
-lattice of X^3 nodes. Configure parameters to be used in params.h, then build
-using the makefile.
+lattice of X^3 nodes, or a two-dimensional model on a square lattice of X^2
+nodes. Configure parameters to be used in params.h, then build using the
+makefile.
 
 -------------------------------------------------------------------------------
 */
 
-#include <sys/stat.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
 
+#include "stn3d/acceptance.h"
 #include "stn3d/dynamics.h"
 #include "stn3d/initialise.h"
+#include "stn3d/lineage.h"
+#include "stn3d/treatment.h"
 #include "stn3d/util.h"
 
-// For use of _mkdir on Windows
-#if defined(_WIN32) || defined(_WIN64)
-#include <direct.h>
-#endif
-
 // Main entry
 int main() {
   ValidateParameters();
 
-  // Create an out directory if it doesn't already exist
-  struct stat info;
 #if defined(_WIN32) || defined(_WIN64)
   _setmaxstdio(1024);
-  if (stat("out", &info)) {
-    _mkdir("./out");
-  }
-#else
-  if (stat("out", &info)) {
-    system("mkdir out");
-  }
 #endif
+  MakeOutputDirectory();
 
+  SetAcceptanceStrategy(ACCEPTANCE_STRATEGY);
   InitialiseGenotypes();
-  InitialiseMatricies();
+  if (!InitialiseLandscape(LANDSCAPE_FILE)) {
+    std::cout << "Unable to map landscape file " << LANDSCAPE_FILE
+              << ", which must be generated for L=" << L << "." << std::endl;
+    return EXIT_FAILURE;
+  }
   InitialiseLattice();
-  InitialiseResources();
+  if (!InitialiseResources()) {
+    std::cout << "Unable to map resource volume " << RESOURCE_VOLUME_FILE
+              << ", which must be two-dimensional for D=2." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!LoadTreatmentSchedule(TREATMENT_SCHEDULE_FILE)) {
+    std::cout << "Unable to read treatment schedule " << TREATMENT_SCHEDULE_FILE
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (WRITE_NODE_LOGS) {
+    OpenNodeLogs();
+  }
 
-  LatticeCoord i_start = FIX_START ? FIXED_X_VAL : UniformIntInRange(0, X - 1);
-  LatticeCoord j_start = FIX_START ? FIXED_Y_VAL : UniformIntInRange(0, X - 1);
-  LatticeCoord k_start = FIX_START ? FIXED_Z_VAL : UniformIntInRange(0, X - 1);
-  InitialisePopulationOnNode(i_start, j_start, k_start);
-  LogInitialState(i_start, j_start, k_start);
+  const NodeIndex start = ChooseStartNode();
+  InitialisePopulationOnNode(start);
+  LogInitialState(start);
 
-  SimLoop(i_start, j_start, k_start);
+  SimLoop(start);
+  if (TRACK_LINEAGE) {
+    WritePhylogenyFile("out/phylogeny.stp");
+  }
 
   CloseAllOutputFiles();
 
@@ -0,0 +1,106 @@
+#include "stn3d/mapped.h"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() { Close(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+  *this = std::move(other);
+}
+
+// Takes over the file of another view, closing any file of this one
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    Close();
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    buffer_.swap(other.buffer_);
+  }
+
+  return *this;
+}
+
+// Maps a file read-only, closing any file mapped before. Returns false if the
+// file is missing, empty or can't be mapped
+bool MappedFile::Open(const std::string &path) {
+  Close();
+
+#if defined(_WIN32) || defined(_WIN64)
+  // Without mmap the file is read into memory once
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  buffer_.assign(std::istreambuf_iterator<char>(file),
+                 std::istreambuf_iterator<char>());
+  if (buffer_.empty()) {
+    return false;
+  }
+  size_ = buffer_.size();
+  data_ = buffer_.data();
+#else
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  const auto size = static_cast<size_t>(info.st_size);
+  void *mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  size_ = size;
+  data_ = static_cast<const uint8_t *>(mapping);
+#endif
+
+  return true;
+}
+
+// Unmaps the file
+void MappedFile::Close() {
+  if (data_ == nullptr) {
+    return;
+  }
+
+#if defined(_WIN32) || defined(_WIN64)
+  std::vector<uint8_t>().swap(buffer_);
+#else
+  munmap(const_cast<uint8_t *>(data_), size_);
+#endif
+  data_ = nullptr;
+  size_ = 0;
+}
+
+// Releases the pages wholly within a range of the file from memory. Released
+// pages are read again from the file if they're accessed later. Files read
+// into memory are kept whole
+void MappedFile::Release(const uint64_t begin, const uint64_t end) const {
+#if !defined(_WIN32) && !defined(_WIN64)
+  const auto page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  const uint64_t first = (begin + page - 1) & ~(page - 1);
+  const uint64_t last = std::min<uint64_t>(end, size_) & ~(page - 1);
+  if (data_ != nullptr && first < last) {
+    madvise(const_cast<uint8_t *>(data_) + first, last - first,
+            MADV_DONTNEED);
+  }
+#else
+  (void)begin;
+  (void)end;
+#endif
+}
@@ -0,0 +1,168 @@
+#include "stn3d/run.h"
+
+#include <iostream>
+
+#include "stn3d/acceptance.h"
+#include "stn3d/chunks.h"
+#include "stn3d/coarse.h"
+#include "stn3d/events.h"
+#include "stn3d/initialise.h"
+#include "stn3d/landscape.h"
+#include "stn3d/lineage.h"
+#include "stn3d/treatment.h"
+
+static bool run_exists = false;
+static bool run_writes_output = false;
+
+// Frees the lattice and landscape of a run, whether it was completed or
+// failed part way through its creation
+static void ReleaseRun() {
+  chunks.clear();
+  occupied_nodes.clear();
+  ResetCoarseLattice();
+  ReleaseLandscape();
+  run_exists = false;
+}
+
+// Initialises a run using the parameters of the build. Returns false if the
+// parameters are invalid, the landscape file or resource volume can't be
+// mapped, the treatment schedule can't be read or a run already exists
+bool CreateRun(const RunOptions &options) {
+  if (run_exists || GetParameterErrors(std::cerr) != 0) {
+    return false;
+  }
+  run_exists = true;
+
+  SeedRandomEngine(options.seed);
+  SetAcceptanceStrategy(ACCEPTANCE_STRATEGY);
+  InitialiseGenotypes();
+  if (!InitialiseLandscape(options.landscape_path != nullptr
+                               ? options.landscape_path
+                               : LANDSCAPE_FILE)) {
+    ReleaseRun();
+    return false;
+  }
+  InitialiseLattice();
+  if (!InitialiseResources() ||
+      !LoadTreatmentSchedule(TREATMENT_SCHEDULE_FILE)) {
+    ReleaseRun();
+    return false;
+  }
+  if (options.write_output) {
+    MakeOutputDirectory();
+    if (WRITE_NODE_LOGS) {
+      OpenNodeLogs();
+    }
+  }
+
+  const NodeIndex start = ChooseStartNode();
+  InitialisePopulationOnNode(start);
+  run_writes_output = options.write_output;
+  if (run_writes_output) {
+    LogInitialState(start);
+    OpenRunOutputs();
+  }
+  BeginSimulation(start);
+
+  return true;
+}
+
+// Completes any output files, including the phylogeny if lineages are
+// tracked, and frees the lattice and landscape of the run
+void DestroyRun() {
+  if (!run_exists) {
+    return;
+  }
+
+  if (TRACK_LINEAGE && run_writes_output) {
+    WritePhylogenyFile("out/phylogeny.stp");
+  }
+  CloseAllOutputFiles();
+  ReleaseRun();
+}
+
+// Returns true if a run has been created and not yet destroyed
+bool RunExists() { return run_exists; }
+
+// Advances the run by a number of steps. Returns false if the population is
+// extinct, in which case the run stops advancing
+bool AdvanceSteps(const uint64_t steps) {
+  for (uint64_t step = 0; run_exists && step < steps; step++) {
+    if (!StepSimulation()) {
+      return false;
+    }
+  }
+
+  return run_exists;
+}
+
+// Advances the run until a number of further generations have completed.
+// Returns false if the population is extinct
+bool AdvanceGenerations(const uint32_t generations) {
+  const int64_t target =
+      static_cast<int64_t>(sim_state.generation) + generations;
+  while (run_exists && sim_state.generation < target) {
+    if (!StepSimulation()) {
+      return false;
+    }
+  }
+
+  return run_exists;
+}
+
+// Returns the progress of the run
+const SimState &GetRunState() { return sim_state; }
+
+// Returns a read-only view of a node, or nullptr if the node is outside the
+// lattice or in an unallocated chunk, and so empty
+const Node *GetNodeView(const NodeIndex node) {
+  if (!run_exists || node >= kNodesTot) {
+    return nullptr;
+  }
+
+  return FindNode(node);
+}
+
+// Returns the indices of the nodes holding a population, in no fixed order
+const std::vector<NodeIndex> &GetOccupiedNodes() { return occupied_nodes; }
+
+// Returns the population aggregates of the whole lattice
+const Aggregates &GetRunAggregates() { return aggregates; }
+
+// Saves the state of the run into a fork. Returns false if no run exists
+bool ForkRun(SimulationFork &fork) {
+  if (!run_exists) {
+    return false;
+  }
+  CaptureFork(fork);
+
+  return true;
+}
+
+// Rewinds the run to the state saved in a fork of it. Returns false if no run
+// exists
+bool RestoreRun(const SimulationFork &fork) {
+  if (!run_exists) {
+    return false;
+  }
+  RestoreFork(fork);
+
+  return true;
+}
+
+// Sets the resources of a node, copying its chunk if it's shared with a fork.
+// The edit to an empty node lasts until its chunk is released. Returns false
+// if no run exists or the node is outside the lattice
+bool SetNodeMu(const NodeIndex node, const double mu) {
+  if (!run_exists || node >= kNodesTot) {
+    return false;
+  }
+  RefineNodeRegion(node);
+  Node &edited = GetNode(node);
+  edited.mu = mu;
+  if (engine == Engine::kNextReaction && edited.population > 0) {
+    RescheduleNode(node);
+  }
+
+  return true;
+}
@@ -0,0 +1,318 @@
+#include "stn3d/snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "stn3d/chunks.h"
+#include "stn3d/dynamics.h"
+#include "stn3d/util.h"
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "The snapshot seqlock must be lock free to be shared");
+
+// Node records a new segment holds before it first grows
+static constexpr uint64_t kSnapshotInitialCapacity = 64;
+
+// Attempts a reader makes before deciding the writer has died mid-snapshot
+static constexpr int kSnapshotReadAttempts = 100000;
+
+// The segment being published by this process
+static int segment_fd = -1;
+static SnapshotHeader *segment_header = nullptr;
+static size_t segment_size = 0;
+
+// Returns the bytes of a segment holding capacity node records
+static size_t GetSegmentSize(const uint64_t capacity) {
+  return sizeof(SnapshotHeader) + (capacity * sizeof(SnapshotNode));
+}
+
+// Returns the node records following a segment header
+static SnapshotNode *GetSegmentNodes(SnapshotHeader *header) {
+  return reinterpret_cast<SnapshotNode *>(header + 1);
+}
+
+// Resizes and remaps the published segment to hold capacity node records.
+// Returns false if it can't be resized, leaving no segment open
+static bool ResizeSegment(const uint64_t capacity) {
+#if defined(_WIN32) || defined(_WIN64)
+  (void)capacity;
+  return false;
+#else
+  if (segment_header != nullptr) {
+    munmap(segment_header, segment_size);
+    segment_header = nullptr;
+  }
+  segment_size = GetSegmentSize(capacity);
+  if (ftruncate(segment_fd, static_cast<off_t>(segment_size)) != 0) {
+    CloseSnapshotSegment();
+    return false;
+  }
+  void *mapping = mmap(nullptr, segment_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, segment_fd, 0);
+  if (mapping == MAP_FAILED) {
+    CloseSnapshotSegment();
+    return false;
+  }
+  segment_header = static_cast<SnapshotHeader *>(mapping);
+
+  return true;
+#endif
+}
+
+// Creates a shared memory segment and starts publishing snapshots to it. The
+// name is a POSIX shared memory name, e.g. "/stn3d". A segment left by an
+// earlier run is unlinked rather than truncated, so monitors still mapping it
+// are unaffected. Returns false if the segment can't be created, or on
+// platforms without shared memory
+bool OpenSnapshotSegment(const std::string &name) {
+#if defined(_WIN32) || defined(_WIN64)
+  (void)name;
+  return false;
+#else
+  CloseSnapshotSegment();
+  shm_unlink(name.c_str());
+  segment_fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (segment_fd < 0) {
+    return false;
+  }
+  if (!ResizeSegment(kSnapshotInitialCapacity)) {
+    return false;
+  }
+
+  SnapshotHeader *header = new (segment_header) SnapshotHeader;
+  std::memcpy(header->magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+  header->version = kSnapshotVersion;
+  header->dimensions = D;
+  header->lattice_length = X;
+  header->sequence.store(0, std::memory_order_relaxed);
+  header->capacity = kSnapshotInitialCapacity;
+  header->node_count = 0;
+  header->generation = 0;
+  header->population = 0;
+  header->time = 0.0;
+  header->running = 1;
+  header->reserved = 0;
+
+  return true;
+#endif
+}
+
+// Fills a snapshot record with the state of a node and its most populous
+// genotypes
+static void RecordNode(const NodeIndex index, SnapshotNode &record) {
+  const Node &node = *FindNode(index);
+  record.node = index;
+  record.population = node.population;
+  record.existent_count = static_cast<int32_t>(node.existent_genotypes.size());
+  record.reserved = 0;
+  record.mu = node.mu;
+  for (int slot = 0; slot < kSnapshotTopGenotypes; slot++) {
+    record.top_genotypes[slot] = 0;
+    record.top_counts[slot] = 0;
+  }
+
+  // Insert each genotype into the sorted top slots, if it's populous enough
+  for (Genotype genotype : node.existent_genotypes) {
+    const int count = node.genotype_counts[genotype];
+    int slot = kSnapshotTopGenotypes;
+    while (slot > 0 && count > record.top_counts[slot - 1]) {
+      slot--;
+    }
+    if (slot == kSnapshotTopGenotypes) {
+      continue;
+    }
+    for (int shifted = kSnapshotTopGenotypes - 1; shifted > slot; shifted--) {
+      record.top_genotypes[shifted] = record.top_genotypes[shifted - 1];
+      record.top_counts[shifted] = record.top_counts[shifted - 1];
+    }
+    record.top_genotypes[slot] = genotype;
+    record.top_counts[slot] = count;
+  }
+}
+
+// Opens a seqlock write section on the published segment
+static uint64_t BeginSnapshotWrite() {
+  const uint64_t sequence =
+      segment_header->sequence.load(std::memory_order_relaxed);
+  segment_header->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  return sequence;
+}
+
+// Closes a seqlock write section, making the snapshot visible to readers
+static void EndSnapshotWrite(const uint64_t sequence) {
+  segment_header->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Publishes the state of the lattice to the open segment, if any. Called at
+// generation boundaries, so costs nothing per step
+void PublishSnapshot() {
+  if (segment_header == nullptr) {
+    return;
+  }
+
+  // Grow outside the write section, so readers keep a valid mapping
+  const uint64_t capacity = segment_header->capacity;
+  if (occupied_nodes.size() > capacity) {
+    const uint64_t grown =
+        std::max<uint64_t>(2 * capacity, occupied_nodes.size());
+    if (!ResizeSegment(grown)) {
+      return;
+    }
+  }
+
+  const uint64_t sequence = BeginSnapshotWrite();
+  segment_header->capacity = (segment_size - sizeof(SnapshotHeader)) /
+                             sizeof(SnapshotNode);
+  segment_header->node_count = occupied_nodes.size();
+  segment_header->generation = sim_state.generation;
+  segment_header->population = sim_state.population;
+  segment_header->time = sim_state.time;
+  SnapshotNode *records = GetSegmentNodes(segment_header);
+  for (size_t idx = 0; idx < occupied_nodes.size(); idx++) {
+    RecordNode(occupied_nodes[idx], records[idx]);
+  }
+  EndSnapshotWrite(sequence);
+}
+
+// Marks the published segment as no longer running and unmaps it. The
+// segment itself remains for monitors to read until it's next opened
+void CloseSnapshotSegment() {
+#if !defined(_WIN32) && !defined(_WIN64)
+  if (segment_header != nullptr) {
+    const uint64_t sequence = BeginSnapshotWrite();
+    segment_header->running = 0;
+    EndSnapshotWrite(sequence);
+    munmap(segment_header, segment_size);
+  }
+  if (segment_fd >= 0) {
+    close(segment_fd);
+  }
+#endif
+  segment_header = nullptr;
+  segment_size = 0;
+  segment_fd = -1;
+}
+
+SnapshotReader::~SnapshotReader() { Close(); }
+
+// Maps the segment of a running or finished simulation. Returns false if it
+// doesn't exist or isn't a snapshot segment
+bool SnapshotReader::Open(const std::string &name) {
+#if defined(_WIN32) || defined(_WIN64)
+  (void)name;
+  return false;
+#else
+  Close();
+  fd_ = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd_ < 0 || !Map()) {
+    Close();
+    return false;
+  }
+
+  const SnapshotHeader *header = static_cast<const SnapshotHeader *>(data_);
+  if (std::memcmp(header->magic, kSnapshotMagic, sizeof(kSnapshotMagic)) !=
+          0 ||
+      header->version != kSnapshotVersion) {
+    Close();
+    return false;
+  }
+
+  return true;
+#endif
+}
+
+// Maps the whole of the segment at its current size
+bool SnapshotReader::Map() {
+#if defined(_WIN32) || defined(_WIN64)
+  return false;
+#else
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+    data_ = nullptr;
+  }
+  struct stat status;
+  if (fstat(fd_, &status) != 0 ||
+      static_cast<size_t>(status.st_size) < sizeof(SnapshotHeader)) {
+    return false;
+  }
+  size_ = static_cast<size_t>(status.st_size);
+  void *mapping = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  data_ = mapping;
+
+  return true;
+#endif
+}
+
+void SnapshotReader::Close() {
+#if !defined(_WIN32) && !defined(_WIN64)
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+#endif
+  data_ = nullptr;
+  size_ = 0;
+  fd_ = -1;
+}
+
+// Copies the latest published snapshot, retrying while the simulation is
+// writing one. Returns false if no consistent snapshot could be read
+bool SnapshotReader::Read(Snapshot &snapshot) {
+#if defined(_WIN32) || defined(_WIN64)
+  (void)snapshot;
+  return false;
+#else
+  for (int attempt = 0; attempt < kSnapshotReadAttempts && data_ != nullptr;
+       attempt++) {
+    const SnapshotHeader *header = static_cast<const SnapshotHeader *>(data_);
+    const uint64_t sequence = header->sequence.load(std::memory_order_acquire);
+    if (sequence % 2 == 1) {
+      sched_yield();
+      continue;
+    }
+
+    // Remap if the segment grew since it was mapped
+    const uint64_t node_count = header->node_count;
+    if (GetSegmentSize(header->capacity) > size_ ||
+        GetSegmentSize(node_count) > size_) {
+      if (!Map()) {
+        return false;
+      }
+      continue;
+    }
+
+    snapshot.dimensions = header->dimensions;
+    snapshot.lattice_length = header->lattice_length;
+    snapshot.generation = header->generation;
+    snapshot.population = header->population;
+    snapshot.time = header->time;
+    snapshot.running = header->running != 0;
+    snapshot.nodes.resize(node_count);
+    std::memcpy(snapshot.nodes.data(), header + 1,
+                node_count * sizeof(SnapshotNode));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header->sequence.load(std::memory_order_relaxed) == sequence) {
+      return true;
+    }
+  }
+
+  return false;
+#endif
+}
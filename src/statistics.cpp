@@ -0,0 +1,207 @@
+#include "stn3d/statistics.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// Significance levels of the Anderson-Darling critical values, and the
+// coefficients giving the critical value for k samples as
+// b0 + b1 / sqrt(k - 1) + b2 / (k - 1)
+static constexpr std::array<double, 7> kAndersonDarlingLevels = {
+    0.25, 0.1, 0.05, 0.025, 0.01, 0.005, 0.001};
+static constexpr std::array<double, 7> kAndersonDarlingB0 = {
+    0.675, 1.281, 1.645, 1.96, 2.326, 2.573, 3.085};
+static constexpr std::array<double, 7> kAndersonDarlingB1 = {
+    -0.245, 0.25, 0.678, 1.149, 1.822, 2.364, 3.615};
+static constexpr std::array<double, 7> kAndersonDarlingB2 = {
+    -0.105, -0.305, -0.362, -0.391, -0.396, -0.345, -0.154};
+
+// Returns Q(lambda) = 2 sum_{j>=1} (-1)^(j-1) exp(-2 j^2 lambda^2): the
+// probability that the scaled Kolmogorov statistic exceeds lambda
+double GetKolmogorovSurvival(const double lambda) {
+  // The series converges too slowly to sum below this, where Q is 1 to
+  // within double precision
+  if (lambda < 0.2) {
+    return 1.0;
+  }
+
+  double sum = 0.0;
+  double sign = 1.0;
+  for (int j = 1; j <= 100; j++) {
+    const double term = sign * 2.0 * std::exp(-2.0 * j * j * lambda * lambda);
+    sum += term;
+    if (std::fabs(term) < 1e-16 * std::fabs(sum)) {
+      break;
+    }
+    sign = -sign;
+  }
+
+  return std::clamp(sum, 0.0, 1.0);
+}
+
+// Two-sample Kolmogorov-Smirnov test. The statistic is the largest distance
+// between the empirical distribution functions, evaluated after all values
+// tied at each point
+TestResult KolmogorovSmirnovTest(std::vector<double> sample_a,
+                                 std::vector<double> sample_b) {
+  if (sample_a.empty() || sample_b.empty()) {
+    return {0.0, 1.0};
+  }
+  std::sort(sample_a.begin(), sample_a.end());
+  std::sort(sample_b.begin(), sample_b.end());
+
+  const double n_a = static_cast<double>(sample_a.size());
+  const double n_b = static_cast<double>(sample_b.size());
+  size_t idx_a = 0;
+  size_t idx_b = 0;
+  double distance = 0.0;
+  while (idx_a < sample_a.size() && idx_b < sample_b.size()) {
+    const double value = std::min(sample_a[idx_a], sample_b[idx_b]);
+    while (idx_a < sample_a.size() && sample_a[idx_a] == value) {
+      idx_a++;
+    }
+    while (idx_b < sample_b.size() && sample_b[idx_b] == value) {
+      idx_b++;
+    }
+    distance = std::max(distance, std::fabs((idx_a / n_a) - (idx_b / n_b)));
+  }
+
+  const double effective_n = std::sqrt((n_a * n_b) / (n_a + n_b));
+  const double lambda = (effective_n + 0.12 + (0.11 / effective_n)) * distance;
+
+  return {distance, GetKolmogorovSurvival(lambda)};
+}
+
+// Returns the coefficients c of the least squares fit y = c0 + c1 x + c2 x^2
+static std::array<double, 3> FitQuadratic(const std::array<double, 7> &x,
+                                          const std::array<double, 7> &y) {
+  // Normal equations, solved by Gaussian elimination
+  std::array<std::array<double, 4>, 3> system = {};
+  for (size_t point = 0; point < x.size(); point++) {
+    const std::array<double, 3> powers = {1.0, x[point], x[point] * x[point]};
+    for (int row = 0; row < 3; row++) {
+      for (int col = 0; col < 3; col++) {
+        system[row][col] += powers[row] * powers[col];
+      }
+      system[row][3] += powers[row] * y[point];
+    }
+  }
+  for (int pivot = 0; pivot < 3; pivot++) {
+    for (int row = pivot + 1; row < 3; row++) {
+      const double factor = system[row][pivot] / system[pivot][pivot];
+      for (int col = pivot; col < 4; col++) {
+        system[row][col] -= factor * system[pivot][col];
+      }
+    }
+  }
+  std::array<double, 3> coefficients = {};
+  for (int row = 2; row >= 0; row--) {
+    double value = system[row][3];
+    for (int col = row + 1; col < 3; col++) {
+      value -= system[row][col] * coefficients[col];
+    }
+    coefficients[row] = value / system[row][row];
+  }
+
+  return coefficients;
+}
+
+// Returns the approximate p-value of a standardised k-sample Anderson-Darling
+// statistic, by fitting log significance as a quadratic in the critical values
+static double GetAndersonDarlingP(const double statistic, const size_t k) {
+  const double m = static_cast<double>(k - 1);
+  std::array<double, 7> critical;
+  std::array<double, 7> log_levels;
+  for (size_t level = 0; level < critical.size(); level++) {
+    critical[level] = kAndersonDarlingB0[level] +
+                      (kAndersonDarlingB1[level] / std::sqrt(m)) +
+                      (kAndersonDarlingB2[level] / m);
+    log_levels[level] = std::log(kAndersonDarlingLevels[level]);
+  }
+  if (statistic < critical.front()) {
+    return kAndersonDarlingMaxP;
+  }
+
+  const std::array<double, 3> fit = FitQuadratic(critical, log_levels);
+  const double p = std::exp(fit[0] + (fit[1] * statistic) +
+                            (fit[2] * statistic * statistic));
+
+  return std::min(p, kAndersonDarlingMaxP);
+}
+
+// k-sample Anderson-Darling test for continuous distributions with ties,
+// using the midrank statistic A2akN of Scholz and Stephens (1987). Returns the
+// statistic standardised by its mean k - 1 and variance under the null
+TestResult AndersonDarlingTest(std::vector<std::vector<double>> samples) {
+  std::vector<double> pooled;
+  for (std::vector<double> &sample : samples) {
+    if (sample.empty()) {
+      return {0.0, 1.0};
+    }
+    std::sort(sample.begin(), sample.end());
+    pooled.insert(pooled.end(), sample.begin(), sample.end());
+  }
+  std::sort(pooled.begin(), pooled.end());
+  const size_t k = samples.size();
+  const double N = static_cast<double>(pooled.size());
+  if (k < 2 || pooled.front() == pooled.back() || pooled.size() < 4) {
+    return {0.0, 1.0};
+  }
+
+  // Sum over the distinct values z_j of the pooled sample
+  double a2 = 0.0;
+  std::vector<size_t> below(k, 0);
+  for (size_t left = 0; left < pooled.size();) {
+    const double value = pooled[left];
+    size_t right = left;
+    while (right < pooled.size() && pooled[right] == value) {
+      right++;
+    }
+    const double tied = static_cast<double>(right - left);
+    const double b = left + (tied / 2.0);
+    const double denominator = (b * (N - b)) - ((N * tied) / 4.0);
+
+    for (size_t sample = 0; sample < k; sample++) {
+      const std::vector<double> &values = samples[sample];
+      size_t at_or_below = below[sample];
+      while (at_or_below < values.size() && values[at_or_below] == value) {
+        at_or_below++;
+      }
+      const double n = static_cast<double>(values.size());
+      const double m = (below[sample] + at_or_below) / 2.0;
+      const double deviation = (N * m) - (b * n);
+      a2 += (tied / N) * deviation * deviation / denominator / n;
+      below[sample] = at_or_below;
+    }
+    left = right;
+  }
+  a2 *= (N - 1.0) / N;
+
+  // Variance of A2akN under the null hypothesis
+  double H = 0.0;
+  for (const std::vector<double> &sample : samples) {
+    H += 1.0 / static_cast<double>(sample.size());
+  }
+  std::vector<double> harmonic(pooled.size(), 0.0);
+  for (size_t idx = 1; idx < pooled.size(); idx++) {
+    harmonic[idx] = harmonic[idx - 1] + (1.0 / idx);
+  }
+  const double h = harmonic[pooled.size() - 1];
+  double g = 0.0;
+  for (size_t idx = 1; idx + 1 < pooled.size(); idx++) {
+    g += (h - harmonic[idx]) / (N - idx);
+  }
+  const double kd = static_cast<double>(k);
+  const double a = ((4 * g - 6) * (kd - 1)) + ((10 - 6 * g) * H);
+  const double b = ((2 * g - 4) * kd * kd) + (8 * h * kd) +
+                   ((2 * g - 14 * h - 4) * H) - (8 * h) + (4 * g) - 6;
+  const double c = ((6 * h + 2 * g - 2) * kd * kd) +
+                   ((4 * h - 4 * g + 6) * kd) + ((2 * h - 6) * H) + (4 * h);
+  const double d = ((2 * h + 6) * kd * kd) - (4 * h * kd);
+  const double variance = ((a * N * N * N) + (b * N * N) + (c * N) + d) /
+                          ((N - 1) * (N - 2) * (N - 3));
+
+  const double statistic = (a2 - (kd - 1)) / std::sqrt(variance);
+
+  return {statistic, GetAndersonDarlingP(statistic, k)};
+}
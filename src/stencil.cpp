@@ -0,0 +1,114 @@
+#include "stn3d/stencil.h"
+
+#include <array>
+#include <cstdlib>
+
+Neighbourhood neighbourhood = NEIGHBOURHOOD;
+Boundary boundary = BOUNDARY;
+int stencil_size = 0;
+std::vector<std::array<int, D>> stencil_offsets;
+
+// Returns the unit offsets of a neighbourhood in D dimensions, ordered
+// lexicographically with the first axis varying slowest
+static std::vector<std::array<int, D>> GetStencilOffsets(
+    const Neighbourhood stencil_neighbourhood) {
+  std::vector<std::array<int, D>> offsets;
+  int combinations = 1;
+  for (int axis = 0; axis < D; axis++) {
+    combinations *= 3;
+  }
+
+  for (int combination = 0; combination < combinations; combination++) {
+    std::array<int, D> offset;
+    int remainder = combination;
+    int distance = 0;
+    for (int axis = D - 1; axis >= 0; axis--) {
+      offset[axis] = (remainder % 3) - 1;
+      remainder /= 3;
+      distance += abs(offset[axis]);
+    }
+
+    if (distance == 0 ||
+        (stencil_neighbourhood == Neighbourhood::kVonNeumann &&
+         distance != 1)) {
+      continue;
+    }
+    offsets.push_back(offset);
+  }
+
+  return offsets;
+}
+
+// Applies the boundary condition to a coordinate one step outside [0, X - 1],
+// returning -1 if the coordinate is absorbed
+static int ApplyBoundary(const int coord) {
+  if (coord >= 0 && coord <= X - 1) {
+    return coord;
+  }
+
+  switch (boundary) {
+    case Boundary::kReflective:
+      return coord < 0 ? -coord : (2 * (X - 1)) - coord;
+    case Boundary::kAbsorbing:
+      return -1;
+    case Boundary::kPeriodic:
+    default:
+      return coord < 0 ? coord + X : coord - X;
+  }
+}
+
+// Selects the migration topology and rebuilds the neighbour table
+void SetStencil(const Neighbourhood stencil_neighbourhood,
+                const Boundary stencil_boundary) {
+  neighbourhood = stencil_neighbourhood;
+  boundary = stencil_boundary;
+  BuildNeighbourTable();
+}
+
+// Builds the stencil offsets for the current neighbourhood, and the neighbour
+// table rows of every allocated chunk for the current boundary conditions
+void BuildNeighbourTable() {
+  stencil_offsets = GetStencilOffsets(neighbourhood);
+  stencil_size = static_cast<int>(stencil_offsets.size());
+
+  for (uint32_t idx = 0; idx < chunks.size(); idx++) {
+    if (chunks[idx]) {
+      BuildNeighbourRows(chunks[idx].use_count() > 1 ? CloneChunk(idx)
+                                                     : *chunks[idx]);
+    }
+  }
+}
+
+// Builds the neighbour table rows of the nodes of a chunk. Rows of padding
+// nodes beyond the lattice are left absorbed
+void BuildNeighbourRows(Chunk &chunk) {
+  chunk.neighbours.assign(static_cast<size_t>(kChunkNodes) * stencil_size,
+                          kAbsorbed);
+
+  for (uint32_t offset = 0; offset < kChunkNodes; offset++) {
+    const Coords &coords = chunk.nodes[offset].coords;
+    bool in_lattice = true;
+    for (LatticeCoord coord : coords) {
+      in_lattice = in_lattice && coord < X;
+    }
+    if (!in_lattice) {
+      continue;
+    }
+
+    for (int n = 0; n < stencil_size; n++) {
+      Coords destination;
+      bool absorbed = false;
+      for (int axis = 0; axis < D; axis++) {
+        const int coord =
+            ApplyBoundary(coords[axis] + stencil_offsets[n][axis]);
+        absorbed = absorbed || coord < 0;
+        destination[axis] = static_cast<LatticeCoord>(coord);
+      }
+
+      if (!absorbed) {
+        chunk.neighbours[(offset * stencil_size) + n] =
+            Lattice::Index(destination);
+      }
+    }
+  }
+}
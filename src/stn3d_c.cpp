@@ -0,0 +1,120 @@
+#include "stn3d/stn3d_c.h"
+
+#include <type_traits>
+
+#include "stn3d/initialise.h"
+#include "stn3d/run.h"
+
+static_assert(sizeof(LatticeCoord) == sizeof(uint16_t),
+              "stn3d_node_view coordinates must match LatticeCoord");
+static_assert(sizeof(NodeIndex) == sizeof(uint32_t),
+              "stn3d_get_occupied_nodes must match NodeIndex");
+
+// The most recently viewed node of an unallocated chunk
+static Node empty_node;
+
+// Creates a run, returning 0 on success or -1 if the parameters of the build
+// are invalid, the landscape file or resource volume can't be mapped or a run
+// already exists
+int stn3d_create(const stn3d_options *options) {
+  RunOptions run_options = {};
+  if (options != nullptr) {
+    run_options.seed = options->seed;
+    run_options.write_output = options->write_output != 0;
+    run_options.landscape_path = options->landscape_path;
+  }
+
+  return CreateRun(run_options) ? 0 : -1;
+}
+
+// Destroys the run
+void stn3d_destroy(void) { DestroyRun(); }
+
+// Advances the run by a number of steps, returning 1 while the population
+// survives, or 0 once it is extinct or if no run exists
+int stn3d_advance_steps(const uint64_t steps) {
+  return AdvanceSteps(steps) ? 1 : 0;
+}
+
+// Advances the run by a number of generations, returning 1 while the
+// population survives, or 0 once it is extinct or if no run exists
+int stn3d_advance_generations(const uint32_t generations) {
+  return AdvanceGenerations(generations) ? 1 : 0;
+}
+
+// Fills lattice with the parameters the library was built with
+void stn3d_get_lattice(stn3d_lattice *lattice) {
+  lattice->dimensions = D;
+  lattice->lattice_length = X;
+  lattice->node_count = kNodesTot;
+  lattice->genome_length = L;
+  lattice->genotype_count = GENOTYPES_TOT;
+}
+
+// Fills state with the progress of the run
+void stn3d_get_state(stn3d_state *state) {
+  const SimState &sim = GetRunState();
+  state->generation = sim.generation;
+  state->step = sim.step;
+  state->tau = sim.tau;
+  state->population = sim.population;
+  state->time = sim.time;
+  state->clock = sim.clock;
+}
+
+// Fills view with a zero-copy view of a node. Nodes of unallocated chunks are
+// viewed through a shared empty node. Returns 0 on success or -1 if the node
+// is outside the lattice or no run exists
+int stn3d_get_node(const uint32_t node, stn3d_node_view *view) {
+  if (!RunExists() || node >= kNodesTot) {
+    return -1;
+  }
+
+  const Node *viewed = GetNodeView(node);
+  if (viewed == nullptr) {
+    empty_node.coords = Lattice::Coordinates(node);
+    empty_node.population = 0;
+    AssignResources(empty_node);
+    viewed = &empty_node;
+  }
+
+  const GenotypeCounts &counts = viewed->genotype_counts;
+  view->coords = viewed->coords.data();
+  view->population = &viewed->population;
+  view->mu = &viewed->mu;
+  view->count_width = counts.Width();
+  view->genotype_counts =
+      counts.Width() == 0
+          ? nullptr
+          : counts.Visit([](const auto &data) -> const void * {
+              if constexpr (std::is_pointer_v<std::decay_t<decltype(data)>>) {
+                return data;
+              } else {
+                return nullptr;
+              }
+            });
+  view->existent_genotypes = viewed->existent_genotypes.data();
+  view->existent_count = viewed->existent_genotypes.size();
+
+  return 0;
+}
+
+// Returns the count of a genotype on a node, or -1 if the node or genotype is
+// outside the lattice or no run exists
+int32_t stn3d_get_genotype_count(const uint32_t node,
+                                 const uint64_t genotype) {
+  if (!RunExists() || node >= kNodesTot || (genotype & ~kGenotypeMask) != 0) {
+    return -1;
+  }
+  const Node *viewed = GetNodeView(node);
+
+  return viewed == nullptr ? 0 : viewed->genotype_counts[genotype];
+}
+
+// Points nodes at the indices of the occupied nodes, returning their number
+size_t stn3d_get_occupied_nodes(const uint32_t **nodes) {
+  const std::vector<NodeIndex> &occupied = GetOccupiedNodes();
+  *nodes = occupied.data();
+
+  return occupied.size();
+}
@@ -0,0 +1,382 @@
+#include "stn3d/trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "stn3d/chunks.h"
+#include "stn3d/dynamics.h"
+#include "stn3d/encoding.h"
+#include "stn3d/stencil.h"
+#include "stn3d/util.h"
+
+bool trace_recording = false;
+
+// Writer state for the trace of the running simulation
+static std::ofstream trace_file;
+static std::vector<uint8_t> trace_buffer;
+static std::vector<uint8_t> trace_keyframe_payload;
+static std::vector<TraceKeyframe> trace_index;
+static uint64_t trace_flushed_bytes = 0;
+static int trace_last_step = 0;
+static int trace_keyframe_generations = kTraceKeyframeGenerations;
+
+// Appends the tag of a record, holding the steps since the previous record
+static void AppendTraceTag(const TraceRecord type) {
+  const auto steps = static_cast<uint64_t>(sim_state.step - trace_last_step);
+  trace_last_step = sim_state.step;
+  AppendVarint(trace_buffer,
+               (steps << kTraceTypeBits) | static_cast<uint64_t>(type));
+}
+
+// Appends the buffered records to the file once the buffer is full
+static void FlushTraceBuffer(const bool full_only) {
+  if (full_only && trace_buffer.size() < kTraceBufferBytes) {
+    return;
+  }
+
+  trace_file.write(reinterpret_cast<const char *>(trace_buffer.data()),
+                   static_cast<std::streamsize>(trace_buffer.size()));
+  trace_flushed_bytes += trace_buffer.size();
+  trace_buffer.clear();
+}
+
+// Creates an event trace and writes a provisional header, which is completed
+// by CloseEventTrace. A keyframe is recorded every keyframe_generations
+// generations
+bool OpenEventTrace(const std::string &path, const int keyframe_generations) {
+  CloseEventTrace();
+  trace_file.open(path, std::ios::binary | std::ios::trunc);
+  if (!trace_file.is_open()) {
+    return false;
+  }
+
+  TraceHeader header = {};
+  trace_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  trace_buffer.clear();
+  trace_buffer.reserve(kTraceBufferBytes + 64);
+  trace_index.clear();
+  trace_flushed_bytes = sizeof(header);
+  trace_last_step = sim_state.step;
+  trace_keyframe_generations = std::max(keyframe_generations, 1);
+  trace_recording = true;
+
+  return true;
+}
+
+// Records the birth of an offspring genotype to a parent on a node
+void TraceBirth(const NodeIndex node, const Genotype parent,
+                const Genotype offspring) {
+  AppendTraceTag(TraceRecord::kBirth);
+  AppendVarint(trace_buffer, node);
+  AppendVarint(trace_buffer, parent);
+  AppendVarint(trace_buffer, offspring);
+  FlushTraceBuffer(true);
+}
+
+// Records the death of an individual of a genotype on a node
+void TraceDeath(const NodeIndex node, const Genotype genotype) {
+  AppendTraceTag(TraceRecord::kDeath);
+  AppendVarint(trace_buffer, node);
+  AppendVarint(trace_buffer, genotype);
+  FlushTraceBuffer(true);
+}
+
+// Records the deaths of count individuals of a genotype on a node at once, as
+// a treatment kills them
+void TraceDeaths(const NodeIndex node, const Genotype genotype,
+                 const uint32_t count) {
+  AppendTraceTag(TraceRecord::kDeaths);
+  AppendVarint(trace_buffer, node);
+  AppendVarint(trace_buffer, genotype);
+  AppendVarint(trace_buffer, count);
+  FlushTraceBuffer(true);
+}
+
+// Records the migration of an individual of a genotype from a node to a
+// destination, which is kAbsorbed if the individual left the lattice
+void TraceMigration(const NodeIndex node, const Genotype genotype,
+                    const NodeIndex destination) {
+  AppendTraceTag(TraceRecord::kMigration);
+  AppendVarint(trace_buffer, node);
+  AppendVarint(trace_buffer, genotype);
+  AppendVarint(trace_buffer, destination == kAbsorbed
+                                 ? 0
+                                 : static_cast<uint64_t>(destination) + 1);
+  FlushTraceBuffer(true);
+}
+
+// Records the end of a generation, followed by a keyframe if one is due.
+// Called once the generation has advanced and its step has reset
+void TraceGenerationEnd() {
+  AppendVarint(trace_buffer, static_cast<uint64_t>(TraceRecord::kGeneration));
+  trace_last_step = 0;
+  if (sim_state.generation % trace_keyframe_generations == 0) {
+    WriteTraceKeyframe();
+  }
+  FlushTraceBuffer(true);
+}
+
+// Records the genotype counts of every occupied node, and indexes the record.
+// Called at the start of a generation
+void WriteTraceKeyframe() {
+  trace_keyframe_payload.clear();
+  AppendVarint(trace_keyframe_payload,
+               static_cast<uint64_t>(sim_state.generation));
+  AppendVarint(trace_keyframe_payload, occupied_nodes.size());
+  std::vector<Genotype> genotypes;
+  for (NodeIndex index : occupied_nodes) {
+    const Node &node = *FindNode(index);
+    genotypes.assign(node.existent_genotypes.begin(),
+                     node.existent_genotypes.end());
+    std::sort(genotypes.begin(), genotypes.end());
+
+    AppendVarint(trace_keyframe_payload, index);
+    AppendVarint(trace_keyframe_payload, genotypes.size());
+    Genotype previous = 0;
+    for (Genotype genotype : genotypes) {
+      AppendVarint(trace_keyframe_payload, genotype - previous);
+      AppendVarint(trace_keyframe_payload,
+                   static_cast<uint64_t>(node.genotype_counts[genotype]));
+      previous = genotype;
+    }
+  }
+
+  trace_index.push_back({static_cast<uint64_t>(sim_state.generation),
+                         trace_flushed_bytes + trace_buffer.size()});
+  AppendVarint(trace_buffer, static_cast<uint64_t>(TraceRecord::kKeyframe));
+  AppendVarint(trace_buffer, trace_keyframe_payload.size());
+  trace_buffer.insert(trace_buffer.end(), trace_keyframe_payload.begin(),
+                      trace_keyframe_payload.end());
+  trace_last_step = sim_state.step;
+}
+
+// Writes the buffered records and the keyframe index, and completes the
+// header of the open trace
+void CloseEventTrace() {
+  trace_recording = false;
+  if (!trace_file.is_open()) {
+    return;
+  }
+
+  FlushTraceBuffer(false);
+  const uint64_t records_end = trace_flushed_bytes;
+  const char padding[8] = {0};
+  trace_file.write(padding, static_cast<std::streamsize>(
+                                (8 - (trace_flushed_bytes % 8)) % 8));
+
+  TraceHeader header = {};
+  std::memcpy(header.magic, kTraceMagic, sizeof(kTraceMagic));
+  header.version = kTraceVersion;
+  header.node_count = kNodesTot;
+  header.lattice_length = X;
+  header.genome_length = L;
+  header.dimensions = D;
+  header.records_end = records_end;
+  header.keyframe_count = trace_index.size();
+  header.index_offset = static_cast<uint64_t>(trace_file.tellp());
+
+  trace_file.write(reinterpret_cast<const char *>(trace_index.data()),
+                   static_cast<std::streamsize>(trace_index.size() *
+                                                sizeof(TraceKeyframe)));
+  trace_file.seekp(0);
+  trace_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  trace_file.close();
+}
+
+EventTrace::~EventTrace() { Close(); }
+
+// Maps a trace read-only and validates its header, returning false if the
+// file is missing, truncated or not a completed trace
+bool EventTrace::Open(const std::string &path) {
+  Close();
+  if (!file_.Open(path)) {
+    return false;
+  }
+  data_ = file_.Data();
+  size_ = file_.Size();
+
+  header_ = reinterpret_cast<const TraceHeader *>(data_);
+  if (size_ < sizeof(TraceHeader) ||
+      std::memcmp(header_->magic, kTraceMagic, sizeof(kTraceMagic)) != 0 ||
+      header_->version != kTraceVersion ||
+      header_->records_end < sizeof(TraceHeader) ||
+      header_->index_offset < header_->records_end ||
+      header_->keyframe_count > size_ / sizeof(TraceKeyframe) ||
+      !file_.Spans(header_->index_offset,
+                   header_->keyframe_count * sizeof(TraceKeyframe))) {
+    Close();
+    return false;
+  }
+  index_ = reinterpret_cast<const TraceKeyframe *>(data_ +
+                                                   header_->index_offset);
+
+  return true;
+}
+
+// Unmaps the trace
+void EventTrace::Close() {
+  file_.Close();
+  data_ = nullptr;
+  size_ = 0;
+  header_ = nullptr;
+  index_ = nullptr;
+}
+
+// Adds an individual of a genotype to a node of a replayed state
+static void AddTraceIndividual(TraceState &state, const NodeIndex node,
+                               const Genotype genotype) {
+  state.nodes[node][genotype]++;
+  state.population++;
+}
+
+// Removes individuals of a genotype from a node of a replayed state,
+// forgetting the genotype and node once they're empty. Returns false if the
+// node holds fewer individuals of the genotype
+static bool RemoveTraceIndividuals(TraceState &state, const NodeIndex node,
+                                   const Genotype genotype,
+                                   const uint64_t count = 1) {
+  std::map<Genotype, uint32_t> &counts = state.nodes[node];
+  const auto held = counts.find(genotype);
+  if (held == counts.end() || held->second < count) {
+    return false;
+  }
+  held->second -= static_cast<uint32_t>(count);
+  if (held->second == 0) {
+    counts.erase(held);
+    if (counts.empty()) {
+      state.nodes.erase(node);
+    }
+  }
+  state.population -= static_cast<int64_t>(count);
+
+  return true;
+}
+
+// Replaces a replayed state with the keyframe payload from data to end.
+// Returns false if the payload is truncated
+static bool ReadTraceKeyframe(const uint8_t *data, const uint8_t *end,
+                              TraceState &state) {
+  uint64_t generation, node_count, node, existent_count, delta, count;
+  data = ReadVarint(data, end, generation);
+  data = ReadVarint(data, end, node_count);
+  state.generation = static_cast<int>(generation);
+  state.step = 0;
+  state.population = 0;
+  state.nodes.clear();
+  for (uint64_t idx = 0; data != nullptr && idx < node_count; idx++) {
+    data = ReadVarint(data, end, node);
+    data = ReadVarint(data, end, existent_count);
+    std::map<Genotype, uint32_t> &counts =
+        state.nodes[static_cast<NodeIndex>(node)];
+    Genotype genotype = 0;
+    for (uint64_t existent = 0; data != nullptr && existent < existent_count;
+         existent++) {
+      data = ReadVarint(data, end, delta);
+      data = ReadVarint(data, end, count);
+      genotype += delta;
+      counts[genotype] = static_cast<uint32_t>(count);
+      state.population += static_cast<int64_t>(count);
+    }
+  }
+
+  return data != nullptr;
+}
+
+// Rebuilds the counts of every node after a number of steps of a generation,
+// by replaying the events since the last keyframe before it. Returns false if
+// the trace ends before the generation or its records are truncated
+bool EventTrace::Seek(const int generation, const int step,
+                      TraceState &state) const {
+  const TraceKeyframe *keyframe = std::upper_bound(
+      index_, index_ + header_->keyframe_count, generation,
+      [](const int target, const TraceKeyframe &entry) {
+        return static_cast<uint64_t>(target) < entry.generation;
+      });
+  if (generation < 0 || keyframe == index_) {
+    return false;
+  }
+  keyframe--;
+
+  const uint8_t *end = data_ + header_->records_end;
+  if (keyframe->offset >= header_->records_end) {
+    return false;
+  }
+  const uint8_t *cursor = data_ + keyframe->offset;
+  uint64_t tag, payload_size;
+  cursor = ReadVarint(cursor, end, tag);
+  cursor = ReadVarint(cursor, end, payload_size);
+  if (cursor == nullptr ||
+      payload_size > static_cast<uint64_t>(end - cursor) ||
+      !ReadTraceKeyframe(cursor, cursor + payload_size, state)) {
+    return false;
+  }
+  cursor += payload_size;
+
+  uint64_t node, genotype, offspring, destination, count;
+  while (cursor != nullptr && cursor < end) {
+    cursor = ReadVarint(cursor, end, tag);
+    const auto type =
+        static_cast<TraceRecord>(tag & ((1 << kTraceTypeBits) - 1));
+    const int record_step =
+        state.step + static_cast<int>(tag >> kTraceTypeBits);
+
+    if (type == TraceRecord::kKeyframe) {
+      cursor = ReadVarint(cursor, end, payload_size);
+      cursor = cursor != nullptr &&
+                       payload_size <= static_cast<uint64_t>(end - cursor)
+                   ? cursor + payload_size
+                   : nullptr;
+      continue;
+    }
+    if (type == TraceRecord::kGeneration) {
+      if (state.generation == generation) {
+        break;
+      }
+      state.generation++;
+      state.step = 0;
+      continue;
+    }
+    if (state.generation == generation && record_step > step) {
+      break;
+    }
+    state.step = record_step;
+
+    cursor = ReadVarint(cursor, end, node);
+    cursor = ReadVarint(cursor, end, genotype);
+    if (cursor == nullptr) {
+      break;
+    }
+    const auto index = static_cast<NodeIndex>(node);
+    switch (type) {
+      case TraceRecord::kBirth:
+        cursor = ReadVarint(cursor, end, offspring);
+        AddTraceIndividual(state, index, offspring);
+        break;
+      case TraceRecord::kDeath:
+        RemoveTraceIndividuals(state, index, genotype);
+        break;
+      case TraceRecord::kDeaths:
+        cursor = ReadVarint(cursor, end, count);
+        if (cursor != nullptr &&
+            !RemoveTraceIndividuals(state, index, genotype, count)) {
+          cursor = nullptr;
+        }
+        break;
+      default:
+        cursor = ReadVarint(cursor, end, destination);
+        RemoveTraceIndividuals(state, index, genotype);
+        if (destination != 0) {
+          AddTraceIndividual(state, static_cast<NodeIndex>(destination - 1),
+                             genotype);
+        }
+        break;
+    }
+  }
+  if (cursor == nullptr || state.generation != generation) {
+    return false;
+  }
+  state.step = step;
+
+  return true;
+}
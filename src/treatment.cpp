@@ -0,0 +1,327 @@
+#include "stn3d/treatment.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include "stn3d/aggregates.h"
+#include "stn3d/chunks.h"
+#include "stn3d/coarse.h"
+#include "stn3d/events.h"
+#include "stn3d/lineage.h"
+#include "stn3d/trace.h"
+#include "stn3d/util.h"
+
+TreatmentState treatment;
+
+// Reads the optional coordinates of the box of a mu perturbation, defaulting
+// to the whole lattice. Returns false if they're incomplete or out of range
+static bool ParseBox(std::istringstream &iss, Perturbation &scaling) {
+  scaling.low.fill(0);
+  scaling.high.fill(X - 1);
+  if ((iss >> std::ws).eof()) {
+    return true;
+  }
+
+  for (Coords *corner : {&scaling.low, &scaling.high}) {
+    for (int axis = 0; axis < D; axis++) {
+      int coord;
+      if (!(iss >> coord) || coord < 0 || coord >= X) {
+        return false;
+      }
+      (*corner)[axis] = static_cast<LatticeCoord>(coord);
+    }
+  }
+  for (int axis = 0; axis < D; axis++) {
+    if (scaling.low[axis] > scaling.high[axis]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Reads the optional resistance of a kill perturbation, defaulting to none.
+// The mask may be decimal, or hexadecimal with a 0x prefix. Returns false if
+// it's incomplete or out of range
+static bool ParseResistance(std::istringstream &iss, Perturbation &kill) {
+  kill.resistant_fraction = kill.fraction;
+  kill.resistance_mask = 0;
+  if ((iss >> std::ws).eof()) {
+    return true;
+  }
+
+  std::string mask;
+  if (!(iss >> kill.resistant_fraction >> mask)) {
+    return false;
+  }
+  char *end;
+  errno = 0;
+  kill.resistance_mask = std::strtoull(mask.c_str(), &end, 0);
+
+  return *end == '\0' && mask[0] != '-' && errno != ERANGE &&
+         (kill.resistance_mask & ~kGenotypeMask) == 0 &&
+         kill.resistant_fraction >= 0.0 && kill.resistant_fraction <= 1.0;
+}
+
+// Parses a line of a treatment schedule into a perturbation, returning false
+// if it's malformed
+static bool ParsePerturbation(const std::string &line,
+                              Perturbation &perturbation) {
+  std::istringstream iss(line);
+  std::string kind;
+  perturbation = Perturbation{};
+  if (!(iss >> perturbation.generation >> kind) ||
+      perturbation.generation < 1) {
+    return false;
+  }
+
+  bool parsed = false;
+  if (kind == "kill") {
+    perturbation.kind = PerturbationKind::kKill;
+    parsed = iss >> perturbation.fraction && perturbation.fraction >= 0.0 &&
+             perturbation.fraction <= 1.0 &&
+             ParseResistance(iss, perturbation);
+  } else if (kind == "mu") {
+    perturbation.kind = PerturbationKind::kScaleMu;
+    parsed = iss >> perturbation.fraction && perturbation.fraction >= 0.0 &&
+             ParseBox(iss, perturbation);
+  } else if (kind == "block") {
+    perturbation.kind = PerturbationKind::kBlockMigration;
+    parsed = iss >> perturbation.generations && perturbation.generations > 0;
+  }
+
+  // Nothing may follow the perturbation
+  std::string trailing;
+  return parsed && !(iss >> trailing);
+}
+
+// Reads the treatment schedule of runs from a file, replacing any schedule
+// read before. An empty path clears the schedule. Returns false, leaving no
+// schedule, if the file can't be read or any line is malformed
+bool LoadTreatmentSchedule(const std::string &path) {
+  treatment.schedule.clear();
+  ResetTreatment();
+  if (path.empty()) {
+    return true;
+  }
+
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    const size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') {
+      continue;
+    }
+    Perturbation perturbation;
+    if (!ParsePerturbation(line, perturbation)) {
+      treatment.schedule.clear();
+      return false;
+    }
+    treatment.schedule.push_back(perturbation);
+  }
+  std::stable_sort(treatment.schedule.begin(), treatment.schedule.end(),
+                   [](const Perturbation &a, const Perturbation &b) {
+                     return a.generation < b.generation;
+                   });
+
+  return true;
+}
+
+// Rewinds progress through the schedule for a new run, keeping the schedule
+void ResetTreatment() {
+  treatment.next = 0;
+  treatment.migration_blocked_until = 0;
+  treatment.mu_scalings.clear();
+}
+
+// Returns true if coords lie within the box of a mu perturbation
+static bool IsInBox(const Coords &coords, const Perturbation &scaling) {
+  for (int axis = 0; axis < D; axis++) {
+    if (coords[axis] < scaling.low[axis] || coords[axis] > scaling.high[axis]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Returns mu of a node scaled by every mu perturbation applied to it, so
+// chunks allocated after a perturbation regain its resources
+double GetTreatedMu(const Coords &coords, double mu) {
+  for (const Perturbation &scaling : treatment.mu_scalings) {
+    if (IsInBox(coords, scaling)) {
+      mu *= scaling.fraction;
+    }
+  }
+
+  return mu;
+}
+
+// Kills a binomially distributed fraction of the individuals of each genotype
+// on every occupied node, then removes the genotypes and nodes left empty in
+// one pass each. Coarse regions are refined first, as their counts change
+static void Kill(const Perturbation &kill) {
+  if (coarse_lattice.coarse_nodes != 0) {
+    RefineAllRegions();
+  }
+
+  std::binomial_distribution<int> binomial;
+  bool emptied = false;
+  for (NodeIndex index : occupied_nodes) {
+    Node &node = GetNode(index);
+    for (Genotype genotype : node.existent_genotypes) {
+      const double fraction = (genotype & kill.resistance_mask) != 0
+                                  ? kill.resistant_fraction
+                                  : kill.fraction;
+      const int count = node.genotype_counts[genotype];
+      const int dead = binomial(
+          twister_engine,
+          std::binomial_distribution<int>::param_type(count, fraction));
+      if (dead == 0) {
+        continue;
+      }
+
+      node.genotype_counts.Set(genotype, count - dead);
+      node.population -= dead;
+      RemoveFromAggregates(genotype, dead == count, dead);
+      if (trace_recording) {
+        TraceDeaths(index, genotype, static_cast<uint32_t>(dead));
+      }
+      if (TRACK_LINEAGE && dead == count) {
+        RecordExtinction(index, genotype);
+      }
+    }
+
+    node.existent_genotypes.erase(
+        std::remove_if(node.existent_genotypes.begin(),
+                       node.existent_genotypes.end(),
+                       [&node](const Genotype genotype) {
+                         return node.genotype_counts[genotype] == 0;
+                       }),
+        node.existent_genotypes.end());
+    if (engine == Engine::kNextReaction) {
+      RefreshNode(index);
+    }
+    emptied = emptied || node.population == 0;
+  }
+
+  if (emptied) {
+    occupied_nodes.erase(
+        std::remove_if(occupied_nodes.begin(), occupied_nodes.end(),
+                       [](const NodeIndex index) {
+                         return FindNode(index)->population == 0;
+                       }),
+        occupied_nodes.end());
+  }
+}
+
+// Scales mu of the nodes of an allocated chunk within the box of a
+// perturbation. Nodes are read through their chunk, and written through
+// GetNode only if their mu changes, so a chunk shared with a fork is only
+// copied if the scaling changes one of its nodes
+static void ScaleChunkMu(const uint32_t chunk, const Perturbation &scaling) {
+  for (uint32_t offset = 0; offset < kChunkNodes; offset++) {
+    const Node &view = chunks[chunk]->nodes[offset];
+    bool in_lattice = true;
+    for (LatticeCoord coord : view.coords) {
+      in_lattice = in_lattice && coord < X;
+    }
+    if (!in_lattice || !IsInBox(view.coords, scaling) ||
+        view.mu * scaling.fraction == view.mu) {
+      continue;
+    }
+    const NodeIndex index = Lattice::Index(view.coords);
+    RefineNodeRegion(index);
+    Node &node = GetNode(index);
+    node.mu *= scaling.fraction;
+    if (engine == Engine::kNextReaction && node.population > 0) {
+      RescheduleNode(index);
+    }
+  }
+}
+
+// Scales mu of the allocated nodes within the box of a perturbation, and
+// records it for nodes of chunks allocated later. Only the chunks overlapping
+// the box are visited, so a regional dose costs the chunks of its box. Coarse
+// regions within the box are refined, as their resources change
+static void ScaleMu(const Perturbation &scaling) {
+  treatment.mu_scalings.push_back(scaling);
+
+  // Chunk coordinates of the corners of the box, clipped to the lattice
+  std::array<uint32_t, D> first, last;
+  for (int axis = 0; axis < D; axis++) {
+    const uint32_t high = std::min<uint32_t>(scaling.high[axis], X - 1);
+    if (scaling.low[axis] > high) {
+      return;
+    }
+    first[axis] = scaling.low[axis] / kChunkLength;
+    last[axis] = high / kChunkLength;
+  }
+
+  // Visits the chunks between the corners, stepping the last axis fastest
+  std::array<uint32_t, D> chunk_coords = first;
+  while (true) {
+    uint32_t chunk = 0;
+    for (int axis = 0; axis < D; axis++) {
+      chunk = (chunk * kChunksPerAxis) + chunk_coords[axis];
+    }
+    if (chunks[chunk]) {
+      ScaleChunkMu(chunk, scaling);
+    }
+
+    int axis = D - 1;
+    while (axis >= 0 && chunk_coords[axis] == last[axis]) {
+      chunk_coords[axis] = first[axis];
+      axis--;
+    }
+    if (axis < 0) {
+      break;
+    }
+    chunk_coords[axis]++;
+  }
+}
+
+// Applies a perturbation to the lattice immediately
+void ApplyPerturbation(const Perturbation &perturbation) {
+  switch (perturbation.kind) {
+    case PerturbationKind::kKill:
+      Kill(perturbation);
+      break;
+    case PerturbationKind::kScaleMu:
+      ScaleMu(perturbation);
+      break;
+    case PerturbationKind::kBlockMigration:
+      treatment.migration_blocked_until =
+          std::max(treatment.migration_blocked_until,
+                   sim_state.generation + perturbation.generations);
+      break;
+  }
+}
+
+// Applies the perturbations scheduled for the start of the current
+// generation. The next-reaction engine reschedules every occupied node when
+// migration is blocked or resumes, as their rates change. Called at
+// generation boundaries
+void ApplyDueTreatments() {
+  const bool was_blocked =
+      sim_state.generation - 1 < treatment.migration_blocked_until;
+  while (treatment.next < treatment.schedule.size() &&
+         treatment.schedule[treatment.next].generation <=
+             sim_state.generation) {
+    ApplyPerturbation(treatment.schedule[treatment.next++]);
+  }
+
+  if (engine == Engine::kNextReaction && was_blocked != IsMigrationBlocked()) {
+    for (NodeIndex index : occupied_nodes) {
+      RescheduleNode(index);
+    }
+  }
+}
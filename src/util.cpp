@@ -1,45 +1,82 @@
 #include "stn3d/util.h"
 
+#include <sys/stat.h>
+
 #include <algorithm>
 #include <bitset>
 #include <iostream>
 #include <random>
 #include <sstream>
 
+#include "stn3d/aggregates.h"
+#include "stn3d/archive.h"
+#include "stn3d/chunks.h"
+#include "stn3d/coarse.h"
 #include "stn3d/dynamics.h"
+#include "stn3d/snapshot.h"
+#include "stn3d/trace.h"
+
+// For use of _mkdir on Windows
+#if defined(_WIN32) || defined(_WIN64)
+#include <direct.h>
+#endif
 
 // Use of global data structures instead of a lattice state object is a design
 // choice made to reduce pushes and pops to/from the stack, improving function
 // call and indexing speed
-std::array<std::array<std::array<std::unique_ptr<Node>, X>, X>, X> nodes;
-std::map<LatticeCoord,
-         std::map<LatticeCoord,
-                  std::map<LatticeCoord, std::unique_ptr<std::ofstream>>>>
-    outfiles;
-std::vector<LatticePoint> occupied_nodes;
-std::array<double, GENOTYPES_TOT> arr_a1;
-std::array<double, GENOTYPES_TOT> arr_a2;
-std::array<int, GENOTYPES_TOT> arr_b;
-std::bitset<L> genotype_bitsets[GENOTYPES_TOT];
+std::vector<std::unique_ptr<std::ofstream>> outfiles;
+std::vector<NodeIndex> occupied_nodes;
+std::ofstream population_log;
+double *arr_a1 = nullptr;  // Interaction arrays, backed by landscape.cpp
+double *arr_a2 = nullptr;
+int32_t *arr_b = nullptr;
+std::vector<std::bitset<L>> genotype_bitsets;
 std::random_device random_device;
 std::mt19937 twister_engine(random_device());
 
-// Validates that user provided parameters conform to simulation limitations
-void ValidateParameters() {
-  std::stringstream oss;
-
+// Writes a line to oss for each user provided parameter that doesn't conform
+// to simulation limitations, returning the number of errors
+uint16_t GetParameterErrors(std::ostream &oss) {
   uint16_t validation_errors = 0;
-  if (L <= 1 || L >= 17) {
+  if (L <= 1 || L >= 65) {
+    validation_errors += 1;
+    oss << "L must be in [2, 64].\n";
+  }
+  if (L >= 17 && INTERACTIONS == Interactions::kTables) {
+    validation_errors += 1;
+    oss << "L must be in [2, 16] when INTERACTIONS=kTables.\n";
+  }
+  if (L >= 17 && !SPARSE_COUNTS) {
+    validation_errors += 1;
+    oss << "L must be in [2, 16] when SPARSE_COUNTS=false.\n";
+  }
+  if (LANDSCAPE_FILE[0] != '\0' && INTERACTIONS == Interactions::kHashed) {
     validation_errors += 1;
-    oss << "L must be in [2, 16].\n";
+    oss << "LANDSCAPE_FILE must be empty when INTERACTIONS=kHashed.\n";
   }
-  if (GENOTYPES_TOT != pow(2, L)) {
+  if (GENOTYPES_TOT != kGenotypeMask + 1) {
     validation_errors += 1;
-    oss << "GENOTYPES_TOT must be equal 2^L.\n";
+    oss << "GENOTYPES_TOT must be equal 2^L, or 0 when L=64.\n";
   }
-  if (X <= 1 || X >= 10) {
+  if (D != 2 && D != 3) {
     validation_errors += 1;
-    oss << "X must be in [2, 9].\n";
+    oss << "D must be 2 or 3.\n";
+  }
+  if (WRITE_NODE_LOGS && (X <= 1 || X >= 10)) {
+    validation_errors += 1;
+    oss << "X must be in [2, 9] when WRITE_NODE_LOGS=true.\n";
+  }
+  if (!SPARSE_LATTICE && (X <= 1 || X >= 256)) {
+    validation_errors += 1;
+    oss << "X must be in [2, 255] when SPARSE_LATTICE=false.\n";
+  }
+  if (SPARSE_LATTICE && (X <= 1 || X >= 1025)) {
+    validation_errors += 1;
+    oss << "X must be in [2, 1024] when SPARSE_LATTICE=true.\n";
+  }
+  if (WRITE_ARCHIVE && (X <= 1 || X >= 256)) {
+    validation_errors += 1;
+    oss << "X must be in [2, 255] when WRITE_ARCHIVE=true.\n";
   }
   if (N_0 == 0) {
     validation_errors += 1;
@@ -62,17 +99,31 @@ void ValidateParameters() {
     oss << "PMOVE must be non-negative.\n";
   }
   if (FIX_START && (FIXED_X_VAL <= 1 || FIXED_X_VAL > X || FIXED_Y_VAL <= 1 ||
-                    FIXED_Y_VAL > X || FIXED_Z_VAL <= 1 || FIXED_Z_VAL > X)) {
+                    FIXED_Y_VAL > X ||
+                    (D == 3 && (FIXED_Z_VAL <= 1 || FIXED_Z_VAL > X)))) {
     validation_errors += 1;
     oss << "If using a fixed starting point, the starting coordinates "
            "FIXED_X_VAL, FIXED_Y_VAL and FIXED_Z_VAL must not exceed the "
            "lattice dimensions.\n";
   }
+  if (ADAPTIVE_RESOLUTION && ENGINE != Engine::kSteps) {
+    validation_errors += 1;
+    oss << "ENGINE must be kSteps when ADAPTIVE_RESOLUTION=true.\n";
+  }
   if (FIX_MU && FIXED_MU_VAL < 0) {
     validation_errors += 1;
     oss << "FIXED_MU_VAL must be non-negative.\n";
   }
 
+  return validation_errors;
+}
+
+// Validates that user provided parameters conform to simulation limitations,
+// exiting with a report of any errors
+void ValidateParameters() {
+  std::stringstream oss;
+  const uint16_t validation_errors = GetParameterErrors(oss);
+
   if (validation_errors) {
     std::cout << "There are " << validation_errors
               << " parameter value errors associated with this build:\n"
@@ -85,6 +136,13 @@ void ValidateParameters() {
   }
 }
 
+// Reseeds the random engine so that subsequent runs are reproducible
+void SeedRandomEngine(const uint64_t seed) {
+  std::seed_seq seed_sequence = {static_cast<uint32_t>(seed),
+                                 static_cast<uint32_t>(seed >> 32)};
+  twister_engine.seed(seed_sequence);
+}
+
 // Returns a random floating-point number uniformly distributed over [min, max)
 double UniformRealInRange(const int min, const int max) {
   std::uniform_real_distribution<> dist(min, max);
@@ -97,81 +155,89 @@ int UniformIntInRange(const int min, const int max) {
   return dist(twister_engine);
 }
 
-// Returns a lattice point home to an occupied node, according to the nodes
-// population and relative time spent occupied
-LatticePoint GetOccupiedNode() {
+// Returns a genotype chosen uniformly from all 2^L
+Genotype UniformGenotype() {
+  std::uniform_int_distribution<Genotype> dist(0, kGenotypeMask);
+  return dist(twister_engine);
+}
+
+// Returns the index of an occupied node, chosen according to the nodes
+// population and relative time spent occupied. Nodes of coarse regions
+// (coarse.h) aren't chosen
+NodeIndex GetOccupiedNode() {
   if (occupied_nodes.empty()) {
     std::cout << "Total extinction." << std::endl;
     CloseAllOutputFiles();
     exit(EXIT_SUCCESS);
   } else {
+    RefineIfNoneActive();
+    const size_t active_nodes = GetActiveNodeCount();
     if (RAND_OCC_SELECTION) {
       return occupied_nodes[UniformIntInRange(
-          0, static_cast<int>(occupied_nodes.size()) - 1)];
+          0, static_cast<int>(active_nodes) - 1)];
     }
 
-    // Calculate total population
-    int n_tot = 0;
-    for (int i = 0; i < X; i++) {
-      for (int j = 0; j < X; j++) {
-        for (int k = 0; k < X; k++) {
-          n_tot += (*nodes[i][j][k]).population;
-        }
-      }
-    }
+    const int n_tot = static_cast<int>(GetActivePopulation());
 
     // Node selection favours those with large populations relative to the
     // total, and those occupied the longest
     double running_population_perc = 0.0;
     const double threshold = UniformRealInRange(0, 1);
-    for (LatticePoint lattice_point : occupied_nodes) {
-      const LatticeCoord i_coord = GetCoordinate(lattice_point, 1);
-      const LatticeCoord j_coord = GetCoordinate(lattice_point, 2);
-      const LatticeCoord k_coord = GetCoordinate(lattice_point, 3);
+    for (size_t idx = 0; idx < active_nodes; idx++) {
+      const NodeIndex node = occupied_nodes[idx];
 
       // Calculate node population as percentage of total
       const float node_weight =
-          float((*nodes[i_coord][j_coord][k_coord]).population) / float(n_tot);
+          float(FindNode(node)->population) / float(n_tot);
 
-      // If the probability threshold is crossed, return the point
+      // If the probability threshold is crossed, return the node
       running_population_perc += node_weight;
       if (running_population_perc >= threshold) {
-        return lattice_point;
+        return node;
       }
     }
+
+    // Rounding can leave the summed weights short of the threshold
+    return occupied_nodes[active_nodes - 1];
   }
+}
 
-  return 0;
+// Returns the specified coordinate of a node, counting axes from 1
+LatticeCoord GetCoordinate(const NodeIndex node, const uint32_t idx) {
+  if (idx < 1 || idx > D) {
+    return 0;
+  }
+
+  return Lattice::Coordinates(node)[idx - 1];
 }
 
-// Returns the specified coordinate of a lattice point
-LatticeCoord GetCoordinate(LatticePoint latticePoint, const uint32_t idx) {
-  switch (idx) {
-    case 1:
-      latticePoint &= 0xff;  // First byte
-      break;
-    case 2:
-      latticePoint &= 0xff00;
-      latticePoint = latticePoint >> 8;  // Second byte
-      break;
-    case 3:
-      latticePoint &= 0xff0000;
-      latticePoint = latticePoint >> 16;  // Third byte
-      break;
-    default:
-      break;
-  }
-
-  return latticePoint;
+// Creates an out directory if it doesn't already exist
+void MakeOutputDirectory() {
+  struct stat info;
+#if defined(_WIN32) || defined(_WIN64)
+  if (stat("out", &info)) {
+    _mkdir("./out");
+  }
+#else
+  if (stat("out", &info)) {
+    mkdir("out", 0755);
+  }
+#endif
 }
 
-// Closes the existent species output file for each node
+// Closes the population log and the existent species output file for each
+// node, completes the trajectory archive and event trace if they're being
+// written, and marks any snapshot segment as no longer running
 void CloseAllOutputFiles() {
-  for (int i = 0; i < X; i++) {
-    for (int j = 0; j < X; j++) {
-      for (int k = 0; k < X; k++) {
-        outfiles[i][j][k]->close();
-      }
-    }
+  CloseTrajectoryArchive();
+  CloseSnapshotSegment();
+  CloseEventTrace();
+
+  if (population_log.is_open()) {
+    population_log.close();
+  }
+  for (auto &outfile : outfiles) {
+    outfile->close();
   }
+  outfiles.clear();
 }
\ No newline at end of file
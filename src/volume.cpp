@@ -0,0 +1,355 @@
+#include "stn3d/volume.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "stn3d/encoding.h"
+
+// Returns the bytes of an uncompressed voxel in an encoding
+static uint64_t GetVoxelBytes(const VolumeEncoding encoding) {
+  switch (encoding) {
+    case VolumeEncoding::kFloat32:
+      return sizeof(float);
+    case VolumeEncoding::kUint8:
+      return sizeof(uint8_t);
+    default:
+      return sizeof(uint16_t);
+  }
+}
+
+// Returns the highest quantised level of an encoding
+static double GetVoxelLevels(const VolumeEncoding encoding) {
+  return encoding == VolumeEncoding::kUint8 ? UINT8_MAX : UINT16_MAX;
+}
+
+// Returns offset rounded up to the next section boundary
+static uint64_t AlignVolumeSection(const uint64_t offset) {
+  return (offset + kVolumeAlignment - 1) & ~(kVolumeAlignment - 1);
+}
+
+// Creates a volume of extent voxels and writes a provisional header, which is
+// completed by Close. Quantised encodings store mu = offset + (scale * v);
+// kFloat32 stores mu itself. Returns false if the file can't be created or
+// the extent or scale is invalid
+bool ResourceVolumeWriter::Open(const std::string &path,
+                                const std::array<uint32_t, 3> &extent,
+                                const VolumeEncoding encoding,
+                                const double scale, const double offset) {
+  const bool quantised = encoding != VolumeEncoding::kFloat32;
+  if (extent[0] == 0 || extent[1] == 0 || extent[2] == 0 ||
+      (quantised && !(scale > 0.0))) {
+    return false;
+  }
+  file_.open(path, std::ios::binary | std::ios::trunc);
+  if (!file_.is_open()) {
+    return false;
+  }
+
+  header_ = {};
+  std::memcpy(header_.magic, kVolumeMagic, sizeof(kVolumeMagic));
+  header_.version = kVolumeVersion;
+  header_.encoding = static_cast<uint16_t>(encoding);
+  std::copy(extent.begin(), extent.end(), header_.extent);
+  header_.scale = quantised ? scale : 1.0;
+  header_.offset = quantised ? offset : 0.0;
+  header_.data_offset = AlignVolumeSection(sizeof(VolumeHeader));
+  slab_offsets_.clear();
+  slabs_written_ = 0;
+
+  const char padding[kVolumeAlignment] = {0};
+  file_.write(reinterpret_cast<const char *>(&header_), sizeof(header_));
+  file_.write(padding, static_cast<std::streamsize>(header_.data_offset -
+                                                    sizeof(header_)));
+
+  return file_.good();
+}
+
+// Writes the mu of the next slab, extent[1] rows of extent[2] values,
+// quantising them for all but kFloat32
+void ResourceVolumeWriter::WriteSlab(const float *mu) {
+  const auto encoding = static_cast<VolumeEncoding>(header_.encoding);
+  const uint64_t count =
+      static_cast<uint64_t>(header_.extent[1]) * header_.extent[2];
+  slabs_written_++;
+  if (encoding == VolumeEncoding::kFloat32) {
+    file_.write(reinterpret_cast<const char *>(mu),
+                static_cast<std::streamsize>(count * sizeof(float)));
+    return;
+  }
+
+  const double levels = GetVoxelLevels(encoding);
+  buffer_.clear();
+  uint32_t previous = 0;
+  for (uint64_t idx = 0; idx < count; idx++) {
+    const double level =
+        std::round((mu[idx] - header_.offset) / header_.scale);
+    const auto voxel =
+        static_cast<uint32_t>(std::min(std::max(level, 0.0), levels));
+    if (encoding == VolumeEncoding::kUint8) {
+      buffer_.push_back(static_cast<uint8_t>(voxel));
+    } else if (encoding == VolumeEncoding::kUint16) {
+      const auto value = static_cast<uint16_t>(voxel);
+      const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+      buffer_.insert(buffer_.end(), bytes, bytes + sizeof(value));
+    } else {
+      // Zigzag the difference, so small changes of either sign stay short
+      const auto delta = static_cast<int32_t>(voxel - previous);
+      AppendVarint(buffer_, (static_cast<uint32_t>(delta) << 1) ^
+                                static_cast<uint32_t>(delta >> 31));
+      previous = voxel;
+    }
+  }
+
+  if (encoding == VolumeEncoding::kDelta16) {
+    slab_offsets_.push_back(static_cast<uint64_t>(file_.tellp()));
+  }
+  file_.write(reinterpret_cast<const char *>(buffer_.data()),
+              static_cast<std::streamsize>(buffer_.size()));
+}
+
+// Writes the slab index of a compressed volume and completes the header.
+// Returns false if fewer or more than extent[0] slabs were written, or a
+// write failed
+bool ResourceVolumeWriter::Close() {
+  if (!file_.is_open()) {
+    return false;
+  }
+
+  if (static_cast<VolumeEncoding>(header_.encoding) ==
+      VolumeEncoding::kDelta16) {
+    slab_offsets_.push_back(static_cast<uint64_t>(file_.tellp()));
+    const char padding[kVolumeAlignment] = {0};
+    const uint64_t end = slab_offsets_.back();
+    header_.slab_offsets = AlignVolumeSection(end);
+    file_.write(padding,
+                static_cast<std::streamsize>(header_.slab_offsets - end));
+    file_.write(reinterpret_cast<const char *>(slab_offsets_.data()),
+                static_cast<std::streamsize>(slab_offsets_.size() *
+                                             sizeof(uint64_t)));
+  }
+  header_.file_size = static_cast<uint64_t>(file_.tellp());
+  file_.seekp(0);
+  file_.write(reinterpret_cast<const char *>(&header_), sizeof(header_));
+  const bool written = file_.good() && slabs_written_ == header_.extent[0];
+  file_.close();
+
+  return written;
+}
+
+ResourceVolume::~ResourceVolume() { Close(); }
+
+// Maps a volume read-only and validates its header, returning false if the
+// file is missing, truncated or not a volume, or it's three-dimensional and
+// the lattice isn't
+bool ResourceVolume::Open(const std::string &path) {
+  Close();
+
+  if (!file_.Open(path)) {
+    return false;
+  }
+  data_ = file_.Data();
+  size_ = file_.Size();
+
+  header_ = reinterpret_cast<const VolumeHeader *>(data_);
+  if (size_ < sizeof(VolumeHeader) ||
+      std::memcmp(header_->magic, kVolumeMagic, sizeof(kVolumeMagic)) != 0 ||
+      header_->version != kVolumeVersion ||
+      header_->encoding > static_cast<uint16_t>(VolumeEncoding::kDelta16) ||
+      header_->file_size != size_ || header_->extent[0] == 0 ||
+      header_->extent[1] == 0 || header_->extent[2] == 0 ||
+      (D == 2 && header_->extent[2] != 1) ||
+      header_->data_offset < sizeof(VolumeHeader) ||
+      header_->data_offset > size_) {
+    Close();
+    return false;
+  }
+
+  // Check the slabs lie within the file. Sizes are bounded by the file
+  // before they're multiplied, so hostile extents can't wrap them. The
+  // voxels of a slab fit in 64 bits, as each extent has 32
+  const auto encoding = static_cast<VolumeEncoding>(header_->encoding);
+  const uint64_t slabs = header_->extent[0];
+  const uint64_t slab_voxels =
+      static_cast<uint64_t>(header_->extent[1]) * header_->extent[2];
+  const uint64_t data_bytes = size_ - header_->data_offset;
+  if (encoding == VolumeEncoding::kDelta16) {
+    if (header_->slab_offsets % sizeof(uint64_t) != 0 ||
+        !file_.Spans(header_->slab_offsets, (slabs + 1) * sizeof(uint64_t))) {
+      Close();
+      return false;
+    }
+    slab_offsets_ =
+        reinterpret_cast<const uint64_t *>(data_ + header_->slab_offsets);
+
+    // Every voxel takes at least a byte, which also bounds the memory a slab
+    // decodes into by the file
+    for (uint64_t slab = 0; slab <= slabs; slab++) {
+      if (slab_offsets_[slab] < header_->data_offset ||
+          slab_offsets_[slab] > header_->slab_offsets ||
+          (slab > 0 &&
+           (slab_offsets_[slab] < slab_offsets_[slab - 1] ||
+            slab_offsets_[slab] - slab_offsets_[slab - 1] < slab_voxels))) {
+        Close();
+        return false;
+      }
+    }
+  } else {
+    const uint64_t voxel_bytes = GetVoxelBytes(encoding);
+    if (slab_voxels > data_bytes / voxel_bytes ||
+        slabs > data_bytes / (slab_voxels * voxel_bytes)) {
+      Close();
+      return false;
+    }
+  }
+  cached_ids_.fill(UINT32_MAX);
+
+  return true;
+}
+
+// Unmaps the volume
+void ResourceVolume::Close() {
+  if (data_ == nullptr) {
+    return;
+  }
+
+  file_.Close();
+  data_ = nullptr;
+  size_ = 0;
+  header_ = nullptr;
+  slab_offsets_ = nullptr;
+  released_ = 0;
+  for (std::vector<float> &slab : cached_slabs_) {
+    std::vector<float>().swap(slab);
+  }
+}
+
+// Returns the file offset of the start of a slab, or of the end of the slab
+// data for extent[0]
+uint64_t ResourceVolume::GetSlabOffset(const uint32_t slab) const {
+  const auto encoding = static_cast<VolumeEncoding>(header_->encoding);
+  if (encoding == VolumeEncoding::kDelta16) {
+    return slab_offsets_[slab];
+  }
+
+  return header_->data_offset + (static_cast<uint64_t>(slab) *
+                                 header_->extent[1] * header_->extent[2] *
+                                 GetVoxelBytes(encoding));
+}
+
+// Returns the decoded voxels of a compressed slab, decoding it unless it's
+// one of the last kVolumeCachedSlabs decoded
+const std::vector<float> &ResourceVolume::DecodeSlab(const uint32_t slab) {
+  for (int idx = 0; idx < kVolumeCachedSlabs; idx++) {
+    if (cached_ids_[idx] == slab) {
+      return cached_slabs_[idx];
+    }
+  }
+
+  std::vector<float> &voxels = cached_slabs_[next_cached_];
+  cached_ids_[next_cached_] = slab;
+  next_cached_ = (next_cached_ + 1) % kVolumeCachedSlabs;
+  voxels.resize(static_cast<size_t>(header_->extent[1]) * header_->extent[2]);
+  // A slab of malformed varints repeats its last good voxel, as reads past
+  // its end give 0
+  const uint8_t *cursor = data_ + slab_offsets_[slab];
+  const uint8_t *end = data_ + slab_offsets_[slab + 1];
+  uint32_t voxel = 0;
+  uint64_t zigzag;
+  for (float &value : voxels) {
+    cursor = ReadVarint(cursor, end, zigzag);
+    const auto delta = static_cast<int32_t>((zigzag >> 1) ^ -(zigzag & 1));
+    voxel += static_cast<uint32_t>(delta);
+    value = static_cast<float>(voxel);
+  }
+
+  return voxels;
+}
+
+// Returns the stored value of a voxel, before scaling
+double ResourceVolume::GetVoxel(const uint32_t x, const uint32_t y,
+                                const uint32_t z) {
+  const uint64_t voxel = (static_cast<uint64_t>(y) * header_->extent[2]) + z;
+  const auto encoding = static_cast<VolumeEncoding>(header_->encoding);
+  if (encoding == VolumeEncoding::kDelta16) {
+    return DecodeSlab(x)[voxel];
+  }
+
+  const uint8_t *bytes =
+      data_ + GetSlabOffset(x) + (voxel * GetVoxelBytes(encoding));
+  if (encoding == VolumeEncoding::kFloat32) {
+    float value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+  }
+  if (encoding == VolumeEncoding::kUint8) {
+    return *bytes;
+  }
+  uint16_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+
+  return value;
+}
+
+// Returns the position of a lattice coordinate's centre in voxels along an
+// axis of extent voxels, clamped to the voxel centres
+static double GetVoxelPosition(const LatticeCoord coord,
+                               const uint32_t extent) {
+  const double position = ((coord + 0.5) * extent / X) - 0.5;
+
+  return std::min(std::max(position, 0.0), extent - 1.0);
+}
+
+// Returns the first slab sampled for nodes of the lattice plane x
+uint32_t ResourceVolume::GetFirstSlab(const LatticeCoord x) const {
+  return static_cast<uint32_t>(GetVoxelPosition(x, header_->extent[0]));
+}
+
+// Returns mu at the centre of a node, from the nearest voxel or interpolated
+// between the voxels around it. Voxels with no weight aren't read
+double ResourceVolume::Sample(const Coords &coords,
+                              const Resampling resampling) {
+  // The voxels either side of the centre along each axis, and the weight of
+  // the upper one
+  std::array<uint32_t, 3> lower = {0, 0, 0};
+  std::array<uint32_t, 3> upper = {0, 0, 0};
+  std::array<double, 3> weight = {0.0, 0.0, 0.0};
+  for (int axis = 0; axis < D; axis++) {
+    const double position =
+        GetVoxelPosition(coords[axis], header_->extent[axis]);
+    lower[axis] = static_cast<uint32_t>(position);
+    upper[axis] = std::min(lower[axis] + 1, header_->extent[axis] - 1);
+    weight[axis] = position - lower[axis];
+    if (resampling == Resampling::kNearest) {
+      lower[axis] = weight[axis] < 0.5 ? lower[axis] : upper[axis];
+      weight[axis] = 0.0;
+    }
+  }
+
+  double voxel = 0.0;
+  for (int corner = 0; corner < 8; corner++) {
+    std::array<uint32_t, 3> position;
+    double corner_weight = 1.0;
+    for (int axis = 0; axis < 3; axis++) {
+      const bool is_upper = (corner >> axis) & 1;
+      position[axis] = is_upper ? upper[axis] : lower[axis];
+      corner_weight *= is_upper ? weight[axis] : 1.0 - weight[axis];
+    }
+    if (corner_weight > 0.0) {
+      voxel += corner_weight * GetVoxel(position[0], position[1], position[2]);
+    }
+  }
+
+  return header_->offset + (header_->scale * voxel);
+}
+
+// Releases the pages of every slab before a slab, so a volume sampled in x
+// order holds only the slabs ahead of it in memory. Released pages are read
+// again from the file if they're sampled later
+void ResourceVolume::ReleaseSlabsBefore(const uint32_t slab) {
+  const uint64_t end = GetSlabOffset(slab);
+  if (end > released_) {
+    file_.Release(released_, end);
+    released_ = end;
+  }
+}
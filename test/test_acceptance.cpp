@@ -0,0 +1,61 @@
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "stn3d/acceptance.h"
+#include "stn3d/util.h"
+
+// Tests that the tabulated poff deviates from the exact poff by no more than
+// the documented bound, including beyond the table limits
+TEST(GetTabulatedOffspringProbability, DeviationWithinBound) {
+  // Arrange: build the logistic table
+  InitialiseLogisticTable();
+
+  // Act: find the largest deviation over a grid much finer than the table
+  double max_deviation = 0.0;
+  for (double h = -2 * kLogisticTableLimit; h <= 2 * kLogisticTableLimit;
+       h += 1e-4) {
+    const double deviation = std::fabs(GetTabulatedOffspringProbability(h) -
+                                       GetExactOffspringProbability(h));
+    max_deviation = std::max(max_deviation, deviation);
+  }
+
+  // Assert: the deviation in acceptance probability is within the bound
+  ASSERT_LE(max_deviation, kLogisticTableMaxError);
+}
+
+// Tests that the logit strategy makes the same decision as the exact strategy
+TEST(AcceptReproduction, WhenLogitStrategy_MatchesExactDecision) {
+  // Arrange: draw weight functions and uniform numbers
+  int mismatches = 0;
+  for (int idx = 0; idx < 100000; idx++) {
+    const double weight_function = UniformRealInRange(-20, 20);
+    const double uniform_draw = UniformRealInRange(0, 1);
+
+    // Act: decide acceptance under both strategies
+    SetAcceptanceStrategy(AcceptanceStrategy::kExact);
+    const bool exact = AcceptReproduction(weight_function, uniform_draw);
+    SetAcceptanceStrategy(AcceptanceStrategy::kLogit);
+    const bool logit = AcceptReproduction(weight_function, uniform_draw);
+
+    if (exact != logit) {
+      mismatches++;
+    }
+  }
+  SetAcceptanceStrategy(AcceptanceStrategy::kExact);
+
+  // Assert: the decisions agree
+  ASSERT_EQ(0, mismatches);
+}
+
+// Tests that a zero uniform draw is always accepted by the logit strategy
+TEST(AcceptReproduction, WhenLogitStrategyAndZeroDraw_Accepted) {
+  // Arrange: select the logit strategy
+  SetAcceptanceStrategy(AcceptanceStrategy::kLogit);
+
+  // Act: attempt acceptance with a strongly negative weight function
+  const bool accepted = AcceptReproduction(-1000.0, 0.0);
+  SetAcceptanceStrategy(AcceptanceStrategy::kExact);
+
+  // Assert: the attempt is accepted
+  ASSERT_TRUE(accepted);
+}
@@ -0,0 +1,78 @@
+#include <map>
+
+#include "gtest/gtest.h"
+#include "stn3d/aggregates.h"
+#include "stn3d/chunks.h"
+#include "stn3d/dynamics.h"
+#include "stn3d/initialise.h"
+#include "stn3d/util.h"
+
+// Asserts that the aggregates match totals recalculated from every node
+static void ExpectAggregatesMatchLattice() {
+  int64_t population = 0;
+  std::map<Genotype, uint32_t> genotype_populations;
+  std::map<Genotype, uint32_t> genotype_nodes;
+  for (NodeIndex occupied : occupied_nodes) {
+    const Node &node = GetNode(occupied);
+    population += node.population;
+    for (Genotype genotype : node.existent_genotypes) {
+      genotype_populations[genotype] += node.genotype_counts[genotype];
+      genotype_nodes[genotype]++;
+    }
+  }
+
+  EXPECT_EQ(population, aggregates.population);
+  EXPECT_EQ(genotype_populations.size(), aggregates.existent_genotypes.size());
+  for (Genotype genotype : aggregates.existent_genotypes) {
+    EXPECT_EQ(genotype_populations[genotype],
+              aggregates.genotype_populations[genotype]);
+    EXPECT_EQ(genotype_nodes[genotype], aggregates.genotype_nodes[genotype]);
+    EXPECT_EQ(genotype,
+              aggregates.existent_genotypes[aggregates.existent_positions
+                                                [genotype]]);
+  }
+}
+
+// Initialises a lattice populated on one node, simulated by an engine
+static void InitialiseAggregateLattice(const Engine simulation_engine) {
+  InitialiseGenotypes();
+  InitialiseMatricies();
+  InitialiseLattice();
+  InitialiseResources();
+  const NodeIndex start = Lattice::Index(MakeCoords(1, 1, 1));
+  InitialisePopulationOnNode(start);
+  SetEngine(simulation_engine);
+  BeginSimulation(start);
+}
+
+// Tests that the aggregates track reproduction, annihilation and migration
+// by the step engine
+TEST(Aggregates, WhenStepsTaken_MatchLattice) {
+  // Arrange: a populated lattice
+  InitialiseAggregateLattice(Engine::kSteps);
+
+  // Act: take enough steps to spread beyond the starting node
+  for (int step = 0; step < 20000 && StepSimulation(); step++) {
+  }
+  SetEngine(ENGINE);
+
+  // Assert: the aggregates match the lattice
+  ASSERT_GT(occupied_nodes.size(), 1);
+  ExpectAggregatesMatchLattice();
+}
+
+// Tests that the aggregates track births, deaths and migrations by the
+// next-reaction engine
+TEST(Aggregates, WhenEventsFired_MatchLattice) {
+  // Arrange: a populated lattice scheduled for events
+  InitialiseAggregateLattice(Engine::kNextReaction);
+
+  // Act: fire enough events to spread beyond the starting node
+  for (int event = 0; event < 20000 && StepSimulation(); event++) {
+  }
+  SetEngine(ENGINE);
+
+  // Assert: the aggregates match the lattice
+  ASSERT_GT(occupied_nodes.size(), 1);
+  ExpectAggregatesMatchLattice();
+}
@@ -0,0 +1,144 @@
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+#include "gtest/gtest.h"
+#include "stn3d/archive.h"
+#include "stn3d/chunks.h"
+#include "stn3d/initialise.h"
+#include "stn3d/util.h"
+
+// Tests that varints round trip across the full range of encoded widths
+TEST(ReadVarint, RoundTripsAppendedValues) {
+  // Arrange: encode values spanning one to ten bytes
+  const std::vector<uint64_t> values = {0, 1, 127, 128, 16383, 16384,
+                                        4294967295ULL, UINT64_MAX};
+  std::vector<uint8_t> buffer;
+  for (uint64_t value : values) {
+    AppendVarint(buffer, value);
+  }
+
+  // Act: decode the values back out of the buffer
+  std::vector<uint64_t> decoded;
+  const uint8_t *data = buffer.data();
+  for (size_t idx = 0; idx < values.size(); idx++) {
+    uint64_t value;
+    data = ReadVarint(data, buffer.data() + buffer.size(), value);
+    decoded.push_back(value);
+  }
+
+  // Assert: the decoded values match and the whole buffer was consumed
+  ASSERT_EQ(values, decoded);
+  ASSERT_EQ(buffer.data() + buffer.size(), data);
+}
+
+// Tests that varints running past the end of their buffer, or over ten
+// bytes, are rejected
+TEST(ReadVarint, WhenTruncatedOrOverlong_Fails) {
+  // Arrange: a varint cut short, and eleven continuation bytes
+  std::vector<uint8_t> truncated;
+  AppendVarint(truncated, UINT64_MAX);
+  truncated.pop_back();
+  const std::vector<uint8_t> overlong(11, 0x80);
+
+  // Act: decode each within its buffer
+  uint64_t truncated_value = 1;
+  uint64_t overlong_value = 1;
+  const uint8_t *truncated_end = ReadVarint(
+      truncated.data(), truncated.data() + truncated.size(), truncated_value);
+  const uint8_t *overlong_end = ReadVarint(
+      overlong.data(), overlong.data() + overlong.size(), overlong_value);
+
+  // Assert: both fail, and a failed read propagates through a chain
+  ASSERT_EQ(nullptr, truncated_end);
+  ASSERT_EQ(nullptr, overlong_end);
+  ASSERT_EQ(0, truncated_value);
+  ASSERT_EQ(0, overlong_value);
+  ASSERT_EQ(nullptr, ReadVarint(truncated_end, nullptr, truncated_value));
+}
+
+// Tests that an archived generation can be randomly accessed by node and
+// reproduces the genotype counts of the lattice at the time it was written
+TEST(TrajectoryArchive, WhenGenerationsAppended_NodeRecordsMatchLattice) {
+  // Arrange: archive a populated lattice, then a modified copy of it
+  InitialiseLattice();
+  InitialisePopulationOnNode(Lattice::Index(MakeCoords(1, 2, 3)));
+  std::map<uint64_t, uint64_t> expected_counts;
+  const Node &populated = GetNode(Lattice::Index(MakeCoords(1, 2, 3)));
+  for (Genotype genotype : populated.existent_genotypes) {
+    expected_counts[genotype] = populated.genotype_counts[genotype];
+  }
+
+  const char *path = "test_trajectory.stn";
+  ASSERT_TRUE(OpenTrajectoryArchive(path));
+  AppendArchiveGeneration();
+  GetNode(0).existent_genotypes.push_back(7);
+  GetNode(0).genotype_counts.Set(7, 300);
+  AppendArchiveGeneration();
+  CloseTrajectoryArchive();
+
+  // Act: map the archive and read back individual node records
+  TrajectoryArchive archive;
+  ASSERT_TRUE(archive.Open(path));
+  std::map<uint64_t, uint64_t> archived_counts;
+  archive.GetNodeRecord(0, Lattice::Index(MakeCoords(1, 2, 3)))
+      .ForEach([&](uint64_t genotype, uint64_t count) {
+        archived_counts[genotype] = count;
+      });
+  const uint64_t empty_size =
+      archive.GetNodeRecord(0, Lattice::Index(MakeCoords(0, 0, 0)))
+          .ExistentCount();
+  uint64_t modified_count = 0;
+  archive.GetNodeRecord(1, Lattice::Index(MakeCoords(0, 0, 0)))
+      .ForEach([&](uint64_t, uint64_t count) { modified_count = count; });
+  const bool out_of_range =
+      archive.GetNodeRecord(2, 0).IsValid() ||
+      archive.GetNodeRecord(0, kNodesTot).IsValid();
+  archive.Close();
+  std::remove(path);
+  GetNode(0).existent_genotypes.clear();
+  GetNode(0).genotype_counts.Set(7, 0);
+
+  // Assert: both generations are stored and their records match
+  ASSERT_EQ(expected_counts, archived_counts);
+  ASSERT_EQ(0, empty_size);
+  ASSERT_EQ(300, modified_count);
+  ASSERT_FALSE(out_of_range);
+}
+
+// Tests that opening a file that isn't an archive fails gracefully
+TEST(TrajectoryArchive, WhenFileMissing_OpenFails) {
+  // Arrange: an archive reader
+  TrajectoryArchive archive;
+
+  // Assert: a nonexistent file can't be opened
+  ASSERT_FALSE(archive.Open("nonexistent_trajectory.stn"));
+}
+
+// Tests that an archive whose generation index points outside its chunks is
+// rejected rather than read past
+TEST(TrajectoryArchive, WhenIndexCorrupt_OpenFails) {
+  // Arrange: a one generation archive, rewritten with its chunk offset past
+  // the generation index
+  const char *path = "test_trajectory_corrupt.stn";
+  InitialiseLattice();
+  ASSERT_TRUE(OpenTrajectoryArchive(path));
+  AppendArchiveGeneration();
+  CloseTrajectoryArchive();
+  ArchiveHeader header;
+  std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  const uint64_t corrupt_offset = header.index_offset + 8;
+  file.seekp(static_cast<std::streamoff>(header.index_offset));
+  file.write(reinterpret_cast<const char *>(&corrupt_offset),
+             sizeof(corrupt_offset));
+  file.close();
+
+  // Act: open the corrupt archive
+  TrajectoryArchive archive;
+  const bool opened = archive.Open(path);
+  std::remove(path);
+
+  // Assert: it's rejected
+  ASSERT_FALSE(opened);
+}
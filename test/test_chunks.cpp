@@ -0,0 +1,91 @@
+#include "gtest/gtest.h"
+#include "stn3d/chunks.h"
+#include "stn3d/initialise.h"
+#include "stn3d/util.h"
+
+// Tests that an empty chunk is only released once it has stayed empty for
+// kChunkReleaseGenerations generation boundaries
+TEST(ReleaseEmptyChunks, WhenEmptyForReleaseGenerations_ChunkReleased) {
+  // Arrange: allocate an empty lattice
+  InitialiseLattice();
+  InitialiseResources();
+  const size_t allocated = CountAllocatedChunks();
+
+  // Act: pass generation boundaries one short of, then at, the release limit
+  for (int gen = 1; gen < kChunkReleaseGenerations; gen++) {
+    ReleaseEmptyChunks();
+  }
+  const size_t retained = CountAllocatedChunks();
+  ReleaseEmptyChunks();
+
+  // Assert: chunks survive until the limit, then unallocated nodes are absent
+  ASSERT_EQ(kChunksTot, allocated);
+  ASSERT_EQ(kChunksTot, retained);
+  ASSERT_EQ(0, CountAllocatedChunks());
+  ASSERT_EQ(nullptr, FindNode(Lattice::Index(MakeCoords(1, 2, 3))));
+}
+
+// Tests that a chunk holding a population is never released
+TEST(ReleaseEmptyChunks, WhenPopulated_ChunkRetained) {
+  // Arrange: populate a single node
+  InitialiseLattice();
+  InitialiseResources();
+  const NodeIndex node = Lattice::Index(MakeCoords(1, 2, 3));
+  GetNode(node).population = 1;
+
+  // Act: pass more generation boundaries than the release limit
+  for (int gen = 0; gen <= kChunkReleaseGenerations; gen++) {
+    ReleaseEmptyChunks();
+  }
+
+  // Assert: the chunk of the populated node is still allocated
+  ASSERT_NE(nullptr, FindNode(node));
+  ASSERT_EQ(1, FindNode(node)->population);
+}
+
+// Tests that accessing a node of a released chunk reallocates it empty, with
+// its coordinates and resources restored
+TEST(GetNode, WhenChunkReleased_NodeReallocated) {
+  // Arrange: release every chunk of an empty lattice
+  InitialiseLattice();
+  InitialiseResources();
+  const NodeIndex node = Lattice::Index(MakeCoords(1, 2, 3));
+  const double mu = GetNode(node).mu;
+  for (int gen = 0; gen < kChunkReleaseGenerations; gen++) {
+    ReleaseEmptyChunks();
+  }
+
+  // Act: access the node
+  const Node &reallocated = GetNode(node);
+
+  // Assert: the node is empty, in place and has the same resources
+  const Coords expected_coords = MakeCoords(1, 2, 3);
+  ASSERT_EQ(expected_coords, reallocated.coords);
+  ASSERT_EQ(0, reallocated.population);
+  ASSERT_EQ(0, reallocated.genotype_counts[0]);
+  ASSERT_EQ(mu, reallocated.mu);
+  ASSERT_EQ(1, CountAllocatedChunks());
+}
+
+// Tests that the tabulated location of every node matches the chunk and
+// offset of its coordinates
+TEST(LocateNode, WhenTabulated_MatchesCoordinates) {
+  // Arrange: a lattice, which tabulates the row locations
+  InitialiseLattice();
+
+  // Act: locate every node
+  NodeIndex mismatched = 0;
+  for (NodeIndex node = 0; node < kNodesTot; node++) {
+    const Coords coords = Lattice::Coordinates(node);
+    const ChunkLocation location = LocateNode(node);
+    const Node *found = FindNode(node);
+    if (location.chunk != GetChunkIndex(coords) ||
+        location.offset != GetChunkOffset(coords) ||
+        (found != nullptr && found->coords != coords)) {
+      mismatched++;
+    }
+  }
+
+  // Assert: every location matches
+  ASSERT_EQ(0, mismatched);
+}
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "stn3d/chunks.h"
+#include "stn3d/coarse.h"
+#include "stn3d/dynamics.h"
+#include "stn3d/initialise.h"
+#include "stn3d/util.h"
+
+// Returns the nodes of the region at the lattice origin
+static std::vector<NodeIndex> GetFirstRegionNodes() {
+  std::vector<NodeIndex> nodes;
+  for (NodeIndex node = 0; node < kNodesTot; node++) {
+    if (GetRegionIndex(Lattice::Coordinates(node)) == 0) {
+      nodes.push_back(node);
+    }
+  }
+
+  return nodes;
+}
+
+// Initialises a lattice with every node of the first region populated, and
+// one node beyond it, then updates the regions at the boundaries of enough
+// unchanging generations to coarsen the first. Returns the node beyond it
+static NodeIndex CoarsenFirstRegion() {
+  InitialiseGenotypes();
+  InitialiseMatricies();
+  InitialiseLattice();
+  InitialiseResources();
+  for (NodeIndex node : GetFirstRegionNodes()) {
+    InitialisePopulationOnNode(node);
+  }
+  const NodeIndex outside = Lattice::Index(MakeCoords(X - 1, X - 1, X - 1));
+  InitialisePopulationOnNode(outside);
+
+  // The first boundary has nothing earlier to be stable against
+  for (int generation = 0; generation <= kCoarseStableGenerations;
+       generation++) {
+    sim_state.generation = generation;
+    UpdateCoarseRegions();
+  }
+
+  return outside;
+}
+
+// Tests that a saturated region whose alleles hold becomes coarse, and its
+// nodes are no longer selected
+TEST(UpdateCoarseRegions, WhenRegionStable_Coarsens) {
+  // Arrange: a lattice whose first region coarsened
+  const NodeIndex outside = CoarsenFirstRegion();
+  const std::vector<NodeIndex> region_nodes = GetFirstRegionNodes();
+
+  // Act: select nodes to step
+  bool outside_only = true;
+  for (int draw = 0; draw < 100; draw++) {
+    outside_only = outside_only && GetOccupiedNode() == outside;
+  }
+  std::vector<NodeIndex> tail(occupied_nodes.end() - region_nodes.size(),
+                              occupied_nodes.end());
+  std::sort(tail.begin(), tail.end());
+
+  // Assert: only the first region is coarse, held at the back of the
+  // occupied nodes, and only the node outside it is selected
+  ASSERT_TRUE(coarse_lattice.regions[0].coarse);
+  ASSERT_FALSE(coarse_lattice.regions.back().coarse);
+  ASSERT_EQ(region_nodes.size(), coarse_lattice.coarse_nodes);
+  ASSERT_EQ(region_nodes, tail);
+  ASSERT_EQ(N_0, GetActivePopulation());
+  ASSERT_TRUE(outside_only);
+}
+
+// Tests that a coarse region is refined for a generation when due a refresh,
+// and coarsens again once it held
+TEST(UpdateCoarseRegions, WhenRefreshDue_RefinesForGeneration) {
+  // Arrange: a lattice whose first region coarsened
+  CoarsenFirstRegion();
+  const int coarsened = sim_state.generation;
+
+  // Act: update the regions at the refresh, and the boundary after it
+  sim_state.generation = coarsened + kCoarseRefreshGenerations;
+  UpdateCoarseRegions();
+  const bool refreshed_coarse = coarse_lattice.regions[0].coarse;
+  const size_t refreshed_active = GetActiveNodeCount();
+  sim_state.generation++;
+  UpdateCoarseRegions();
+
+  // Assert: the region was active for one generation only
+  ASSERT_FALSE(refreshed_coarse);
+  ASSERT_EQ(occupied_nodes.size(), refreshed_active);
+  ASSERT_TRUE(coarse_lattice.regions[0].coarse);
+  ASSERT_EQ(sim_state.generation,
+            coarse_lattice.regions[0].coarsened_generation);
+}
+
+// Tests that newly occupied nodes join the active nodes, and a coarse region
+// is refined when one of its nodes is reached
+TEST(RefineNodeRegion, WhenNodeReached_Refines) {
+  // Arrange: a lattice whose first region coarsened
+  const NodeIndex outside = CoarsenFirstRegion();
+  const std::vector<NodeIndex> region_nodes = GetFirstRegionNodes();
+
+  // Act: occupy a node, then reach a node outside and inside the region
+  const NodeIndex occupied = Lattice::Index(MakeCoords(X - 1, X - 2, X - 1));
+  AddOccupiedNode(occupied);
+  const size_t active_nodes = GetActiveNodeCount();
+  const bool added_active =
+      std::find(occupied_nodes.begin(),
+                occupied_nodes.begin() + active_nodes,
+                occupied) != occupied_nodes.begin() + active_nodes;
+  RefineNodeRegion(outside);
+  const bool coarse_outside_reached = coarse_lattice.regions[0].coarse;
+  RefineNodeRegion(region_nodes.back());
+
+  // Assert: the region stayed coarse until one of its nodes was reached
+  ASSERT_EQ(2, active_nodes);
+  ASSERT_TRUE(added_active);
+  ASSERT_TRUE(coarse_outside_reached);
+  ASSERT_FALSE(coarse_lattice.regions[0].coarse);
+  ASSERT_EQ(0, coarse_lattice.coarse_nodes);
+  ASSERT_EQ(aggregates.population, GetActivePopulation());
+}
+
+// Tests that every coarse region is refined once the last active node dies
+// out, so a node can still be selected
+TEST(RefineIfNoneActive, WhenActiveNodesDieOut_RefinesAll) {
+  // Arrange: a lattice whose first region coarsened, leaving one active node
+  const NodeIndex outside = CoarsenFirstRegion();
+  Node &node = GetNode(outside);
+
+  // Act: annihilate every individual on the active node, then select a node
+  while (node.population > 0) {
+    Annihilate(node.genotype_counts, node.existent_genotypes, node.population,
+               0, outside);
+  }
+  const NodeIndex selected = GetOccupiedNode();
+
+  // Assert: the region was refined, and one of its nodes selected
+  ASSERT_FALSE(coarse_lattice.regions[0].coarse);
+  ASSERT_EQ(0, coarse_lattice.coarse_nodes);
+  ASSERT_EQ(aggregates.population, GetActivePopulation());
+  ASSERT_EQ(0, GetRegionIndex(Lattice::Coordinates(selected)));
+}
+
+// Tests that only populated regions are tracked between boundaries, and a
+// region is dropped once its nodes empty
+TEST(UpdateCoarseRegions, WhenRegionEmpties_StopsTrackingIt) {
+  // Arrange: a lattice whose first region coarsened, and the region of the
+  // node beyond it
+  const NodeIndex outside = CoarsenFirstRegion();
+  const uint32_t outside_region =
+      GetRegionIndex(Lattice::Coordinates(outside));
+  const std::vector<uint32_t> tracked = coarse_lattice.populated_regions;
+
+  // Act: empty the node beyond the first region, refining it, then update
+  // the regions
+  Node &node = GetNode(outside);
+  while (node.population > 0) {
+    Annihilate(node.genotype_counts, node.existent_genotypes, node.population,
+               0, outside);
+  }
+  sim_state.generation++;
+  UpdateCoarseRegions();
+
+  // Assert: both regions were tracked, then only the populated first region
+  ASSERT_EQ(std::vector<uint32_t>({0, outside_region}), tracked);
+  ASSERT_EQ(std::vector<uint32_t>({0}), coarse_lattice.populated_regions);
+  ASSERT_EQ(0, coarse_lattice.regions[outside_region].population);
+}
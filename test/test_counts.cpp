@@ -0,0 +1,118 @@
+#include <map>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "stn3d/counts.h"
+
+// Tests that new counts start at zero without storage, and allocate single
+// byte counters on the first increment
+TEST(GenotypeCounts, WhenConstructed_ZeroWithoutStorage) {
+  // Arrange: construct a counts store
+  GenotypeCounts counts;
+
+  // Assert: all counts are zero and stored one byte per genotype
+  int error = 0;
+  for (uint32_t idx = 0; idx < GENOTYPES_TOT; idx++) {
+    if (counts[idx] != 0) {
+      error = 1;
+    }
+  }
+
+  ASSERT_FALSE(error);
+  ASSERT_EQ(0, counts.Bytes());
+
+  // Act: add the first count
+  counts.Increment(9);
+
+  // Assert: storage is allocated at the narrowest width
+  ASSERT_EQ(1, counts.Width());
+  ASSERT_EQ(1, counts[9]);
+}
+
+// Tests that incrementing past the uint8 limit promotes the counter width
+// without losing any counts
+TEST(GenotypeCounts, WhenCountOverflowsByte_PromotedToTwoBytes) {
+  // Arrange: fill one genotype to the single byte limit
+  GenotypeCounts counts;
+  counts.Set(5, 17);
+  for (int idx = 0; idx < 255; idx++) {
+    counts.Increment(42);
+  }
+
+  // Act: increment beyond the single byte limit
+  counts.Increment(42);
+
+  // Assert: the width is promoted and existing counts are preserved
+  ASSERT_EQ(2, counts.Width());
+  ASSERT_EQ(256, counts[42]);
+  ASSERT_EQ(17, counts[5]);
+}
+
+// Tests that setting a count beyond the uint16 limit promotes straight to
+// four byte counters
+TEST(GenotypeCounts, WhenSetBeyondTwoBytes_PromotedToFourBytes) {
+  // Arrange: construct a counts store
+  GenotypeCounts counts;
+
+  // Act: set a count that needs a four byte counter, then decrement it
+  counts.Set(3, 70000);
+  counts.Decrement(3);
+
+  // Assert: the width is promoted and the count is exact
+  ASSERT_EQ(4, counts.Width());
+  ASSERT_EQ(69999, counts[3]);
+}
+
+// Tests that a genotype table agrees with an ordered map through insertions,
+// erasures and growth, including genotypes using all 64 bits
+TEST(GenotypeTable, WhenEditedRandomly_MatchesMap) {
+  // Arrange: an empty table, and a reference map
+  GenotypeTable table;
+  std::map<Genotype, uint32_t> reference;
+  std::mt19937 random(5);
+  std::uniform_int_distribution<int> genotype_dist(0, 2000);
+
+  // Act: increment and erase random genotypes, spread over 2^64
+  for (int edit = 0; edit < 20000; edit++) {
+    const Genotype genotype = static_cast<Genotype>(genotype_dist(random))
+                              << 53;
+    if (edit % 3 == 0) {
+      table.Erase(genotype);
+      reference.erase(genotype);
+    } else {
+      table[genotype]++;
+      reference[genotype]++;
+    }
+  }
+
+  // Assert: the table holds exactly the counts of the map
+  ASSERT_EQ(reference.size(), table.Size());
+  const GenotypeTable &lookup = table;
+  for (Genotype genotype = 0; genotype <= 2000; genotype++) {
+    const auto entry = reference.find(genotype << 53);
+    ASSERT_EQ(entry == reference.end() ? 0 : entry->second,
+              lookup[genotype << 53]);
+  }
+}
+
+// Tests that erasing an entry keeps later entries of its probe sequence
+// reachable
+TEST(GenotypeTable, WhenCollidingEntryErased_OthersFound) {
+  // Arrange: a table holding consecutive genotypes, then cleared of half
+  GenotypeTable table;
+  for (int genotype = 0; genotype < 64; genotype++) {
+    table[genotype] = genotype + 1;
+  }
+
+  // Act: erase the even genotypes
+  for (int genotype = 0; genotype < 64; genotype += 2) {
+    table.Erase(genotype);
+  }
+
+  // Assert: only the odd genotypes remain, with their counts
+  const GenotypeTable &lookup = table;
+  ASSERT_EQ(32, table.Size());
+  for (int genotype = 0; genotype < 64; genotype++) {
+    ASSERT_EQ(genotype % 2 ? genotype + 1 : 0, lookup[genotype]);
+  }
+}
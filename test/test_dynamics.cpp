@@ -1,10 +1,11 @@
 #include "gtest/gtest.h"
+#include "stn3d/aggregates.h"
+#include "stn3d/chunks.h"
 #include "stn3d/dynamics.h"
 #include "stn3d/initialise.h"
 #include "stn3d/util.h"
 
-void InitialiseTestLattice(int genotype, LatticePoint i, LatticePoint j,
-                           LatticePoint k);
+void InitialiseTestLattice(int genotype, NodeIndex node);
 
 // Tests that the interaction strength between identical genotypes is zero
 TEST(GetInteractionStrength, WhenSameGenotype_ZeroInteraction) {
@@ -59,32 +60,32 @@ TEST(GetInteractionStrength, WhenDifferentGenotype_NonzeroInteraction) {
 TEST(Reproduce, ReturnsIndividual) {
   // Arrange: initialise a test lattice at (1, 1, 1)
   int genotype = 1234;
-  LatticePoint i = 1;
-  LatticePoint j = 1;
-  LatticePoint k = 1;
-  InitialiseTestLattice(genotype, i, j, k);
+  NodeIndex node = Lattice::Index(MakeCoords(1, 1, 1));
+  InitialiseTestLattice(genotype, node);
 
   // Act: make a call to Reproduce
-  int individual = Reproduce(
-      (*nodes[i][j][k]).genotype_counts, (*nodes[i][j][k]).existent_genotypes,
-      (*nodes[i][j][k]).population, (*nodes[i][j][k]).mu);
+  Node &test_node = GetNode(node);
+  int individual =
+      Reproduce(test_node.genotype_counts, test_node.existent_genotypes,
+                test_node.population, test_node.mu, node);
 
   // Assert: a valid individual is returned
   ASSERT_TRUE(individual >= 0);
-  ASSERT_TRUE(individual < GENOTYPES_TOT);
+  ASSERT_TRUE(static_cast<uint32_t>(individual) < GENOTYPES_TOT);
 }
 
 // Initialises a lattice with certainty of existence of a specific genotype at
 // a specific node
-void InitialiseTestLattice(const int genotype, const LatticePoint i,
-                           const LatticePoint j, const LatticePoint k) {
+void InitialiseTestLattice(const int genotype, const NodeIndex node) {
   InitialiseGenotypes();
   InitialiseMatricies();
   InitialiseLattice();
   InitialiseResources();
-  InitialisePopulationOnNode(i, j, k);
+  InitialisePopulationOnNode(node);
 
-  (*nodes[i][j][k]).existent_genotypes.push_back(genotype);
-  (*nodes[i][j][k]).genotype_counts[genotype]++;
-  (*nodes[i][j][k]).population++;
+  Node &test_node = GetNode(node);
+  test_node.existent_genotypes.push_back(genotype);
+  test_node.genotype_counts.Increment(genotype);
+  test_node.population++;
+  AddToAggregates(genotype, true);
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "stn3d/chunks.h"
+#include "stn3d/dynamics.h"
+#include "stn3d/events.h"
+#include "stn3d/initialise.h"
+#include "stn3d/util.h"
+
+// Initialises a lattice populated on one node and schedules its events
+static void InitialiseEventLattice() {
+  InitialiseGenotypes();
+  InitialiseMatricies();
+  InitialiseLattice();
+  InitialiseResources();
+  const NodeIndex start = Lattice::Index(MakeCoords(1, 1, 1));
+  InitialisePopulationOnNode(start);
+  SetEngine(Engine::kNextReaction);
+  BeginSimulation(start);
+}
+
+// Tests that events are fired in time order, and that each fired event is
+// the earliest scheduled
+TEST(StepEvent, EventTimesNonDecreasing) {
+  // Arrange: schedule the events of a populated lattice
+  InitialiseEventLattice();
+
+  // Act: fire events, checking each against the previous clock and time
+  bool ordered = true;
+  double previous_clock = sim_state.clock;
+  double previous_time = sim_state.time;
+  for (int event = 0; event < 2000 && PeekNextEvent() != nullptr; event++) {
+    const double next = PeekNextEvent()->time;
+    StepEvent();
+    ordered = ordered && next >= previous_clock &&
+              sim_state.clock >= previous_clock &&
+              sim_state.time >= previous_time;
+    previous_clock = sim_state.clock;
+    previous_time = sim_state.time;
+  }
+  SetEngine(ENGINE);
+
+  // Assert: time stamps never decrease
+  ASSERT_TRUE(ordered);
+}
+
+// Tests that incrementally maintained t1 sums and propensities match a full
+// recalculation after many events
+TEST(StepEvent, IncrementalRatesMatchRecalculation) {
+  // Arrange: schedule the events of a populated lattice
+  InitialiseEventLattice();
+
+  // Act: fire events, then recalculate the rates of every occupied node
+  for (int event = 0; event < 5000; event++) {
+    StepEvent();
+  }
+  double max_sum_error = 0.0;
+  double max_propensity_error = 0.0;
+  int population = 0;
+  for (NodeIndex index : occupied_nodes) {
+    const Node &node = GetNode(index);
+    population += node.population;
+    for (size_t idx = 0; idx < node.existent_genotypes.size(); idx++) {
+      double t1 = 0.0;
+      for (Genotype other : node.existent_genotypes) {
+        t1 += GetInteractionStrength(node.existent_genotypes[idx], other) *
+              node.genotype_counts[other];
+      }
+      max_sum_error =
+          std::max(max_sum_error, std::abs(t1 - node.interaction_sums[idx]));
+    }
+    const double propensity =
+        GetReproductionPropensity(node) +
+        ((kDeathRate + kMigrationRate) * node.population);
+    max_propensity_error = std::max(
+        max_propensity_error, std::abs(propensity - node.propensity));
+  }
+  const size_t scheduled = CountScheduledNodes();
+  SetEngine(ENGINE);
+
+  // Assert: the rates agree and every occupied node is scheduled
+  ASSERT_LT(max_sum_error, 1e-9);
+  ASSERT_LT(max_propensity_error, 1e-9);
+  ASSERT_EQ(occupied_nodes.size(), scheduled);
+  ASSERT_GT(population, 0);
+}
+
+// Tests that the nodes refreshed at a generation boundary are rescheduled, so
+// their propensities match their t1 sums
+TEST(StepEvent, WhenGenerationEnds_PropensitiesMatchSums) {
+  // Arrange: schedule the events of a populated lattice
+  InitialiseEventLattice();
+
+  // Act: fire events up to the first generation boundary, then recalculate
+  // each propensity from the t1 sums left in place
+  while (sim_state.generation == 0 && PeekNextEvent() != nullptr) {
+    StepEvent();
+  }
+  double max_propensity_error = 0.0;
+  for (NodeIndex index : occupied_nodes) {
+    const Node &node = *FindNode(index);
+    const double propensity =
+        GetReproductionPropensity(node) +
+        ((kDeathRate + kMigrationRate) * node.population);
+    max_propensity_error = std::max(
+        max_propensity_error, std::abs(propensity - node.propensity));
+  }
+  const int generation = sim_state.generation;
+  SetEngine(ENGINE);
+
+  // Assert: the boundary was reached and the propensities agree
+  ASSERT_EQ(1, generation);
+  ASSERT_LT(max_propensity_error, 1e-12);
+}
@@ -0,0 +1,201 @@
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "stn3d/chunks.h"
+#include "stn3d/fork.h"
+#include "stn3d/run.h"
+#include "stn3d/treatment.h"
+
+// Returns the generation and population of the run, then the population of
+// each occupied node in order
+static std::vector<int> RecordRun() {
+  std::vector<int> record = {GetRunState().generation,
+                             GetRunState().population};
+  for (NodeIndex node : GetOccupiedNodes()) {
+    record.push_back(GetNodeView(node)->population);
+  }
+
+  return record;
+}
+
+// Returns the state of every node held by a fork: its population,
+// propensity, then the count of each existent genotype
+static std::vector<double> RecordForkNodes(const SimulationFork &fork) {
+  std::vector<double> record;
+  for (const std::shared_ptr<Chunk> &chunk : fork.chunks) {
+    if (!chunk) {
+      continue;
+    }
+    for (const Node &node : chunk->nodes) {
+      record.push_back(node.population);
+      record.push_back(node.propensity);
+      for (Genotype genotype : node.existent_genotypes) {
+        record.push_back(node.genotype_counts[genotype]);
+      }
+    }
+  }
+
+  return record;
+}
+
+// Returns the record of a run restored from a fork, then advanced by a number
+// of generations
+static std::vector<int> AdvanceBranch(const SimulationFork &fork,
+                                      const uint32_t generations) {
+  RestoreRun(fork);
+  AdvanceGenerations(generations);
+
+  return RecordRun();
+}
+
+// Tests that every branch restored from a fork of the step engine continues
+// identically
+TEST(RestoreRun, WhenStepsTaken_BranchesReproducible) {
+  // Arrange: a run forked after a warm-up
+  ASSERT_TRUE(CreateRun({11, false, nullptr}));
+  AdvanceGenerations(2);
+  SimulationFork fork;
+  ASSERT_TRUE(ForkRun(fork));
+
+  // Act: advance the run, then two branches restored from the fork
+  AdvanceGenerations(3);
+  const std::vector<int> original = RecordRun();
+  const std::vector<int> first = AdvanceBranch(fork, 3);
+  const std::vector<int> second = AdvanceBranch(fork, 3);
+  DestroyRun();
+
+  // Assert: all three reached the same state
+  ASSERT_EQ(5, original.front());
+  ASSERT_EQ(original, first);
+  ASSERT_EQ(original, second);
+}
+
+// Tests that every branch restored from a fork of the next-reaction engine
+// continues identically, including the scheduled events
+TEST(RestoreRun, WhenEventsFired_BranchesReproducible) {
+  // Arrange: a run of the next-reaction engine forked after a warm-up
+  SetEngine(Engine::kNextReaction);
+  ASSERT_TRUE(CreateRun({12, false, nullptr}));
+  AdvanceGenerations(2);
+  SimulationFork fork;
+  ASSERT_TRUE(ForkRun(fork));
+
+  // Act: advance the run, then a branch restored from the fork
+  AdvanceGenerations(3);
+  const std::vector<int> original = RecordRun();
+  const std::vector<int> branch = AdvanceBranch(fork, 3);
+  DestroyRun();
+  SetEngine(ENGINE);
+
+  // Assert: both reached the same state
+  ASSERT_EQ(5, original.front());
+  ASSERT_EQ(original, branch);
+}
+
+// Tests that branches of the next-reaction engine restored from a fork of a
+// lattice of several chunks leave the nodes of the fork unchanged, however
+// many events they fire in the chunks they share with it
+TEST(RestoreRun, WhenEventBranchesRestoredTwice_ForkNodesUnchanged) {
+  // Arrange: a run of the next-reaction engine forked after a warm-up
+  SetEngine(Engine::kNextReaction);
+  ASSERT_TRUE(CreateRun({14, false, nullptr}));
+  AdvanceGenerations(2);
+  SimulationFork fork;
+  ASSERT_TRUE(ForkRun(fork));
+  const std::vector<double> captured = RecordForkNodes(fork);
+
+  // Act: advance two branches restored from the fork, recording the nodes
+  // of the fork after each
+  const std::vector<int> first = AdvanceBranch(fork, 3);
+  const std::vector<double> after_first = RecordForkNodes(fork);
+  const std::vector<int> second = AdvanceBranch(fork, 3);
+  const std::vector<double> after_second = RecordForkNodes(fork);
+  DestroyRun();
+  SetEngine(ENGINE);
+
+  // Assert: the lattice has several chunks, the branches match and the
+  // fork's nodes never changed
+  ASSERT_GT(kChunksTot, 1u);
+  ASSERT_EQ(first, second);
+  ASSERT_EQ(captured, after_first);
+  ASSERT_EQ(captured, after_second);
+}
+
+// Tests that a branch copies only the chunks it writes to, leaving the nodes
+// of the fork unchanged
+TEST(ForkRun, WhenBranchEdits_ForkUnchanged) {
+  // Arrange: a run forked after a warm-up, and an occupied node
+  ASSERT_TRUE(CreateRun({13, false, nullptr}));
+  AdvanceGenerations(1);
+  SimulationFork fork;
+  ASSERT_TRUE(ForkRun(fork));
+  const NodeIndex edited = GetOccupiedNodes().front();
+  const uint32_t chunk = GetChunkIndex(Lattice::Coordinates(edited));
+  const double mu = GetNodeView(edited)->mu;
+
+  // Act: edit the resources of the node in the branch
+  const bool set = SetNodeMu(edited, mu + 1.0);
+  size_t allocated = 0;
+  size_t shared = 0;
+  for (uint32_t idx = 0; idx < kChunksTot; idx++) {
+    allocated += fork.chunks[idx] != nullptr;
+    shared += fork.chunks[idx] && chunks[idx] == fork.chunks[idx];
+  }
+  const double fork_mu =
+      fork.chunks[chunk]->nodes[GetChunkOffset(Lattice::Coordinates(edited))]
+          .mu;
+  const double branch_mu = GetNodeView(edited)->mu;
+  DestroyRun();
+
+  // Assert: only the chunk of the node was copied, so the fork kept its mu
+  ASSERT_GT(allocated, 1u);
+  ASSERT_TRUE(set);
+  ASSERT_EQ(allocated - 1, shared);
+  ASSERT_DOUBLE_EQ(mu, fork_mu);
+  ASSERT_DOUBLE_EQ(mu + 1.0, branch_mu);
+}
+
+// Tests that a dose of a box in a branch copies only the chunks whose
+// resources it changes
+TEST(ForkRun, WhenBranchDosesBox_OnlyBoxCopied) {
+  // Arrange: a run forked after a warm-up, and a box of one occupied node
+  ASSERT_TRUE(CreateRun({13, false, nullptr}));
+  AdvanceGenerations(1);
+  SimulationFork fork;
+  ASSERT_TRUE(ForkRun(fork));
+  const NodeIndex dosed = GetOccupiedNodes().front();
+  const double mu = GetNodeView(dosed)->mu;
+  Perturbation scaling{};
+  scaling.kind = PerturbationKind::kScaleMu;
+  scaling.fraction = 0.5;
+  scaling.low = Lattice::Coordinates(dosed);
+  scaling.high = scaling.low;
+  Perturbation unchanged = scaling;
+  unchanged.fraction = 1.0;
+  unchanged.low.fill(0);
+  unchanged.high.fill(X - 1);
+
+  // Act: dose the whole lattice without changing it, then the box
+  ApplyPerturbation(unchanged);
+  size_t unchanged_shared = 0;
+  for (uint32_t idx = 0; idx < kChunksTot; idx++) {
+    unchanged_shared += fork.chunks[idx] && chunks[idx] == fork.chunks[idx];
+  }
+  ApplyPerturbation(scaling);
+  size_t allocated = 0;
+  size_t shared = 0;
+  for (uint32_t idx = 0; idx < kChunksTot; idx++) {
+    allocated += fork.chunks[idx] != nullptr;
+    shared += fork.chunks[idx] && chunks[idx] == fork.chunks[idx];
+  }
+  const double branch_mu = GetNodeView(dosed)->mu;
+  DestroyRun();
+
+  // Assert: the unchanging dose copied nothing, and the dose of the box
+  // copied only the chunk of its node
+  ASSERT_GT(allocated, 1u);
+  ASSERT_EQ(allocated, unchanged_shared);
+  ASSERT_EQ(allocated - 1, shared);
+  ASSERT_DOUBLE_EQ(mu * 0.5, branch_mu);
+}
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "stn3d/chunks.h"
+#include "stn3d/dynamics.h"
+#include "stn3d/genotype.h"
+#include "stn3d/landscape.h"
+#include "stn3d/run.h"
+#include "stn3d/util.h"
+
+// These tests are built into stn3d_tests_wide, with STN3D_WIDE_GENOME
+// selecting a 64 gene genome on the hashed landscape with sparse counts
+static_assert(L == 64 && INTERACTIONS == Interactions::kHashed &&
+                  SPARSE_COUNTS,
+              "test_genotype.cpp requires STN3D_WIDE_GENOME");
+
+// Tests that the parameters of a 64 gene genome are accepted
+TEST(GetParameterErrors, WhenGenomeWide_NoErrors) {
+  // Arrange: a stream for the report
+  std::stringstream oss;
+
+  // Act: validate the parameters of the build
+  const uint16_t errors = GetParameterErrors(oss);
+
+  // Assert: no parameter is reported
+  ASSERT_EQ(0, errors) << oss.str();
+}
+
+// Tests that mutation reaches every gene of the genome, including the top
+// gene of a 64 bit id
+TEST(MutateGenotype, WhenGenomeWide_EveryGeneMutated) {
+  // Arrange: a parent without any gene set
+  SeedRandomEngine(11);
+  Genotype mutated = 0;
+
+  // Act: mutate the parent many times, recording every gene set
+  for (int offspring = 0; offspring < 2000; offspring++) {
+    mutated |= MutateGenotype(0);
+  }
+
+  // Assert: each of the 64 genes was mutated at least once
+  ASSERT_EQ(kGenotypeMask, mutated);
+}
+
+// Tests that the hashed landscape tells apart genotypes differing only in
+// their top genes
+TEST(GetHashedA1, WhenTopGenesDiffer_ValuesDiffer) {
+  // Arrange: a seeded landscape, and genotypes differing in genes 62 and 63
+  UseHashedLandscape(3);
+  const Genotype low = 0x1234;
+  const Genotype high = low | (Genotype{3} << 62);
+
+  // Act: hash both genotypes
+  const double low_a1 = GetHashedA1(low);
+  const double high_a1 = GetHashedA1(high);
+  const double low_a2 = GetHashedA2(low);
+  const double high_a2 = GetHashedA2(high);
+
+  // Assert: their values are independent
+  ASSERT_NE(low_a1, high_a1);
+  ASSERT_NE(low_a2, high_a2);
+}
+
+// Tests that a run with a 64 gene genome founds genotypes across the whole
+// genome, and holds counts in memory proportional to the existent genotypes
+TEST(CreateRun, WhenGenomeWide_CountsStaySparse) {
+  // Arrange: a run advanced for a few generations
+  ASSERT_TRUE(CreateRun({17, false, nullptr}));
+
+  // Act: advance the run, then measure its genotypes and count storage
+  const bool survived = AdvanceGenerations(10);
+  Genotype highest = 0;
+  size_t existent = 0;
+  size_t bytes = 0;
+  for (NodeIndex index : GetOccupiedNodes()) {
+    const Node &node = *GetNodeView(index);
+    for (Genotype genotype : node.existent_genotypes) {
+      highest = std::max(highest, genotype);
+    }
+    existent += node.existent_genotypes.size();
+    bytes += node.genotype_counts.Bytes();
+  }
+  const size_t occupied = GetOccupiedNodes().size();
+  const size_t global_existent = GetRunAggregates().existent_genotypes.size();
+  DestroyRun();
+
+  // Assert: some genotype carries the top gene, and the counts of each node
+  // take at most a few kilobytes, where dense counts would take 2^64
+  ASSERT_TRUE(survived);
+  ASSERT_GT(existent, 0u);
+  ASSERT_GT(global_existent, 0u);
+  ASSERT_GE(highest, Genotype{1} << 63);
+  ASSERT_LE(bytes, occupied * 4096);
+}
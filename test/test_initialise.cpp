@@ -1,4 +1,5 @@
 #include "gtest/gtest.h"
+#include "stn3d/chunks.h"
 #include "stn3d/initialise.h"
 #include "stn3d/util.h"
 
@@ -9,7 +10,7 @@ TEST(InitialiseGenotypes, BitsetsAreInitialised) {
 
   // Assert: the bitsets are initialised as expected
   int error = 0;
-  for (int idx = 0; idx < GENOTYPES_TOT; idx++) {
+  for (uint32_t idx = 0; idx < GENOTYPES_TOT; idx++) {
     if (genotype_bitsets[idx] != std::bitset<L>(static_cast<uint64_t>(idx))) {
       error = 1;
     }
@@ -25,7 +26,7 @@ TEST(InitialiseMatricies, MatriciesAreInitialised) {
 
   // Assert:
   int error = 0;
-  for (int idx = 0; idx < GENOTYPES_TOT; idx++) {
+  for (uint32_t idx = 0; idx < GENOTYPES_TOT; idx++) {
     if ((arr_a1[idx] < -1 || arr_a1[idx] >= 1) ||
         (arr_a2[idx] < -1 || arr_a2[idx] >= 1) ||
         (arr_b[idx] != 0 && arr_b[idx] != 1)) {
@@ -41,15 +42,16 @@ TEST(InitialiseMatricies, MatriciesAreInitialised) {
 TEST(InitialiseNeighbours, ForInternalLatticePoint_NeighboursPopulated) {
   // Arrange: initialise the neighbours vector of lattice point (1, 1, 1)
   InitialiseLattice();
-  (*nodes[1][1][1]).neighbours.clear();
-  InitialiseNeighbours((*nodes[1][1][1]).neighbours, 1, 1, 1);
+  std::vector<NodeIndex> neighbours;
+  InitialiseNeighbours(neighbours, Lattice::Index(MakeCoords(1, 1, 1)));
 
   // Assert: the neighbours vector contains the expected lattice points
-  auto* expected_neighbours = new std::vector<LatticePoint>{
-      0,     65536,  131072, 256,   65792,  131328, 512,   66048,  131584,
-      1,     65537,  131073, 257,   131329, 513,    66049, 131585, 2,
-      65538, 131074, 258,    65794, 131330, 514,    66050, 131586};
-  ASSERT_EQ(*expected_neighbours, (*nodes[1][1][1]).neighbours);
+  auto* expected_neighbours =
+      D == 2 ? new std::vector<NodeIndex>{0, 1, 2, 6, 8, 12, 13, 14}
+             : new std::vector<NodeIndex>{
+                   0,  1,  2,  6,  7,  8,  12, 13, 14, 36, 37, 38, 42,
+                   44, 48, 49, 50, 72, 73, 74, 78, 79, 80, 84, 85, 86};
+  ASSERT_EQ(*expected_neighbours, neighbours);
 
   delete expected_neighbours;
 }
@@ -59,15 +61,16 @@ TEST(InitialiseNeighbours, ForInternalLatticePoint_NeighboursPopulated) {
 TEST(InitialiseNeighbours, ForBoundaryLatticePoint_NeighboursPopulated) {
   // Arrange: initialise the neighbours vector of lattice point (0, 0, 0)
   InitialiseLattice();
-  (*nodes[0][0][0]).neighbours.clear();
-  InitialiseNeighbours((*nodes[0][0][0]).neighbours, 0, 0, 0);
+  std::vector<NodeIndex> neighbours;
+  InitialiseNeighbours(neighbours, Lattice::Index(MakeCoords(0, 0, 0)));
 
   // Assert: the neighbours vector contains the expected lattice points
-  auto* expected_neighbours = new std::vector<LatticePoint>{
-      328965, 1285,  66821,  327685, 5,     65541,  327941, 261,   65797,
-      328960, 1280,  66816,  327680, 65536, 327936, 256,    65792, 328961,
-      1281,   66817, 327681, 1,      65537, 327937, 257,    65793};
-  ASSERT_EQ(*expected_neighbours, (*nodes[0][0][0]).neighbours);
+  auto* expected_neighbours =
+      D == 2 ? new std::vector<NodeIndex>{35, 30, 31, 5, 1, 11, 6, 7}
+             : new std::vector<NodeIndex>{
+                   215, 210, 211, 185, 180, 181, 191, 186, 187, 35, 30, 31, 5,
+                   1,   11,  6,   7,   71,  66,  67,  41,  36,  37, 47, 42, 43};
+  ASSERT_EQ(*expected_neighbours, neighbours);
 
   delete expected_neighbours;
 }
@@ -78,11 +81,12 @@ TEST(InitialisePopulationOnNode, OccupiedNodesInitialised) {
   // Arrange: initialise the starting population on the node at (1, 1, 1)
   InitialiseLattice();
   occupied_nodes.clear();
-  InitialisePopulationOnNode(1, 1, 1);
+  InitialisePopulationOnNode(Lattice::Index(MakeCoords(1, 1, 1)));
 
   // Assert: the occupied_nodes vector contains lattice point (1, 1, 1)
-  std::vector<LatticePoint>::iterator it;
-  it = find(occupied_nodes.begin(), occupied_nodes.end(), 65793);
+  std::vector<NodeIndex>::iterator it;
+  it = find(occupied_nodes.begin(), occupied_nodes.end(),
+           Lattice::Index(MakeCoords(1, 1, 1)));
 
   ASSERT_FALSE(it == occupied_nodes.end());
 }
@@ -92,9 +96,9 @@ TEST(InitialisePopulationOnNode, OccupiedNodesInitialised) {
 TEST(InitialisePopulationOnNode, NodePopulationInitialised) {
   // Arrange: initialise the starting population on the node at (1, 1, 1)
   InitialiseLattice();
-  (*nodes[1][1][1]).population = 0;
-  InitialisePopulationOnNode(1, 1, 1);
+  GetNode(Lattice::Index(MakeCoords(1, 1, 1))).population = 0;
+  InitialisePopulationOnNode(Lattice::Index(MakeCoords(1, 1, 1)));
 
   // Assert: the node population is strictly positive
-  ASSERT_TRUE((*nodes[1][1][1]).population > 0);
+  ASSERT_TRUE(GetNode(Lattice::Index(MakeCoords(1, 1, 1))).population > 0);
 }
\ No newline at end of file
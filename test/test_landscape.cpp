@@ -0,0 +1,137 @@
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "stn3d/initialise.h"
+#include "stn3d/landscape.h"
+#include "stn3d/statistics.h"
+#include "stn3d/util.h"
+
+// Tests that a written landscape file maps back to the arrays it was written
+// from
+TEST(MapLandscapeFile, WhenWritten_MapsIdenticalArrays) {
+  // Arrange: write a generated landscape, then generate a different one
+  InitialiseMatricies();
+  const std::vector<double> a1(arr_a1, arr_a1 + GENOTYPES_TOT);
+  const std::vector<double> a2(arr_a2, arr_a2 + GENOTYPES_TOT);
+  const std::vector<int32_t> b(arr_b, arr_b + GENOTYPES_TOT);
+  const char *path = "test_landscape.stnl";
+  ASSERT_TRUE(WriteLandscapeFile(path, 0));
+  InitialiseMatricies();
+
+  // Act: map the landscape file
+  const bool mapped = MapLandscapeFile(path);
+  const std::vector<double> mapped_a1(arr_a1, arr_a1 + GENOTYPES_TOT);
+  const std::vector<double> mapped_a2(arr_a2, arr_a2 + GENOTYPES_TOT);
+  const std::vector<int32_t> mapped_b(arr_b, arr_b + GENOTYPES_TOT);
+  UseGeneratedLandscape();
+  std::remove(path);
+
+  // Assert: the mapped arrays match the written arrays
+  ASSERT_TRUE(mapped);
+  ASSERT_EQ(a1, mapped_a1);
+  ASSERT_EQ(a2, mapped_a2);
+  ASSERT_EQ(b, mapped_b);
+}
+
+// Tests that a landscape for a different genome length is rejected, leaving
+// the current landscape in place
+TEST(MapLandscapeFile, WhenGenomeLengthDiffers_MapFails) {
+  // Arrange: write a landscape file, then alter its genome length
+  InitialiseMatricies();
+  const double *generated_a1 = arr_a1;
+  const char *path = "test_landscape.stnl";
+  ASSERT_TRUE(WriteLandscapeFile(path, 0));
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    const uint16_t genome_length = L + 1;
+    file.seekp(offsetof(LandscapeHeader, genome_length));
+    file.write(reinterpret_cast<const char *>(&genome_length),
+               sizeof(genome_length));
+  }
+
+  // Act: attempt to map the altered and a nonexistent landscape file
+  const bool mapped = MapLandscapeFile(path);
+  const bool mapped_missing = MapLandscapeFile("nonexistent_landscape.stnl");
+  std::remove(path);
+
+  // Assert: neither file is mapped and the generated landscape remains
+  ASSERT_FALSE(mapped);
+  ASSERT_FALSE(mapped_missing);
+  ASSERT_EQ(generated_a1, arr_a1);
+}
+
+// Tests that a landscape with a section running past the end of the file, or
+// written for a different THETA, is rejected
+TEST(MapLandscapeFile, WhenSectionOrThetaCorrupt_MapFails) {
+  // Arrange: write a landscape file, then copies with the B section moved
+  // past the end of the file and with a different THETA
+  InitialiseMatricies();
+  const double *generated_a1 = arr_a1;
+  const char *path = "test_landscape.stnl";
+  const char *theta_path = "test_landscape_theta.stnl";
+  ASSERT_TRUE(WriteLandscapeFile(path, 0));
+  ASSERT_TRUE(WriteLandscapeFile(theta_path, 0));
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    LandscapeHeader header;
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    const uint64_t b_offset = header.file_size;
+    file.seekp(offsetof(LandscapeHeader, b_offset));
+    file.write(reinterpret_cast<const char *>(&b_offset), sizeof(b_offset));
+    std::fstream theta_file(theta_path,
+                            std::ios::binary | std::ios::in | std::ios::out);
+    const double theta = THETA / 2;
+    theta_file.seekp(offsetof(LandscapeHeader, theta));
+    theta_file.write(reinterpret_cast<const char *>(&theta), sizeof(theta));
+  }
+
+  // Act: attempt to map the altered landscape files
+  const bool mapped = MapLandscapeFile(path);
+  const bool mapped_theta = MapLandscapeFile(theta_path);
+  std::remove(path);
+  std::remove(theta_path);
+
+  // Assert: neither file is mapped and the generated landscape remains
+  ASSERT_FALSE(mapped);
+  ASSERT_FALSE(mapped_theta);
+  ASSERT_EQ(generated_a1, arr_a1);
+}
+
+// Tests that the hashed landscape is reproducible from its seed, and follows
+// the distributions of generated tables
+TEST(UseHashedLandscape, WhenSeeded_MatchesTableDistributions) {
+  // Arrange: hashed values of many genotypes, and the same number of values
+  // generated as tables are
+  constexpr uint32_t kSamples = 4000;
+  UseHashedLandscape(3);
+  std::vector<double> hashed_a1, hashed_a2, generated;
+  uint32_t hashed_b = 0;
+  for (uint32_t genotype = 0; genotype < kSamples; genotype++) {
+    hashed_a1.push_back(GetHashedA1(genotype * 524287u));
+    hashed_a2.push_back(GetHashedA2(genotype * 524287u));
+    hashed_b += GetHashedB(genotype * 524287u);
+    generated.push_back(UniformRealInRange(-1, 1));
+  }
+
+  // Act: compare the hashed values with the generated ones, and with the
+  // values of another seed
+  const TestResult a1_result = KolmogorovSmirnovTest(hashed_a1, generated);
+  const TestResult a2_result = KolmogorovSmirnovTest(hashed_a2, generated);
+  const double first_a1 = GetHashedA1(1);
+  UseHashedLandscape(4);
+  const double reseeded_a1 = GetHashedA1(1);
+  UseHashedLandscape(3);
+  const double repeated_a1 = GetHashedA1(1);
+  UseGeneratedLandscape();
+
+  // Assert: A1 and A2 are uniform, B is set with probability THETA, and the
+  // values depend only on the seed
+  ASSERT_GT(a1_result.p_value, 0.001);
+  ASSERT_GT(a2_result.p_value, 0.001);
+  ASSERT_NEAR(THETA, static_cast<double>(hashed_b) / kSamples, 0.03);
+  ASSERT_NE(first_a1, reseeded_a1);
+  ASSERT_EQ(first_a1, repeated_a1);
+}
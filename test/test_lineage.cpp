@@ -0,0 +1,138 @@
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "stn3d/encoding.h"
+#include "stn3d/lattice.h"
+#include "stn3d/lineage.h"
+
+// Writes a phylogeny file of one record with the given fields
+static void WritePhylogenyRecord(const char *path,
+                                 const std::vector<uint64_t> &fields) {
+  std::vector<uint8_t> buffer(kPhylogenyMagic,
+                              kPhylogenyMagic + sizeof(kPhylogenyMagic));
+  AppendVarint(buffer, kPhylogenyVersion);
+  AppendVarint(buffer, 1);
+  for (uint64_t field : fields) {
+    AppendVarint(buffer, field);
+  }
+  std::ofstream(path, std::ios::binary)
+      .write(reinterpret_cast<const char *>(buffer.data()),
+             static_cast<std::streamsize>(buffer.size()));
+}
+
+// Tests that compaction discards extinct branches, but keeps the ancestors of
+// living clones and renumbers their parent links
+TEST(CompactLineage, WhenBranchExtinct_AncestorsOfLivingClonesKept) {
+  // Arrange: a founder with two mutant branches, one of which dies out along
+  // with the founder clone itself
+  ResetLineage();
+  RecordFounder(0, 0);
+  RecordMutation(0, 0, 1);
+  RecordMutation(0, 0, 2);
+  RecordMutation(0, 2, 3);
+  RecordExtinction(0, 0);
+  RecordExtinction(0, 1);
+
+  // Act: compact the arena
+  CompactLineage();
+
+  // Assert: the living branch and its extinct ancestors remain, linked
+  const std::vector<LineageRecord> &records = GetLineageRecords();
+  ASSERT_EQ(3, records.size());
+  ASSERT_EQ(kLineageRoot, records[0].parent);
+  ASSERT_EQ(2u, records[1].genotype);
+  ASSERT_EQ(0u, records[1].parent);
+  ASSERT_EQ(3u, records[2].genotype);
+  ASSERT_EQ(1u, records[2].parent);
+  ASSERT_EQ(2u, GetCloneLineage(0, 3));
+}
+
+// Tests that a lineage shared by migration survives the extinction of its
+// origin clone, and mutations on the new node descend from it
+TEST(CompactLineage, WhenMigrantCloneLiving_SharedLineageKept) {
+  // Arrange: a founder migrates to node 5, then dies out on node 0
+  ResetLineage();
+  RecordFounder(0, 4);
+  RecordClone(5, 4, GetCloneLineage(0, 4));
+  RecordExtinction(0, 4);
+  RecordMutation(5, 4, 6);
+  RecordExtinction(5, 4);
+
+  // Act: compact the arena
+  CompactLineage();
+
+  // Assert: the mutant on node 5 descends from the founder on node 0
+  const std::vector<LineageRecord> &records = GetLineageRecords();
+  ASSERT_EQ(2, records.size());
+  ASSERT_EQ(0u, records[0].node);
+  ASSERT_EQ(0u, records[0].clones);
+  ASSERT_EQ(5u, records[1].node);
+  ASSERT_EQ(0u, records[1].parent);
+  ASSERT_EQ(4u, records[1].parent_genotype);
+  ASSERT_TRUE(records[0].founder);
+  ASSERT_FALSE(records[1].founder);
+}
+
+// Tests that a phylogeny file reproduces the compacted arena
+TEST(WritePhylogenyFile, WhenRead_RecordsMatchArena) {
+  // Arrange: a small phylogeny across two nodes
+  ResetLineage();
+  RecordFounder(3, 0);
+  RecordMutation(3, 0, 9);
+  RecordClone(8, 9, GetCloneLineage(3, 9));
+  RecordMutation(8, 9, 17);
+
+  // Act: write then read back the phylogeny
+  const char *path = "test_phylogeny.stp";
+  ASSERT_TRUE(WritePhylogenyFile(path));
+  std::vector<LineageRecord> read;
+  const bool read_ok = ReadPhylogenyFile(path, read);
+  std::remove(path);
+
+  // Assert: every field of every record round trips
+  const std::vector<LineageRecord> &records = GetLineageRecords();
+  ASSERT_TRUE(read_ok);
+  ASSERT_EQ(records.size(), read.size());
+  for (size_t idx = 0; idx < records.size(); idx++) {
+    ASSERT_EQ(records[idx].parent, read[idx].parent);
+    ASSERT_EQ(records[idx].parent_genotype, read[idx].parent_genotype);
+    ASSERT_EQ(records[idx].genotype, read[idx].genotype);
+    ASSERT_EQ(records[idx].node, read[idx].node);
+    ASSERT_EQ(records[idx].generation, read[idx].generation);
+    ASSERT_EQ(records[idx].clones, read[idx].clones);
+    ASSERT_EQ(records[idx].founder, read[idx].founder);
+  }
+}
+
+// Tests that phylogeny files with out of range or truncated fields are
+// rejected
+TEST(ReadPhylogenyFile, WhenFieldOutOfRange_Fails) {
+  // Arrange: a valid record, then records with a parent after them, a node
+  // beyond the lattice, a genotype beyond the genome, a founder flag other
+  // than 0 or 1 and a missing field
+  const char *path = "test_phylogeny_corrupt.stp";
+  const std::vector<uint64_t> valid = {0, 1, 0, 1, 2, 3, 1};
+  std::vector<std::vector<uint64_t>> corrupt(5, valid);
+  corrupt[0][0] = 1;
+  corrupt[1][4] = kNodesTot;
+  corrupt[2][3] = GENOTYPES_TOT;
+  corrupt[3][1] = 2;
+  corrupt[4].pop_back();
+
+  // Act: read each file
+  std::vector<LineageRecord> records;
+  WritePhylogenyRecord(path, valid);
+  const bool read_valid = ReadPhylogenyFile(path, records);
+  std::vector<bool> read_corrupt;
+  for (const std::vector<uint64_t> &fields : corrupt) {
+    WritePhylogenyRecord(path, fields);
+    read_corrupt.push_back(ReadPhylogenyFile(path, records));
+  }
+  std::remove(path);
+
+  // Assert: only the valid record was read
+  ASSERT_TRUE(read_valid);
+  ASSERT_EQ(std::vector<bool>(corrupt.size(), false), read_corrupt);
+}
@@ -0,0 +1,133 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "stn3d/chunks.h"
+#include "stn3d/initialise.h"
+#include "stn3d/run.h"
+#include "stn3d/stn3d_c.h"
+
+// Tests that only one run can exist at a time
+TEST(CreateRun, WhenRunExists_CreateFails) {
+  // Arrange: create a run
+  ASSERT_TRUE(CreateRun({1, false, nullptr}));
+
+  // Act: attempt to create a second run, then destroy the first
+  const bool created = CreateRun({2, false, nullptr});
+  DestroyRun();
+
+  // Assert: the second run was refused and no run remains
+  ASSERT_FALSE(created);
+  ASSERT_FALSE(RunExists());
+}
+
+// Tests that a run failing part way through its creation frees what it had
+// initialised
+TEST(CreateRun, WhenLandscapeMissing_FreesRun) {
+  // Arrange: a lattice and landscape left by an earlier simulation
+  InitialiseGenotypes();
+  InitialiseMatricies();
+  InitialiseLattice();
+  InitialisePopulationOnNode(0);
+
+  // Act: create a run from a landscape file that doesn't exist
+  const bool created = CreateRun({1, false, "nonexistent_landscape.stl"});
+
+  // Assert: no run, lattice or landscape remains
+  ASSERT_FALSE(created);
+  ASSERT_FALSE(RunExists());
+  ASSERT_TRUE(chunks.empty());
+  ASSERT_TRUE(occupied_nodes.empty());
+  ASSERT_EQ(nullptr, arr_a1);
+}
+
+// Tests that runs created with the same seed advance identically
+TEST(AdvanceGenerations, WhenSeeded_RunsReproducible) {
+  // Arrange: a helper recording the population of each occupied node after
+  // advancing a seeded run by three generations
+  auto advance_run = [](uint64_t seed) {
+    std::vector<int> populations;
+    CreateRun({seed, false, nullptr});
+    AdvanceGenerations(3);
+    populations.push_back(GetRunState().generation);
+    for (NodeIndex node : GetOccupiedNodes()) {
+      populations.push_back(GetNodeView(node)->population);
+    }
+    DestroyRun();
+
+    return populations;
+  };
+
+  // Act: advance two runs with the same seed
+  const std::vector<int> first = advance_run(42);
+  const std::vector<int> second = advance_run(42);
+
+  // Assert: both completed three generations in the same state
+  ASSERT_EQ(3, first.front());
+  ASSERT_EQ(first, second);
+}
+
+// Tests that C ABI node views point directly into the lattice and agree with
+// the nodes genotype counts
+TEST(StnGetNode, ViewsLiveLattice) {
+  // Arrange: create and advance a run through the C ABI
+  const stn3d_options options = {7, 0, nullptr};
+  ASSERT_EQ(0, stn3d_create(&options));
+  stn3d_advance_generations(1);
+  const uint32_t *occupied;
+  ASSERT_GT(stn3d_get_occupied_nodes(&occupied), 0u);
+
+  // Act: view the first occupied node and sum its existent genotype counts
+  stn3d_node_view view;
+  const int result = stn3d_get_node(occupied[0], &view);
+  int counted = 0;
+  for (size_t idx = 0; idx < view.existent_count; idx++) {
+    const uint64_t genotype = view.existent_genotypes[idx];
+    switch (view.count_width) {
+      case 1:
+        counted += static_cast<const uint8_t *>(view.genotype_counts)[genotype];
+        break;
+      case 2:
+        counted +=
+            static_cast<const uint16_t *>(view.genotype_counts)[genotype];
+        break;
+      default:
+        counted +=
+            static_cast<const uint32_t *>(view.genotype_counts)[genotype];
+    }
+  }
+  const Node *node = GetNodeView(occupied[0]);
+  const int out_of_range = stn3d_get_node(UINT32_MAX, &view);
+  stn3d_destroy();
+
+  // Assert: the view aliases the node and its counts sum to its population
+  ASSERT_EQ(0, result);
+  ASSERT_EQ(&node->population, view.population);
+  ASSERT_EQ(node->population, counted);
+  ASSERT_EQ(-1, out_of_range);
+}
+
+// Tests that the C ABI state carries the continuous time stamps of the
+// next-reaction engine
+TEST(StnGetState, WhenEventDriven_ReportsTime) {
+  // Arrange: create an event driven run through the C ABI
+  SetEngine(Engine::kNextReaction);
+  const stn3d_options options = {7, 0, nullptr};
+  ASSERT_EQ(0, stn3d_create(&options));
+
+  // Act: fire events within the first generation, then read the state
+  stn3d_advance_steps(50);
+  stn3d_state state;
+  stn3d_get_state(&state);
+  const double time = GetRunState().time;
+  const double clock = GetRunState().clock;
+  stn3d_destroy();
+  SetEngine(ENGINE);
+
+  // Assert: the state holds the time and clock of the last event
+  ASSERT_EQ(0, state.generation);
+  ASSERT_DOUBLE_EQ(time, state.time);
+  ASSERT_DOUBLE_EQ(clock, state.clock);
+  ASSERT_GT(state.clock, 0.0);
+  ASSERT_GT(state.time, 0.0);
+  ASSERT_LT(state.time, 1.0);
+}
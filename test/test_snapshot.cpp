@@ -0,0 +1,86 @@
+#include <sys/mman.h>
+
+#include "gtest/gtest.h"
+#include "stn3d/chunks.h"
+#include "stn3d/dynamics.h"
+#include "stn3d/initialise.h"
+#include "stn3d/snapshot.h"
+#include "stn3d/util.h"
+
+// Tests that a published snapshot reads back with each node's top genotypes
+// in order of population
+TEST(PublishSnapshot, WhenRead_NodesMatchLattice) {
+  // Arrange: a node holding three genotypes, published to a segment
+  InitialiseLattice();
+  InitialiseResources();
+  const NodeIndex index = Lattice::Index(MakeCoords(1, 2, 3));
+  Node &node = GetNode(index);
+  const std::vector<std::pair<int, int>> counts = {{5, 2}, {9, 7}, {12, 4}};
+  for (const auto &count : counts) {
+    node.existent_genotypes.push_back(count.first);
+    node.genotype_counts.Set(count.first, count.second);
+  }
+  node.population = 13;
+  occupied_nodes.push_back(index);
+  sim_state.generation = 17;
+  sim_state.population = 13;
+  ASSERT_TRUE(OpenSnapshotSegment("/stn3d_test_snapshot"));
+  PublishSnapshot();
+
+  // Act: read the snapshot, then again once the run has ended
+  SnapshotReader reader;
+  ASSERT_TRUE(reader.Open("/stn3d_test_snapshot"));
+  Snapshot snapshot;
+  const bool read = reader.Read(snapshot);
+  CloseSnapshotSegment();
+  Snapshot finished;
+  const bool read_finished = reader.Read(finished);
+  reader.Close();
+  shm_unlink("/stn3d_test_snapshot");
+
+  // Assert: the node and its genotypes are published, most populous first
+  ASSERT_TRUE(read);
+  ASSERT_TRUE(snapshot.running);
+  ASSERT_EQ(17, snapshot.generation);
+  ASSERT_EQ(1, snapshot.nodes.size());
+  ASSERT_EQ(index, snapshot.nodes[0].node);
+  ASSERT_EQ(13, snapshot.nodes[0].population);
+  ASSERT_EQ(3, snapshot.nodes[0].existent_count);
+  ASSERT_EQ(9u, snapshot.nodes[0].top_genotypes[0]);
+  ASSERT_EQ(12u, snapshot.nodes[0].top_genotypes[1]);
+  ASSERT_EQ(5u, snapshot.nodes[0].top_genotypes[2]);
+  ASSERT_EQ(0, snapshot.nodes[0].top_counts[3]);
+  ASSERT_TRUE(read_finished);
+  ASSERT_FALSE(finished.running);
+}
+
+// Tests that a reader follows the segment as it grows to hold more nodes
+TEST(SnapshotReader, WhenSegmentGrows_ReadsEveryNode) {
+  // Arrange: publish one occupied node, and open a reader on it
+  InitialiseLattice();
+  InitialiseResources();
+  occupied_nodes.push_back(0);
+  GetNode(0).population = 1;
+  ASSERT_TRUE(OpenSnapshotSegment("/stn3d_test_snapshot"));
+  PublishSnapshot();
+  SnapshotReader reader;
+  ASSERT_TRUE(reader.Open("/stn3d_test_snapshot"));
+
+  // Act: occupy every node of the lattice and publish again
+  for (NodeIndex index = 1; index < kNodesTot; index++) {
+    GetNode(index).population = 1;
+    occupied_nodes.push_back(index);
+  }
+  PublishSnapshot();
+  Snapshot snapshot;
+  const bool read = reader.Read(snapshot);
+  reader.Close();
+  CloseSnapshotSegment();
+  shm_unlink("/stn3d_test_snapshot");
+  occupied_nodes.clear();
+
+  // Assert: every node is read, in publication order
+  ASSERT_TRUE(read);
+  ASSERT_EQ(kNodesTot, snapshot.nodes.size());
+  ASSERT_EQ(kNodesTot - 1, snapshot.nodes.back().node);
+}
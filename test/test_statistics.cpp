@@ -0,0 +1,77 @@
+#include "gtest/gtest.h"
+#include "stn3d/statistics.h"
+
+// Tests the Kolmogorov survival function against tabulated values
+TEST(GetKolmogorovSurvival, MatchesTabulatedValues) {
+  // Assert: Q(1.0), the 5% critical value 1.36, and the small lambda limit
+  ASSERT_NEAR(0.270000, GetKolmogorovSurvival(1.0), 1e-6);
+  ASSERT_NEAR(0.0495, GetKolmogorovSurvival(1.36), 1e-4);
+  ASSERT_EQ(1.0, GetKolmogorovSurvival(0.1));
+}
+
+// Tests that the Kolmogorov-Smirnov distance is evaluated after tied values
+TEST(KolmogorovSmirnovTest, WhenValuesTied_DistanceAfterTies) {
+  // Arrange: samples sharing the values 2 and 3
+  const std::vector<double> sample_a = {1, 2, 2, 3};
+  const std::vector<double> sample_b = {2, 3, 3, 4};
+
+  // Act: test the samples
+  const TestResult result = KolmogorovSmirnovTest(sample_a, sample_b);
+
+  // Assert: the largest distance is at 2, where the CDFs are 3/4 and 1/4
+  ASSERT_DOUBLE_EQ(0.5, result.statistic);
+}
+
+// Tests that identical samples never reject and disjoint samples do
+TEST(KolmogorovSmirnovTest, WhenSamplesDisjoint_Rejects) {
+  // Arrange: two interleaved samples of the same values, and a shifted copy
+  std::vector<double> sample_a;
+  std::vector<double> sample_b;
+  std::vector<double> shifted;
+  for (int idx = 0; idx < 50; idx++) {
+    sample_a.push_back(idx);
+    sample_b.push_back(idx);
+    shifted.push_back(idx + 50);
+  }
+
+  // Act: test each pair
+  const TestResult same = KolmogorovSmirnovTest(sample_a, sample_b);
+  const TestResult disjoint = KolmogorovSmirnovTest(sample_a, shifted);
+
+  // Assert: the same samples give D = 0, disjoint ones D = 1 and tiny p
+  ASSERT_EQ(0.0, same.statistic);
+  ASSERT_EQ(1.0, same.p_value);
+  ASSERT_EQ(1.0, disjoint.statistic);
+  ASSERT_LT(disjoint.p_value, 1e-10);
+}
+
+// Tests the k-sample Anderson-Darling statistic against the worked example of
+// Scholz and Stephens (1987), whose samples contain ties
+TEST(AndersonDarlingTest, MatchesScholzStephensExample) {
+  // Arrange: the four samples of the example
+  const std::vector<std::vector<double>> samples = {
+      {38.7, 41.5, 43.8, 44.5, 45.5, 46.0, 47.7, 58.0},
+      {39.2, 39.3, 39.7, 41.4, 41.8, 42.9, 43.3, 45.8},
+      {34.0, 35.0, 39.0, 40.0, 43.0, 43.0, 44.0, 45.0},
+      {34.0, 34.8, 34.8, 35.4, 37.2, 37.8, 41.2, 42.8}};
+
+  // Act: test the samples
+  const TestResult result = AndersonDarlingTest(samples);
+
+  // Assert: the standardised midrank statistic and its p-value of about 0.2%
+  ASSERT_NEAR(4.480, result.statistic, 1e-3);
+  ASSERT_NEAR(0.0022, result.p_value, 1e-4);
+}
+
+// Tests that samples of one value, which have no spread to compare, pass
+TEST(AndersonDarlingTest, WhenAllValuesTied_DoesNotReject) {
+  // Arrange: samples of a single repeated value, e.g. surviving runs'
+  // extinction times
+  const std::vector<std::vector<double>> samples = {{40, 40, 40}, {40, 40}};
+
+  // Act: test the samples
+  const TestResult result = AndersonDarlingTest(samples);
+
+  // Assert: the test can't reject
+  ASSERT_EQ(1.0, result.p_value);
+}
@@ -0,0 +1,94 @@
+#include <algorithm>
+
+#include "gtest/gtest.h"
+#include "stn3d/initialise.h"
+#include "stn3d/stencil.h"
+
+// Tests that the von Neumann neighbourhood of an internal node holds its 2D
+// face-adjacent nodes
+TEST(BuildNeighbourTable, WhenVonNeumann_FaceNeighbours) {
+  // Arrange: build a von Neumann neighbour table over an allocated lattice
+  InitialiseLattice();
+  SetStencil(Neighbourhood::kVonNeumann, Boundary::kPeriodic);
+
+  // Act: collect the neighbours of node (1, 1, 1)
+  std::vector<NodeIndex> neighbours;
+  for (int n = 0; n < stencil_size; n++) {
+    neighbours.push_back(GetNeighbour(Lattice::Index(MakeCoords(1, 1, 1)), n));
+  }
+  const int von_neumann_size = stencil_size;
+  SetStencil(NEIGHBOURHOOD, BOUNDARY);
+
+  // Assert: the neighbours are the face-adjacent nodes, four in two
+  // dimensions and six in three
+  const std::vector<Coords> expected_coords =
+      D == 2 ? std::vector<Coords>{MakeCoords(0, 1, 0), MakeCoords(1, 0, 0),
+                                   MakeCoords(1, 2, 0), MakeCoords(2, 1, 0)}
+             : std::vector<Coords>{MakeCoords(0, 1, 1), MakeCoords(1, 0, 1),
+                                   MakeCoords(1, 1, 0), MakeCoords(1, 1, 2),
+                                   MakeCoords(1, 2, 1), MakeCoords(2, 1, 1)};
+  std::vector<NodeIndex> expected_neighbours;
+  for (const Coords &coords : expected_coords) {
+    expected_neighbours.push_back(Lattice::Index(coords));
+  }
+  ASSERT_EQ(2 * D, von_neumann_size);
+  ASSERT_EQ(expected_neighbours, neighbours);
+}
+
+// Tests that reflective boundaries mirror destinations back into the lattice
+TEST(BuildNeighbourTable, WhenReflective_BoundaryNeighboursMirrored) {
+  // Arrange: build a reflective von Neumann neighbour table
+  InitialiseLattice();
+  SetStencil(Neighbourhood::kVonNeumann, Boundary::kReflective);
+
+  // Act: get the neighbour of node (0, 1, 1) in the -i direction
+  const NodeIndex neighbour =
+      GetNeighbour(Lattice::Index(MakeCoords(0, 1, 1)), 0);
+  SetStencil(NEIGHBOURHOOD, BOUNDARY);
+
+  // Assert: the destination is mirrored to (1, 1, 1)
+  ASSERT_EQ(Lattice::Index(MakeCoords(1, 1, 1)), neighbour);
+}
+
+// Tests that absorbing boundaries mark destinations outside the lattice
+TEST(BuildNeighbourTable, WhenAbsorbing_OutsideDestinationsAbsorbed) {
+  // Arrange: build an absorbing Moore neighbour table
+  InitialiseLattice();
+  SetStencil(Neighbourhood::kMoore, Boundary::kAbsorbing);
+
+  // Act: count the absorbed destinations of the corner node (0, 0, 0)
+  int absorbed = 0;
+  for (int n = 0; n < stencil_size; n++) {
+    if (GetNeighbour(Lattice::Index(MakeCoords(0, 0, 0)), n) == kAbsorbed) {
+      absorbed++;
+    }
+  }
+  const int moore_size = stencil_size;
+  SetStencil(NEIGHBOURHOOD, BOUNDARY);
+
+  // Assert: only the 3 neighbours inside a 2D lattice, or 7 inside a 3D
+  // lattice, remain
+  ASSERT_EQ(D == 2 ? 8 : 26, moore_size);
+  ASSERT_EQ(D == 2 ? 8 - 3 : 26 - 7, absorbed);
+}
+
+// Tests that a two-dimensional lattice geometry round trips node indices and
+// coordinates in row-major order, whatever D this build uses
+TEST(LatticeGeometry, WhenTwoDimensional_RoundTripsRowMajor) {
+  // Arrange: the planar geometry
+  using Planar = LatticeGeometry<2>;
+
+  // Act: index every node and decode it again
+  bool round_trips = true;
+  for (NodeIndex node = 0; node < Planar::kNodes; node++) {
+    round_trips =
+        round_trips && Planar::Index(Planar::Coordinates(node)) == node;
+  }
+
+  // Assert: the nodes round trip, and the second axis varies fastest
+  ASSERT_TRUE(round_trips);
+  ASSERT_EQ(static_cast<uint32_t>(X * X), Planar::kNodes);
+  ASSERT_EQ(1u, Planar::Index({0, 1}));
+  ASSERT_EQ(static_cast<NodeIndex>(X), Planar::Index({1, 0}));
+  ASSERT_EQ((Planar::Coords{1, 2}), Planar::Coordinates((X * 1) + 2));
+}
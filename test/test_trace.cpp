@@ -0,0 +1,178 @@
+#include <cstdio>
+#include <map>
+
+#include "gtest/gtest.h"
+#include "stn3d/aggregates.h"
+#include "stn3d/chunks.h"
+#include "stn3d/dynamics.h"
+#include "stn3d/initialise.h"
+#include "stn3d/trace.h"
+#include "stn3d/treatment.h"
+#include "stn3d/util.h"
+
+// Returns the genotype counts of every occupied node of the lattice
+static std::map<NodeIndex, std::map<Genotype, uint32_t>> GetLatticeCounts() {
+  std::map<NodeIndex, std::map<Genotype, uint32_t>> lattice;
+  for (NodeIndex index : occupied_nodes) {
+    const Node &node = *FindNode(index);
+    for (Genotype genotype : node.existent_genotypes) {
+      lattice[index][genotype] = node.genotype_counts[genotype];
+    }
+  }
+
+  return lattice;
+}
+
+// Initialises a lattice populated on one node, simulated by an engine and
+// recorded to a trace with a keyframe every keyframe_generations
+static void InitialiseTracedLattice(const Engine simulation_engine,
+                                    const char *path,
+                                    const int keyframe_generations) {
+  InitialiseGenotypes();
+  InitialiseMatricies();
+  InitialiseLattice();
+  InitialiseResources();
+  const NodeIndex start = Lattice::Index(MakeCoords(1, 1, 1));
+  InitialisePopulationOnNode(start);
+  SetEngine(simulation_engine);
+  ASSERT_TRUE(OpenEventTrace(path, keyframe_generations));
+  BeginSimulation(start);
+}
+
+// Tests that replaying a trace of the step engine rebuilds the lattice at the
+// start of a generation, and partway through the last
+TEST(EventTrace, WhenStepsReplayed_MatchesLattice) {
+  // Arrange: a traced run with a keyframe every generation, recording the
+  // lattice at the start of generation 2 and at its last step
+  const char *path = "test_trace_steps.stt";
+  InitialiseTracedLattice(Engine::kSteps, path, 1);
+  std::map<NodeIndex, std::map<Genotype, uint32_t>> second_generation;
+  while (sim_state.generation < 4 || sim_state.step < 100) {
+    ASSERT_TRUE(StepSimulation());
+    if (sim_state.generation == 2 && sim_state.step == 0) {
+      second_generation = GetLatticeCounts();
+    }
+  }
+  const std::map<NodeIndex, std::map<Genotype, uint32_t>> last =
+      GetLatticeCounts();
+  CloseEventTrace();
+
+  // Act: replay the trace to both points
+  EventTrace trace;
+  ASSERT_TRUE(trace.Open(path));
+  TraceState second_state, last_state;
+  const bool second_found = trace.Seek(2, 0, second_state);
+  const bool last_found = trace.Seek(4, 100, last_state);
+  const uint64_t keyframes = trace.KeyframeCount();
+  trace.Close();
+  std::remove(path);
+
+  // Assert: both states match the lattice, from a keyframe per generation
+  ASSERT_TRUE(second_found);
+  ASSERT_TRUE(last_found);
+  ASSERT_EQ(5, keyframes);
+  ASSERT_EQ(second_generation, second_state.nodes);
+  ASSERT_EQ(last, last_state.nodes);
+  ASSERT_EQ(aggregates.population, last_state.population);
+}
+
+// Tests that replaying a trace of the next-reaction engine from its only
+// keyframe rebuilds the lattice
+TEST(EventTrace, WhenEventsReplayed_MatchesLattice) {
+  // Arrange: a traced run of the next-reaction engine
+  const char *path = "test_trace_events.stt";
+  InitialiseTracedLattice(Engine::kNextReaction, path,
+                          kTraceKeyframeGenerations);
+  for (int event = 0; event < 20000 && StepSimulation(); event++) {
+  }
+  const int generation = sim_state.generation;
+  const int step = sim_state.step;
+  const std::map<NodeIndex, std::map<Genotype, uint32_t>> last =
+      GetLatticeCounts();
+  CloseEventTrace();
+  SetEngine(ENGINE);
+
+  // Act: replay the trace to the last event
+  EventTrace trace;
+  ASSERT_TRUE(trace.Open(path));
+  TraceState state;
+  const bool found = trace.Seek(generation, step, state);
+  trace.Close();
+  std::remove(path);
+
+  // Assert: the state matches the lattice
+  ASSERT_TRUE(found);
+  ASSERT_GT(last.size(), 1);
+  ASSERT_EQ(last, state.nodes);
+}
+
+// Tests that replaying a trace through a kill partway through a generation
+// rebuilds the lattice the kill left
+TEST(EventTrace, WhenKillReplayed_MatchesLattice) {
+  // Arrange: a traced run of the step engine, killed halfway through its
+  // third generation, then stepped on
+  const char *path = "test_trace_kill.stt";
+  InitialiseTracedLattice(Engine::kSteps, path, kTraceKeyframeGenerations);
+  while (sim_state.generation < 2 || sim_state.step < 50) {
+    ASSERT_TRUE(StepSimulation());
+  }
+  const int64_t population = aggregates.population;
+  Perturbation kill{};
+  kill.kind = PerturbationKind::kKill;
+  kill.fraction = 0.5;
+  kill.resistant_fraction = 0.5;
+  kill.resistance_mask = 0;
+  ApplyPerturbation(kill);
+  const int64_t surviving = aggregates.population;
+  const std::map<NodeIndex, std::map<Genotype, uint32_t>> killed =
+      GetLatticeCounts();
+  while (sim_state.generation < 3) {
+    ASSERT_TRUE(StepSimulation());
+  }
+  const std::map<NodeIndex, std::map<Genotype, uint32_t>> last =
+      GetLatticeCounts();
+  CloseEventTrace();
+
+  // Act: replay the trace to the kill, and to the end of the run
+  EventTrace trace;
+  ASSERT_TRUE(trace.Open(path));
+  TraceState killed_state, last_state;
+  const bool killed_found = trace.Seek(2, 50, killed_state);
+  const bool last_found = trace.Seek(3, 0, last_state);
+  trace.Close();
+  std::remove(path);
+
+  // Assert: the kill removed individuals, and both states match the lattice
+  ASSERT_LT(surviving, population);
+  ASSERT_TRUE(killed_found);
+  ASSERT_TRUE(last_found);
+  ASSERT_EQ(killed, killed_state.nodes);
+  ASSERT_EQ(surviving, killed_state.population);
+  ASSERT_EQ(last, last_state.nodes);
+}
+
+// Tests that an incomplete trace can't be opened, and a completed one can't
+// be sought beyond its last generation
+TEST(EventTrace, WhenNotRecorded_ReplayFails) {
+  // Arrange: a traced run of one generation, left open
+  const char *path = "test_trace_incomplete.stt";
+  InitialiseTracedLattice(Engine::kSteps, path, 1);
+  while (sim_state.generation < 1) {
+    ASSERT_TRUE(StepSimulation());
+  }
+
+  // Act: open the trace before and after it's closed, and seek beyond it
+  EventTrace trace;
+  const bool opened_incomplete = trace.Open(path);
+  CloseEventTrace();
+  const bool opened = trace.Open(path);
+  TraceState state;
+  const bool found = trace.Seek(2, 0, state);
+  trace.Close();
+  std::remove(path);
+
+  // Assert: only the completed trace opens, and it ends at generation 1
+  ASSERT_FALSE(opened_incomplete);
+  ASSERT_TRUE(opened);
+  ASSERT_FALSE(found);
+}
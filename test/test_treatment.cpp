@@ -0,0 +1,203 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "stn3d/aggregates.h"
+#include "stn3d/chunks.h"
+#include "stn3d/dynamics.h"
+#include "stn3d/events.h"
+#include "stn3d/initialise.h"
+#include "stn3d/treatment.h"
+#include "stn3d/util.h"
+
+// Initialises a lattice with a population on each of its first nodes
+static void InitialiseTreatedLattice(const NodeIndex nodes) {
+  InitialiseGenotypes();
+  InitialiseMatricies();
+  InitialiseLattice();
+  InitialiseResources();
+  for (NodeIndex node = 0; node < nodes; node++) {
+    InitialisePopulationOnNode(node);
+  }
+  sim_state.generation = 0;
+}
+
+// Returns the individuals on occupied nodes whose genotype carries a bit of a
+// mask
+static int64_t CountCarriers(const Genotype mask) {
+  int64_t carriers = 0;
+  for (NodeIndex index : occupied_nodes) {
+    const Node &node = *FindNode(index);
+    for (Genotype genotype : node.existent_genotypes) {
+      if ((genotype & mask) != 0) {
+        carriers += node.genotype_counts[genotype];
+      }
+    }
+  }
+
+  return carriers;
+}
+
+// Tests that a kill spares resistant genotypes, and removes the genotypes and
+// nodes it empties
+TEST(ApplyPerturbation, WhenKill_SparesResistant) {
+  // Arrange: populated nodes, and a kill of every sensitive individual
+  InitialiseTreatedLattice(4);
+  const Genotype mask = 1;
+  const int64_t resistant = CountCarriers(mask);
+  Perturbation kill{};
+  kill.kind = PerturbationKind::kKill;
+  kill.fraction = 1.0;
+  kill.resistant_fraction = 0.0;
+  kill.resistance_mask = mask;
+
+  // Act: apply the kill, then a kill of every individual
+  ApplyPerturbation(kill);
+  bool only_resistant = true;
+  int64_t population = 0;
+  for (NodeIndex index : occupied_nodes) {
+    const Node &node = *FindNode(index);
+    population += node.population;
+    for (Genotype genotype : node.existent_genotypes) {
+      only_resistant = only_resistant && (genotype & mask) != 0 &&
+                       node.genotype_counts[genotype] > 0;
+    }
+  }
+  const int64_t surviving = aggregates.population;
+  kill.resistance_mask = 0;
+  ApplyPerturbation(kill);
+
+  // Assert: only the resistant survived the first kill, and none the second
+  ASSERT_TRUE(only_resistant);
+  ASSERT_EQ(resistant, surviving);
+  ASSERT_EQ(resistant, population);
+  ASSERT_EQ(0, aggregates.population);
+  ASSERT_TRUE(aggregates.existent_genotypes.empty());
+  ASSERT_TRUE(occupied_nodes.empty());
+}
+
+// Tests that a partial kill removes about its fraction of the individuals,
+// keeping the aggregates consistent with the nodes
+TEST(ApplyPerturbation, WhenPartialKill_ThinsBinomially) {
+  // Arrange: populated nodes, and a kill of half the individuals
+  const NodeIndex nodes = 8;
+  InitialiseTreatedLattice(nodes);
+  Perturbation kill{};
+  kill.kind = PerturbationKind::kKill;
+  kill.fraction = 0.5;
+  kill.resistant_fraction = 0.5;
+
+  // Act: apply the kill
+  ApplyPerturbation(kill);
+  int64_t population = 0;
+  for (NodeIndex index = 0; index < nodes; index++) {
+    population += FindNode(index)->population;
+  }
+
+  // Assert: about half survived, within six standard deviations
+  const int64_t expected = nodes * N_0 / 2;
+  ASSERT_NEAR(expected, aggregates.population,
+              6 * 0.5 * std::sqrt(nodes * N_0));
+  ASSERT_EQ(population, aggregates.population);
+}
+
+// Tests that the next-reaction engine keeps firing consistent events after a
+// kill, and unschedules the nodes it empties
+TEST(ApplyPerturbation, WhenKillDuringEvents_Reschedules) {
+  // Arrange: the events of populated nodes, and a kill of half the
+  // individuals
+  const NodeIndex nodes = 4;
+  InitialiseTreatedLattice(nodes);
+  SetEngine(Engine::kNextReaction);
+  BeginSimulation(0);
+  Perturbation kill{};
+  kill.kind = PerturbationKind::kKill;
+  kill.fraction = 0.5;
+  kill.resistant_fraction = 0.5;
+
+  // Act: apply the kill and fire events, then kill every individual
+  ApplyPerturbation(kill);
+  for (int event = 0; event < 2000 && StepEvent(); event++) {
+  }
+  int64_t population = 0;
+  for (NodeIndex index : occupied_nodes) {
+    population += FindNode(index)->population;
+  }
+  const int64_t aggregated = aggregates.population;
+  const size_t occupied = occupied_nodes.size();
+  const size_t scheduled = CountScheduledNodes();
+  kill.fraction = 1.0;
+  kill.resistant_fraction = 1.0;
+  ApplyPerturbation(kill);
+  const bool stepped = StepEvent();
+  SetEngine(ENGINE);
+
+  // Assert: every occupied node stayed scheduled, until none remained
+  ASSERT_EQ(population, aggregated);
+  ASSERT_EQ(occupied, scheduled);
+  ASSERT_EQ(0, CountScheduledNodes());
+  ASSERT_FALSE(stepped);
+}
+
+// Tests that scaling mu only changes the nodes within its box, and is
+// recorded for nodes whose chunks are allocated later
+TEST(ApplyPerturbation, WhenScaleMu_ScalesBox) {
+  // Arrange: a lattice, and a halving of mu in the box up to its centre
+  InitialiseTreatedLattice(1);
+  Perturbation scaling{};
+  scaling.kind = PerturbationKind::kScaleMu;
+  scaling.fraction = 0.5;
+  scaling.low.fill(0);
+  scaling.high.fill(X / 2);
+  Coords inside, outside;
+  inside.fill(X / 2);
+  outside.fill(X - 1);
+  const double inside_mu = FindNode(Lattice::Index(inside))->mu;
+  const double outside_mu = FindNode(Lattice::Index(outside))->mu;
+
+  // Act: apply the scaling
+  ApplyPerturbation(scaling);
+
+  // Assert: only the node inside the box was scaled
+  ASSERT_DOUBLE_EQ(0.5 * inside_mu, FindNode(Lattice::Index(inside))->mu);
+  ASSERT_DOUBLE_EQ(outside_mu, FindNode(Lattice::Index(outside))->mu);
+  ASSERT_DOUBLE_EQ(0.5, GetTreatedMu(inside, 1.0));
+  ASSERT_DOUBLE_EQ(1.0, GetTreatedMu(outside, 1.0));
+}
+
+// Tests that a schedule is applied at the start of its generations, blocking
+// migration for as long as it specifies, and that malformed schedules are
+// rejected
+TEST(LoadTreatmentSchedule, WhenBlockScheduled_StopsMigration) {
+  // Arrange: a schedule blocking migration from the second generation, and a
+  // malformed schedule
+  const char *path = "test_treatment.txt";
+  const char *malformed_path = "test_treatment_malformed.txt";
+  std::ofstream(path) << "# Block migration\n\n4 mu 0.5\n2 block 2\n";
+  std::ofstream(malformed_path) << "2 kill 1.5\n";
+  InitialiseTreatedLattice(1);
+  const double mu = FindNode(0)->mu;
+
+  // Act: load the schedules, and apply the first at each generation
+  const bool loaded_malformed = LoadTreatmentSchedule(malformed_path);
+  const bool loaded = LoadTreatmentSchedule(path);
+  std::vector<bool> blocked;
+  for (int generation = 1; generation <= 4; generation++) {
+    sim_state.generation = generation;
+    ApplyDueTreatments();
+    blocked.push_back(IsMigrationBlocked());
+  }
+  const double treated_mu = FindNode(0)->mu;
+  LoadTreatmentSchedule("");
+  std::remove(path);
+  std::remove(malformed_path);
+
+  // Assert: migration was blocked for generations 2 and 3, and mu halved at
+  // generation 4
+  ASSERT_FALSE(loaded_malformed);
+  ASSERT_TRUE(loaded);
+  ASSERT_EQ(std::vector<bool>({false, true, true, false}), blocked);
+  ASSERT_DOUBLE_EQ(0.5 * mu, treated_mu);
+}
@@ -18,22 +18,22 @@ TEST(GetOccupiedNode, WhenNoOccupiedNodes_ExitSuccess) {
 TEST(GetOccupiedNode, WhenOccupiedNode_ReturnsValue) {
   // Arrange: initialise a lattice with guaranteed occupancy of a node
   InitialiseLattice();
-  InitialisePopulationOnNode(1, 1, 1);
+  InitialisePopulationOnNode(Lattice::Index(MakeCoords(1, 1, 1)));
 
   // Act: attempt to get an occupied node
-  LatticePoint lattice_point = GetOccupiedNode();
+  NodeIndex node = GetOccupiedNode();
 
-  // Assert: the returned lattice point is as expected
-  ASSERT_EQ(65793, lattice_point);
+  // Assert: the returned node is as expected
+  ASSERT_EQ(Lattice::Index(MakeCoords(1, 1, 1)), node);
 }
 
 // Tests that GetCoordinate correctly returns the first coordinate
 TEST(GetCoordinate, WhenFirstCoordRequested_FirstCoordReturned) {
-  // Arrange: create a lattice point representing coordinates (1, 2, 3)
-  LatticePoint lattice_point = 197121;
+  // Arrange: create a node index representing coordinates (1, 2, 3)
+  NodeIndex node = Lattice::Index(MakeCoords(1, 2, 3));
 
   // Act: get the first coordinate
-  LatticeCoord i = GetCoordinate(lattice_point, 1);
+  LatticeCoord i = GetCoordinate(node, 1);
 
   // Assert: the first coordinate is returned
   ASSERT_EQ(1, i);
@@ -41,23 +41,28 @@ TEST(GetCoordinate, WhenFirstCoordRequested_FirstCoordReturned) {
 
 // Tests that GetCoordinate correctly returns the second coordinate
 TEST(GetCoordinate, WhenSecondCoordRequested_SecondCoordReturned) {
-  // Arrange: create a lattice point representing coordinates (1, 2, 3)
-  LatticePoint lattice_point = 197121;
+  // Arrange: create a node index representing coordinates (1, 2, 3)
+  NodeIndex node = Lattice::Index(MakeCoords(1, 2, 3));
 
   // Act: get the second coordinate
-  LatticeCoord j = GetCoordinate(lattice_point, 2);
+  LatticeCoord j = GetCoordinate(node, 2);
 
   // Assert: the second coordinate is returned
   ASSERT_EQ(2, j);
 }
 
-// Tests that GetCoordinate correctly returns the third coordinate
+// Tests that GetCoordinate correctly returns the third coordinate of a
+// three-dimensional lattice
 TEST(GetCoordinate, WhenThirdCoordRequested_ThirdCoordReturned) {
-  // Arrange: create a lattice point representing coordinates (1, 2, 3)
-  LatticePoint lattice_point = 197121;
+  if (D == 2) {
+    GTEST_SKIP();
+  }
+
+  // Arrange: create a node index representing coordinates (1, 2, 3)
+  NodeIndex node = Lattice::Index(MakeCoords(1, 2, 3));
 
   // Act: get the second coordinate
-  LatticeCoord k = GetCoordinate(lattice_point, 3);
+  LatticeCoord k = GetCoordinate(node, 3);
 
   // Assert: the second coordinate is returned
   ASSERT_EQ(3, k);
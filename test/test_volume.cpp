@@ -0,0 +1,214 @@
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "stn3d/chunks.h"
+#include "stn3d/initialise.h"
+#include "stn3d/volume.h"
+
+// Returns mu varying linearly along each axis of a voxel
+static double GetLinearMu(const double x, const double y, const double z) {
+  return 0.05 + (0.004 * x) + (0.002 * y) + (0.001 * z);
+}
+
+// Writes a volume of the linear field, returning false if it couldn't be
+// written
+static bool WriteLinearVolume(const char *path,
+                              const std::array<uint32_t, 3> &extent,
+                              const VolumeEncoding encoding) {
+  ResourceVolumeWriter writer;
+  if (!writer.Open(path, extent, encoding, 0.0001, 0.0)) {
+    return false;
+  }
+  std::vector<float> slab(extent[1] * extent[2]);
+  for (uint32_t x = 0; x < extent[0]; x++) {
+    for (uint32_t y = 0; y < extent[1]; y++) {
+      for (uint32_t z = 0; z < extent[2]; z++) {
+        slab[(y * extent[2]) + z] = static_cast<float>(GetLinearMu(x, y, z));
+      }
+    }
+    writer.WriteSlab(slab.data());
+  }
+
+  return writer.Close();
+}
+
+// Returns the extent of a volume matching the lattice, scaled along x
+static std::array<uint32_t, 3> GetLatticeExtent(const uint32_t x_scale) {
+  return {X * x_scale, X, D == 3 ? X : 1u};
+}
+
+// Tests that resources initialised from a volume the size of the lattice
+// take the mu of each voxel
+TEST(InitialiseResources, WhenVolumeMatchesLattice_SamplesVoxels) {
+  // Arrange: a volume with a voxel per node
+  const char *path = "test_volume.stv";
+  ASSERT_TRUE(
+      WriteLinearVolume(path, GetLatticeExtent(1), VolumeEncoding::kFloat32));
+  InitialiseLattice();
+
+  // Act: initialise resources from the volume
+  const bool initialised = InitialiseResources(path);
+  std::vector<double> mu, expected;
+  for (NodeIndex index = 0; index < kNodesTot; index++) {
+    const Coords coords = Lattice::Coordinates(index);
+    mu.push_back(FindNode(index)->mu);
+    expected.push_back(
+        GetLinearMu(coords[0], coords[1], D == 3 ? coords[2] : 0));
+  }
+  InitialiseResources();
+  std::remove(path);
+
+  // Assert: every node has the mu of its voxel
+  ASSERT_TRUE(initialised);
+  for (size_t idx = 0; idx < mu.size(); idx++) {
+    ASSERT_NEAR(expected[idx], mu[idx], 1e-7);
+  }
+}
+
+// Tests that a volume finer than the lattice is resampled at node centres,
+// interpolating trilinearly or taking the nearest voxel
+TEST(ResourceVolume, WhenResampled_SamplesNodeCentres) {
+  // Arrange: a volume with four slabs per plane of the lattice
+  const char *path = "test_volume.stv";
+  ASSERT_TRUE(
+      WriteLinearVolume(path, GetLatticeExtent(4), VolumeEncoding::kFloat32));
+  ResourceVolume volume;
+  ASSERT_TRUE(volume.Open(path));
+
+  // Act: sample the first and last node of the lattice both ways
+  Coords first = {}, last = {};
+  last.fill(X - 1);
+  const double first_trilinear = volume.Sample(first, Resampling::kTrilinear);
+  const double last_trilinear = volume.Sample(last, Resampling::kTrilinear);
+  const double first_nearest = volume.Sample(first, Resampling::kNearest);
+  volume.Close();
+  std::remove(path);
+
+  // Assert: the centres lie between slabs 1 and 2, and 4X - 3 and 4X - 2
+  const double z_last = D == 3 ? X - 1 : 0;
+  ASSERT_NEAR(GetLinearMu(1.5, 0, 0), first_trilinear, 1e-7);
+  ASSERT_NEAR(GetLinearMu((4 * X) - 2.5, X - 1, z_last), last_trilinear,
+              1e-7);
+  ASSERT_NEAR(GetLinearMu(2, 0, 0), first_nearest, 1e-7);
+}
+
+// Tests that a compressed volume samples identically to the uncompressed
+// quantised volume, in fewer bytes
+TEST(ResourceVolume, WhenCompressed_MatchesQuantised) {
+  // Arrange: the same field written quantised and compressed
+  const char *quantised_path = "test_volume_quantised.stv";
+  const char *compressed_path = "test_volume_compressed.stv";
+  ASSERT_TRUE(WriteLinearVolume(quantised_path, GetLatticeExtent(3),
+                                VolumeEncoding::kUint16));
+  ASSERT_TRUE(WriteLinearVolume(compressed_path, GetLatticeExtent(3),
+                                VolumeEncoding::kDelta16));
+  ResourceVolume quantised, compressed;
+  ASSERT_TRUE(quantised.Open(quantised_path));
+  ASSERT_TRUE(compressed.Open(compressed_path));
+
+  // Act: sample every node from both, in reverse order so compressed slabs
+  // are decoded again, and release the slabs of the compressed volume
+  std::vector<double> quantised_mu, compressed_mu;
+  for (NodeIndex index = kNodesTot; index-- > 0;) {
+    const Coords coords = Lattice::Coordinates(index);
+    quantised_mu.push_back(quantised.Sample(coords, Resampling::kTrilinear));
+    compressed_mu.push_back(
+        compressed.Sample(coords, Resampling::kTrilinear));
+    compressed.ReleaseSlabsBefore(compressed.GetFirstSlab(coords[0]));
+  }
+  // Slab data is compared, as the slab index outweighs the few voxels of a
+  // planar lattice's slabs
+  const uint64_t quantised_size =
+      quantised.Header().file_size - quantised.Header().data_offset;
+  const uint64_t compressed_size =
+      compressed.Header().slab_offsets - compressed.Header().data_offset;
+  quantised.Close();
+  compressed.Close();
+  std::remove(quantised_path);
+  std::remove(compressed_path);
+
+  // Assert: the samples are identical, and the smooth field compressed
+  ASSERT_EQ(quantised_mu, compressed_mu);
+  ASSERT_NEAR(GetLinearMu(1, 0, 0), quantised_mu.back(), 0.0001);
+  ASSERT_LT(compressed_size, quantised_size);
+}
+
+// Tests that truncated, mismatched and missing volumes are rejected, and
+// resources aren't initialised from them
+TEST(ResourceVolume, WhenInvalid_OpenFails) {
+  // Arrange: a volume, and a truncated copy of it
+  const char *path = "test_volume.stv";
+  const char *truncated_path = "test_volume_truncated.stv";
+  ASSERT_TRUE(
+      WriteLinearVolume(path, GetLatticeExtent(1), VolumeEncoding::kUint8));
+  {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+    std::ofstream truncated(truncated_path, std::ios::binary);
+    truncated.write(bytes.data(),
+                    static_cast<std::streamsize>(bytes.size() - 1));
+  }
+
+  // Act: open the truncated and a nonexistent volume, and an unquantisable
+  // one for writing
+  ResourceVolume volume;
+  const bool opened = volume.Open(path);
+  const bool opened_truncated = volume.Open(truncated_path);
+  const bool opened_missing = volume.Open("nonexistent_volume.stv");
+  ResourceVolumeWriter writer;
+  const bool written_unscaled = writer.Open(
+      "unscaled_volume.stv", GetLatticeExtent(1), VolumeEncoding::kUint8, 0.0);
+  InitialiseLattice();
+  const bool initialised = InitialiseResources("nonexistent_volume.stv");
+  InitialiseResources();
+  std::remove(path);
+  std::remove(truncated_path);
+
+  // Assert: only the intact volume opens
+  ASSERT_TRUE(opened);
+  ASSERT_FALSE(opened_truncated);
+  ASSERT_FALSE(opened_missing);
+  ASSERT_FALSE(written_unscaled);
+  ASSERT_FALSE(initialised);
+}
+
+// Tests that a volume whose extents wrap the size of its slabs is rejected,
+// as are compressed slabs shorter than their voxels
+TEST(ResourceVolume, WhenExtentsOverflow_OpenFails) {
+  // Arrange: an uncompressed and a compressed volume, with their extents
+  // rewritten. 2^31 slabs of 2^31 float voxels wrap to 0 bytes
+  const char *path = "test_volume_overflow.stv";
+  const char *compressed_path = "test_volume_overflow_compressed.stv";
+  ASSERT_TRUE(
+      WriteLinearVolume(path, GetLatticeExtent(1), VolumeEncoding::kFloat32));
+  ASSERT_TRUE(WriteLinearVolume(compressed_path, GetLatticeExtent(1),
+                                VolumeEncoding::kDelta16));
+  const auto rewrite_extent = [](const char *rewritten,
+                                 const std::array<uint32_t, 3> &extent) {
+    std::fstream file(rewritten,
+                      std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offsetof(VolumeHeader, extent));
+    file.write(reinterpret_cast<const char *>(extent.data()),
+               sizeof(uint32_t) * extent.size());
+  };
+  rewrite_extent(path, {1u << 31, 1u << 31, 1});
+  rewrite_extent(compressed_path, {X, X * X * X, 1});
+
+  // Act: open both volumes
+  ResourceVolume volume;
+  const bool opened = volume.Open(path);
+  const bool opened_compressed = volume.Open(compressed_path);
+  std::remove(path);
+  std::remove(compressed_path);
+
+  // Assert: neither opens
+  ASSERT_FALSE(opened);
+  ASSERT_FALSE(opened_compressed);
+}
@@ -0,0 +1,42 @@
+/*
+Generates an interaction landscape file for the genome length L and
+interaction probability THETA configured in params.h, for runs to map via
+LANDSCAPE_FILE or the landscape_path run option. Usage:
+
+  stn3d_landscape <path> [seed]
+
+The same seed always generates the same landscape. Without a seed, one is
+drawn from the system's random device.
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "stn3d/initialise.h"
+#include "stn3d/landscape.h"
+#include "stn3d/util.h"
+
+int main(int argc, char *argv[]) {
+  if (argc < 2 || argc > 3) {
+    std::cout << "Usage: stn3d_landscape <path> [seed]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::random_device device;
+  const uint64_t seed =
+      argc == 3 ? std::stoull(argv[2])
+                : (static_cast<uint64_t>(device()) << 32) | device();
+  SeedRandomEngine(seed);
+  InitialiseMatricies();
+
+  if (!WriteLandscapeFile(argv[1], seed)) {
+    std::cout << "Unable to write landscape file " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Wrote L=" << L << " landscape with seed " << seed << " to "
+            << argv[1] << std::endl;
+
+  return EXIT_SUCCESS;
+}
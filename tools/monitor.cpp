@@ -0,0 +1,90 @@
+/*
+Prints the latest live snapshot of a simulation publishing to a shared memory
+segment via SNAPSHOT_SEGMENT, without pausing it. Usage:
+
+  stn3d_monitor <segment> [interval]
+
+With an interval in seconds, the snapshot is printed repeatedly until the
+simulation ends. Each print shows the progress of the run and its most
+populous nodes, with the leading genotypes of each.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "stn3d/snapshot.h"
+
+// Nodes listed per print
+constexpr size_t kListedNodes = 10;
+
+// Prints the progress of the run and its most populous nodes
+static void PrintSnapshot(Snapshot &snapshot) {
+  std::sort(snapshot.nodes.begin(), snapshot.nodes.end(),
+            [](const SnapshotNode &a, const SnapshotNode &b) {
+              return a.population > b.population;
+            });
+
+  std::cout << (snapshot.running ? "Running" : "Finished") << ": generation "
+            << snapshot.generation << ", time " << std::fixed
+            << std::setprecision(3) << snapshot.time << ", population "
+            << snapshot.population << ", occupied nodes "
+            << snapshot.nodes.size() << "\n";
+  for (size_t idx = 0; idx < std::min(kListedNodes, snapshot.nodes.size());
+       idx++) {
+    const SnapshotNode &node = snapshot.nodes[idx];
+
+    // Decode the flat node index into coordinates, last axis fastest
+    std::string coords;
+    NodeIndex remaining = node.node;
+    for (int axis = 0; axis < snapshot.dimensions; axis++) {
+      coords = std::to_string(remaining % snapshot.lattice_length) +
+               (axis ? "," : "") + coords;
+      remaining /= snapshot.lattice_length;
+    }
+
+    std::cout << "  (" << coords << ") population " << node.population
+              << ", genotypes " << node.existent_count << ", mu "
+              << std::setprecision(4) << node.mu << ", top";
+    for (int slot = 0; slot < kSnapshotTopGenotypes; slot++) {
+      if (node.top_counts[slot] > 0) {
+        std::cout << " " << node.top_genotypes[slot] << "x"
+                  << node.top_counts[slot];
+      }
+    }
+    std::cout << "\n";
+  }
+  std::cout << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2 || argc > 3) {
+    std::cout << "Usage: stn3d_monitor <segment> [interval]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  SnapshotReader reader;
+  if (!reader.Open(argv[1])) {
+    std::cout << "Unable to open snapshot segment " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const double interval = argc == 3 ? std::stod(argv[2]) : 0.0;
+  Snapshot snapshot;
+  do {
+    if (!reader.Read(snapshot)) {
+      std::cout << "Unable to read a consistent snapshot" << std::endl;
+      return EXIT_FAILURE;
+    }
+    PrintSnapshot(snapshot);
+    if (interval > 0.0 && snapshot.running) {
+      std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+    }
+  } while (interval > 0.0 && snapshot.running);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+/*
+Rebuilds the lattice of a simulation recorded to an event trace via
+EVENT_TRACE_FILE, as it was after a number of steps of a generation, and
+prints it. Usage:
+
+  stn3d_replay <trace> <generation> [step]
+
+The step defaults to 0, the start of the generation. Replay starts from the
+last keyframe before the generation and applies the recorded events from
+there, without simulating. The deaths of a treatment replay as one record per
+node and genotype.
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "stn3d/trace.h"
+
+// Nodes and genotypes listed per node
+constexpr size_t kListedNodes = 10;
+constexpr size_t kListedGenotypes = 4;
+
+// Prints the population of the state and its most populous nodes, with the
+// leading genotypes of each
+static void PrintState(const TraceState &state, const TraceHeader &header) {
+  std::vector<std::pair<int64_t, NodeIndex>> populations;
+  for (const auto &node : state.nodes) {
+    int64_t population = 0;
+    for (const auto &count : node.second) {
+      population += count.second;
+    }
+    populations.push_back({population, node.first});
+  }
+  std::sort(populations.rbegin(), populations.rend());
+
+  std::cout << "Generation " << state.generation << ", step " << state.step
+            << ": population " << state.population << ", occupied nodes "
+            << state.nodes.size() << "\n";
+  for (size_t idx = 0; idx < std::min(kListedNodes, populations.size());
+       idx++) {
+    // Decode the flat node index into coordinates, last axis fastest
+    std::string coords;
+    NodeIndex remaining = populations[idx].second;
+    for (int axis = 0; axis < header.dimensions; axis++) {
+      coords = std::to_string(remaining % header.lattice_length) +
+               (axis ? "," : "") + coords;
+      remaining /= header.lattice_length;
+    }
+
+    std::vector<std::pair<uint32_t, Genotype>> genotypes;
+    for (const auto &count : state.nodes.at(populations[idx].second)) {
+      genotypes.push_back({count.second, count.first});
+    }
+    std::sort(genotypes.rbegin(), genotypes.rend());
+
+    std::cout << "  (" << coords << ") population " << populations[idx].first
+              << ", genotypes " << genotypes.size() << ", top";
+    for (size_t slot = 0; slot < std::min(kListedGenotypes, genotypes.size());
+         slot++) {
+      std::cout << " " << genotypes[slot].second << "x"
+                << genotypes[slot].first;
+    }
+    std::cout << "\n";
+  }
+  std::cout << std::flush;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3 || argc > 4) {
+    std::cout << "Usage: stn3d_replay <trace> <generation> [step]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  EventTrace trace;
+  if (!trace.Open(argv[1])) {
+    std::cout << "Unable to open event trace " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  TraceState state;
+  const int generation = std::stoi(argv[2]);
+  const int step = argc == 4 ? std::stoi(argv[3]) : 0;
+  if (!trace.Seek(generation, step, state)) {
+    std::cout << "The trace ends before generation " << generation
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  PrintState(state, trace.Header());
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+/*
+Converts a raw voxel map of mu, such as one exported from an imaging
+pipeline, into a resource volume for runs to load via RESOURCE_VOLUME_FILE.
+Usage:
+
+  stn3d_volume <raw> <x> <y> <z> <volume> [float32|uint8|uint16|delta16]
+
+The raw file holds x slabs of y rows of z float32 values in host order, with
+z of 1 for a two-dimensional map. Quantised encodings span the range of the
+values, found by a first pass over the file. The default, delta16, is
+compressed. The raw file is read a slab at a time, so it needn't fit in
+memory.
+*/
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "stn3d/volume.h"
+
+// Reads the next slab of the raw file, returning false if it's too short
+static bool ReadSlab(std::ifstream &raw, std::vector<float> &slab) {
+  raw.read(reinterpret_cast<char *>(slab.data()),
+           static_cast<std::streamsize>(slab.size() * sizeof(float)));
+
+  return raw.good();
+}
+
+// Sets the encoding named by an argument, returning false if there's none
+static bool ParseEncoding(const std::string &name, VolumeEncoding &encoding) {
+  const std::pair<const char *, VolumeEncoding> names[] = {
+      {"float32", VolumeEncoding::kFloat32},
+      {"uint8", VolumeEncoding::kUint8},
+      {"uint16", VolumeEncoding::kUint16},
+      {"delta16", VolumeEncoding::kDelta16}};
+  for (const auto &entry : names) {
+    if (name == entry.first) {
+      encoding = entry.second;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+int main(int argc, char *argv[]) {
+  VolumeEncoding encoding = VolumeEncoding::kDelta16;
+  if (argc < 6 || argc > 7 ||
+      (argc == 7 && !ParseEncoding(argv[6], encoding))) {
+    std::cout << "Usage: stn3d_volume <raw> <x> <y> <z> <volume> "
+                 "[float32|uint8|uint16|delta16]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const std::array<uint32_t, 3> extent = {
+      static_cast<uint32_t>(std::stoul(argv[2])),
+      static_cast<uint32_t>(std::stoul(argv[3])),
+      static_cast<uint32_t>(std::stoul(argv[4]))};
+  std::vector<float> slab(static_cast<size_t>(extent[1]) * extent[2]);
+  std::ifstream raw(argv[1], std::ios::binary);
+  if (!raw.is_open()) {
+    std::cout << "Unable to open raw voxels " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Find the range of the values to quantise them
+  double scale = 1.0;
+  double offset = 0.0;
+  if (encoding != VolumeEncoding::kFloat32) {
+    float lowest = std::numeric_limits<float>::max();
+    float highest = std::numeric_limits<float>::lowest();
+    for (uint32_t x = 0; x < extent[0]; x++) {
+      if (!ReadSlab(raw, slab)) {
+        std::cout << "Raw voxels end before slab " << x << std::endl;
+        return EXIT_FAILURE;
+      }
+      const auto range = std::minmax_element(slab.begin(), slab.end());
+      lowest = std::min(lowest, *range.first);
+      highest = std::max(highest, *range.second);
+    }
+    const double levels =
+        encoding == VolumeEncoding::kUint8 ? UINT8_MAX : UINT16_MAX;
+    offset = lowest;
+    scale = highest > lowest ? (highest - lowest) / levels : 1.0;
+    raw.clear();
+    raw.seekg(0);
+  }
+
+  ResourceVolumeWriter writer;
+  if (!writer.Open(argv[5], extent, encoding, scale, offset)) {
+    std::cout << "Unable to write resource volume " << argv[5] << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (uint32_t x = 0; x < extent[0]; x++) {
+    if (!ReadSlab(raw, slab)) {
+      std::cout << "Raw voxels end before slab " << x << std::endl;
+      return EXIT_FAILURE;
+    }
+    writer.WriteSlab(slab.data());
+  }
+  if (!writer.Close()) {
+    std::cout << "Unable to write resource volume " << argv[5] << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Wrote " << extent[0] << "x" << extent[1] << "x" << extent[2]
+            << " resource volume to " << argv[5] << std::endl;
+
+  return EXIT_SUCCESS;
+}
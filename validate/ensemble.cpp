@@ -0,0 +1,174 @@
+#include "ensemble.h"
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include "stn3d/run.h"
+
+static constexpr char kEnsembleHeader[] = "# stn3d ensemble";
+
+// Returns the generation of a population checkpoint
+static int GetCheckpointGeneration(const int checkpoint,
+                                   const int generations) {
+  return ((checkpoint + 1) * generations) / kCheckpoints;
+}
+
+// Returns the name of each metric, in order
+std::vector<std::string> GetMetricNames(const int generations) {
+  std::vector<std::string> names;
+  for (int checkpoint = 0; checkpoint < kCheckpoints; checkpoint++) {
+    names.push_back(
+        "population@" +
+        std::to_string(GetCheckpointGeneration(checkpoint, generations)));
+  }
+  names.push_back("occupied_nodes");
+  names.push_back("genotypes");
+  names.push_back("diversity");
+  names.push_back("extinction_time");
+
+  return names;
+}
+
+// Measures the occupied nodes, genotype richness and Shannon diversity of the
+// lattice of the run
+static void MeasureLattice(RunMetrics &metrics) {
+  const Aggregates &totals = GetRunAggregates();
+  double diversity = 0.0;
+  for (Genotype genotype : totals.existent_genotypes) {
+    const double fraction =
+        static_cast<double>(totals.genotype_populations[genotype]) /
+        totals.population;
+    diversity -= fraction * std::log(fraction);
+  }
+  metrics[kOccupiedNodesMetric] = GetOccupiedNodes().size();
+  metrics[kGenotypesMetric] = totals.existent_genotypes.size();
+  metrics[kDiversityMetric] = diversity;
+}
+
+// Simulates one run and summarises it in metrics. Returns false if the run
+// can't be created
+static bool SimulateRun(const Engine engine, const uint64_t seed,
+                        const EnsembleOptions &options, RunMetrics &metrics) {
+  SetEngine(engine);
+  if (!CreateRun({seed, false, options.landscape_path})) {
+    return false;
+  }
+
+  metrics.fill(0.0);
+  metrics[kExtinctionMetric] = options.generations;
+  int checkpoint = 0;
+  bool extinct = false;
+  for (int gen = 1; gen <= options.generations && !extinct; gen++) {
+    if (!AdvanceGenerations(1)) {
+      metrics[kExtinctionMetric] = GetRunState().time;
+      extinct = true;
+    } else if (gen ==
+               GetCheckpointGeneration(checkpoint, options.generations)) {
+      metrics[checkpoint++] = GetRunState().population;
+    }
+  }
+  if (!extinct) {
+    MeasureLattice(metrics);
+  }
+  DestroyRun();
+
+  return true;
+}
+
+// Simulates an ensemble of an engine, sharing the runs between worker
+// processes, as the simulation state is global. Workers write the metrics of
+// their runs into a shared anonymous mapping. Returns false if any run fails
+bool RunEnsemble(const Engine engine, const EnsembleOptions &options,
+                 std::vector<RunMetrics> &ensemble) {
+  const size_t bytes = options.runs * sizeof(RunMetrics);
+  void *mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  RunMetrics *shared = static_cast<RunMetrics *>(mapping);
+
+  // Flush buffered output so workers don't repeat it on exit
+  std::cout.flush();
+  std::vector<pid_t> workers;
+  for (int worker = 0; worker < options.jobs; worker++) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+      for (int run = worker; run < options.runs; run += options.jobs) {
+        if (!SimulateRun(engine, options.first_seed + run, options,
+                         shared[run])) {
+          _exit(EXIT_FAILURE);
+        }
+      }
+      _exit(EXIT_SUCCESS);
+    }
+    if (pid > 0) {
+      workers.push_back(pid);
+    }
+  }
+
+  bool succeeded = static_cast<int>(workers.size()) == options.jobs;
+  for (pid_t pid : workers) {
+    int status;
+    waitpid(pid, &status, 0);
+    succeeded = succeeded && WIFEXITED(status) &&
+                WEXITSTATUS(status) == EXIT_SUCCESS;
+  }
+  ensemble.assign(shared, shared + options.runs);
+  munmap(mapping, bytes);
+
+  return succeeded;
+}
+
+// Writes the metrics of an ensemble, one run per line, so a later build can
+// be validated against it
+bool WriteEnsembleFile(const std::string &path, const int generations,
+                       const std::vector<RunMetrics> &ensemble) {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  file << kEnsembleHeader << "\n" << generations << " " << ensemble.size()
+       << "\n";
+  file.precision(17);
+  for (const RunMetrics &metrics : ensemble) {
+    for (int metric = 0; metric < kMetrics; metric++) {
+      file << metrics[metric] << (metric + 1 < kMetrics ? " " : "\n");
+    }
+  }
+
+  return file.good();
+}
+
+// Reads the metrics of an ensemble written by WriteEnsembleFile. Returns
+// false if the file is missing, malformed or simulated other generations
+bool ReadEnsembleFile(const std::string &path, const int generations,
+                      std::vector<RunMetrics> &ensemble) {
+  std::ifstream file(path);
+  std::string header;
+  if (!std::getline(file, header) || header != kEnsembleHeader) {
+    return false;
+  }
+
+  int file_generations;
+  size_t runs;
+  if (!(file >> file_generations >> runs) || file_generations != generations) {
+    return false;
+  }
+  ensemble.assign(runs, RunMetrics());
+  for (RunMetrics &metrics : ensemble) {
+    for (double &value : metrics) {
+      if (!(file >> value)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,41 @@
+#ifndef ENSEMBLE_H_
+#define ENSEMBLE_H_
+
+#include <array>
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+#include "stn3d/params.h"
+
+// An ensemble is a set of independent seeded runs of one engine, summarised
+// by the metrics below. The total population is sampled at kCheckpoints
+// evenly spaced generations, then the occupied nodes, genotype richness and
+// Shannon diversity of the lattice are measured at the final generation. Runs
+// surviving to the final generation have it as their extinction time.
+constexpr int kCheckpoints = 4;
+constexpr int kOccupiedNodesMetric = kCheckpoints;
+constexpr int kGenotypesMetric = kCheckpoints + 1;
+constexpr int kDiversityMetric = kCheckpoints + 2;
+constexpr int kExtinctionMetric = kCheckpoints + 3;
+constexpr int kMetrics = kCheckpoints + 4;
+
+using RunMetrics = std::array<double, kMetrics>;
+
+struct EnsembleOptions {
+  int runs;                    // Runs in the ensemble
+  uint64_t first_seed;         // Seed of the first run, incremented per run
+  int generations;             // Generations simulated per run
+  int jobs;                    // Worker processes running in parallel
+  const char *landscape_path;  // Landscape file shared by all runs, or null
+};
+
+std::vector<std::string> GetMetricNames(int generations);
+bool RunEnsemble(Engine engine, const EnsembleOptions &options,
+                 std::vector<RunMetrics> &ensemble);
+bool WriteEnsembleFile(const std::string &path, int generations,
+                       const std::vector<RunMetrics> &ensemble);
+bool ReadEnsembleFile(const std::string &path, int generations,
+                      std::vector<RunMetrics> &ensemble);
+
+#endif
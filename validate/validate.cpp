@@ -0,0 +1,215 @@
+/*
+Validates a candidate engine against a reference engine by simulating seeded
+ensembles of each and testing whether the distributions of every metric in
+ensemble.h are the same. Each metric is compared with two-sample
+Kolmogorov-Smirnov and Anderson-Darling tests, at a significance level
+Bonferroni corrected for the number of tests, and the process exits
+successfully only if no test rejects. Usage:
+
+  stn3d_validate [--runs N] [--generations G] [--jobs J] [--alpha A]
+                 [--seed S] [--reference steps|events]
+                 [--candidate steps|events] [--landscape PATH]
+                 [--write-reference PATH] [--read-reference PATH]
+
+Reference runs use seeds S to S + N - 1, and candidate runs the next N seeds.
+To validate a change to the simulation itself, write the reference ensemble
+with the build before the change, then read it with the build after.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "ensemble.h"
+#include "stn3d/statistics.h"
+
+struct ValidateOptions {
+  int runs = 200;
+  int generations = 40;
+  int jobs = std::max(1u, std::thread::hardware_concurrency());
+  double alpha = 0.01;
+  uint64_t seed = 1;
+  std::string reference = "steps";
+  std::string candidate = "events";
+  std::string landscape_path;
+  std::string write_reference;
+  std::string read_reference;
+};
+
+static const std::map<std::string, Engine> kEngineNames = {
+    {"steps", Engine::kSteps}, {"events", Engine::kNextReaction}};
+
+// Parses the command line into options. Returns false if it's malformed
+static bool ParseOptions(const int argc, char *argv[],
+                         ValidateOptions &options) {
+  for (int arg = 1; arg + 1 < argc; arg += 2) {
+    const std::string flag = argv[arg];
+    const std::string value = argv[arg + 1];
+    if (flag == "--runs") {
+      options.runs = std::stoi(value);
+    } else if (flag == "--generations") {
+      options.generations = std::stoi(value);
+    } else if (flag == "--jobs") {
+      options.jobs = std::stoi(value);
+    } else if (flag == "--alpha") {
+      options.alpha = std::stod(value);
+    } else if (flag == "--seed") {
+      options.seed = std::stoull(value);
+    } else if (flag == "--reference") {
+      options.reference = value;
+    } else if (flag == "--candidate") {
+      options.candidate = value;
+    } else if (flag == "--landscape") {
+      options.landscape_path = value;
+    } else if (flag == "--write-reference") {
+      options.write_reference = value;
+    } else if (flag == "--read-reference") {
+      options.read_reference = value;
+    } else {
+      return false;
+    }
+  }
+
+  return argc % 2 == 1 && options.runs > 1 &&
+         options.generations >= kCheckpoints && options.jobs > 0 &&
+         options.alpha > 0.0 && options.alpha < 1.0 &&
+         kEngineNames.count(options.reference) == 1 &&
+         kEngineNames.count(options.candidate) == 1;
+}
+
+// Simulates an ensemble, reporting its wall time. Returns false on failure
+static bool SimulateEnsemble(const std::string &engine, const uint64_t seed,
+                             const ValidateOptions &options,
+                             std::vector<RunMetrics> &ensemble) {
+  const auto start = std::chrono::steady_clock::now();
+  const EnsembleOptions ensemble_options = {
+      options.runs, seed, options.generations, options.jobs,
+      options.landscape_path.empty() ? nullptr
+                                     : options.landscape_path.c_str()};
+  if (!RunEnsemble(kEngineNames.at(engine), ensemble_options, ensemble)) {
+    std::cout << "Unable to simulate the " << engine << " ensemble"
+              << std::endl;
+    return false;
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "Simulated " << options.runs << " " << engine << " runs of "
+            << options.generations << " generations in " << std::fixed
+            << std::setprecision(1) << elapsed.count() << " s" << std::endl;
+
+  return true;
+}
+
+// Returns the mean of a sample
+static double GetMean(const std::vector<double> &sample) {
+  double sum = 0.0;
+  for (double value : sample) {
+    sum += value;
+  }
+
+  return sum / sample.size();
+}
+
+// Tests every metric of the candidate ensemble against the reference and
+// prints a report. Returns true if no test rejects
+static bool ReportComparison(const std::vector<RunMetrics> &reference,
+                             const std::vector<RunMetrics> &candidate,
+                             const ValidateOptions &options) {
+  const int tests = 2 * kMetrics;
+  const double corrected_alpha = options.alpha / tests;
+  std::cout << std::defaultfloat << std::setprecision(6) << "\nSignificance "
+            << options.alpha << ", corrected to " << corrected_alpha
+            << " over " << tests << " tests\n\n"
+            << std::left << std::setw(18) << "metric" << std::right
+            << std::setw(12) << "reference" << std::setw(12) << "candidate"
+            << std::setw(8) << "KS D" << std::setw(10) << "KS p"
+            << std::setw(8) << "AD T" << std::setw(10) << "AD p"
+            << "  result\n";
+
+  const std::vector<std::string> names = GetMetricNames(options.generations);
+  int rejected = 0;
+  for (int metric = 0; metric < kMetrics; metric++) {
+    std::vector<double> reference_sample;
+    std::vector<double> candidate_sample;
+    for (const RunMetrics &metrics : reference) {
+      reference_sample.push_back(metrics[metric]);
+    }
+    for (const RunMetrics &metrics : candidate) {
+      candidate_sample.push_back(metrics[metric]);
+    }
+
+    const TestResult ks =
+        KolmogorovSmirnovTest(reference_sample, candidate_sample);
+    const TestResult ad =
+        AndersonDarlingTest({reference_sample, candidate_sample});
+    const bool passed =
+        ks.p_value >= corrected_alpha && ad.p_value >= corrected_alpha;
+    rejected += passed ? 0 : 1;
+
+    std::cout << std::left << std::setw(18) << names[metric] << std::right
+              << std::fixed << std::setprecision(2) << std::setw(12)
+              << GetMean(reference_sample) << std::setw(12)
+              << GetMean(candidate_sample) << std::setprecision(3)
+              << std::setw(8) << ks.statistic << std::setw(10)
+              << std::setprecision(5) << ks.p_value << std::setprecision(3)
+              << std::setw(8) << ad.statistic << std::setw(10)
+              << std::setprecision(5) << ad.p_value << "  "
+              << (passed ? "pass" : "FAIL") << "\n";
+  }
+
+  std::cout << "\n"
+            << (rejected == 0 ? "PASS" : "FAIL") << ": " << options.candidate
+            << " is " << (rejected == 0 ? "" : "not ")
+            << "consistent with the reference " << options.reference << " ("
+            << rejected << " of " << kMetrics << " metrics rejected)"
+            << std::endl;
+
+  return rejected == 0;
+}
+
+int main(int argc, char *argv[]) {
+  ValidateOptions options;
+  if (!ParseOptions(argc, argv, options)) {
+    std::cout << "Usage: stn3d_validate [--runs N] [--generations G] "
+                 "[--jobs J] [--alpha A] [--seed S]\n"
+                 "  [--reference steps|events] [--candidate steps|events]\n"
+                 "  [--landscape PATH] [--write-reference PATH] "
+                 "[--read-reference PATH]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<RunMetrics> reference;
+  if (!options.read_reference.empty()) {
+    if (!ReadEnsembleFile(options.read_reference, options.generations,
+                          reference)) {
+      std::cout << "Unable to read a reference ensemble of "
+                << options.generations << " generations from "
+                << options.read_reference << std::endl;
+      return EXIT_FAILURE;
+    }
+    options.reference = options.read_reference;
+  } else if (!SimulateEnsemble(options.reference, options.seed, options,
+                               reference)) {
+    return EXIT_FAILURE;
+  }
+  if (!options.write_reference.empty() &&
+      !WriteEnsembleFile(options.write_reference, options.generations,
+                         reference)) {
+    std::cout << "Unable to write " << options.write_reference << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<RunMetrics> candidate;
+  if (!SimulateEnsemble(options.candidate, options.seed + options.runs,
+                        options, candidate)) {
+    return EXIT_FAILURE;
+  }
+
+  return ReportComparison(reference, candidate, options) ? EXIT_SUCCESS
+                                                         : EXIT_FAILURE;
+}